@@ -14,11 +14,17 @@ namespace Archive
       public:
         constexpr static std::size_t copyBufferSize = 4096;
 
+        enum class Format
+        {
+            Tar,
+            Zip
+        };
+
       public:
         /**
-         * This constructor will create the tar file in the filesystem.
+         * This constructor will create the archive file in the filesystem.
          */
-        Writer(std::filesystem::path const& path);
+        Writer(std::filesystem::path const& path, Format format = Format::Tar);
         /**
          * This constructor will create the tar file in memory (in the supplied string).
          */
@@ -28,6 +34,11 @@ namespace Archive
         Error addGzipFilter();
         Error addFile(std::filesystem::path const& path);
 
+        /**
+         * Adds the file under a different path inside the archive.
+         */
+        Error addFile(std::filesystem::path const& path, std::filesystem::path const& archivePath);
+
         Error
         addString(std::string const& data, std::filesystem::path const& pathName, std::filesystem::perms permissions);
 
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+
+/**
+ * @brief Options for running pack operations without the webview, for build machines without a display.
+ */
+struct CliOptions
+{
+    std::filesystem::path packPath;
+    std::optional<std::filesystem::path> importDirectory = std::nullopt;
+    std::optional<std::filesystem::path> importIndex = std::nullopt;
+    bool installMods = false;
+    bool installLoader = false;
+    bool deploy = false;
+    bool exportMrPack = false;
+    unsigned int jobs = 0;
+    std::optional<std::filesystem::path> traceFile = std::nullopt;
+    /// --help was passed and the usage printed, nothing else is to be done.
+    bool helpShown = false;
+};
+
+/**
+ * @brief Returns the headless options if --headless or --help was passed, std::nullopt if the window should be
+ * opened.
+ */
+std::optional<CliOptions> parseCliOptions(int argc, char** argv);
+
+/**
+ * @brief Runs the requested pack operations and prints one json object per line with timings to stdout.
+ *
+ * @return The process exit code.
+ */
+int runHeadless(CliOptions const& options);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <backend/tracer.hpp>
+
 #include <filesystem>
 #include <nui/backend/rpc_hub.hpp>
 #include <string>
@@ -9,9 +11,12 @@ class Fabric
   public:
     constexpr static char const* mainPageBaseUrl = "https://maven.fabricmc.net/net/fabricmc/fabric-installer/";
 
-    Fabric(Nui::RpcHub& hub);
+    /**
+     * @brief Use without rpc bindings, for instance from the headless command line.
+     */
+    Fabric() = default;
+    Fabric(Nui::RpcHub& hub, Tracer& tracer);
 
-  private:
-    bool installFabricInstaller(std::filesystem::path const& whereTo);
+    bool installFabricInstaller(std::filesystem::path const& whereTo, Tracer::Span& span);
     bool installFabric(std::filesystem::path const& whereTo, std::string const& mcVersion);
 };
\ No newline at end of file
@@ -1,16 +1,18 @@
 #pragma once
 
+#include <backend/tracer.hpp>
+
 #include <nui/backend/rpc_hub.hpp>
 
 class FileSystem
 {
   public:
-    static void registerAll(Nui::RpcHub const& hub);
+    static void registerAll(Nui::RpcHub const& hub, Tracer& tracer);
 
   private:
-    static void registerReadFile(Nui::RpcHub const& hub);
-    static void registerWriteFile(Nui::RpcHub const& hub);
-    static void registerCreateDirectory(Nui::RpcHub const& hub);
-    static void registerFileExists(Nui::RpcHub const& hub);
-    static void registerGetPackDevHome(Nui::RpcHub const& hub);
+    static void registerReadFile(Nui::RpcHub const& hub, Tracer& tracer);
+    static void registerWriteFile(Nui::RpcHub const& hub, Tracer& tracer);
+    static void registerCreateDirectory(Nui::RpcHub const& hub, Tracer& tracer);
+    static void registerFileExists(Nui::RpcHub const& hub, Tracer& tracer);
+    static void registerGetPackDevHome(Nui::RpcHub const& hub, Tracer& tracer);
 };
\ No newline at end of file
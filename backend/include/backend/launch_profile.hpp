@@ -0,0 +1,235 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Header only: the frontend writes the start scripts from it and cannot link the backend.
+
+enum class GarbageCollector
+{
+    G1,
+    Z
+};
+
+/**
+ * @brief How the JVM of the game server is started. The update server launches it from a profile and the start
+ * scripts of a pack are written from the same profile, so both run the server alike. The heap is sized from the
+ * memory of the host at launch, the scripts compute it when they run.
+ */
+struct LaunchProfile
+{
+    constexpr static char const* defaultName = "g1";
+    /// CPU_SETSIZE of glibc, the affinity mask cannot name cpus beyond it.
+    constexpr static unsigned int maximumCpus = 1024;
+
+    std::string name;
+    GarbageCollector collector = GarbageCollector::G1;
+    /// Share of the host memory for the heap, -Xms and -Xmx are the same so the heap never has to grow.
+    unsigned int heapPercent = 50;
+    std::uint64_t minimumHeapMebibytes = 2048;
+    /// Above 31 GiB G1 loses compressed object pointers, a larger heap holds fewer objects.
+    std::uint64_t maximumHeapMebibytes = 31 * 1024;
+    /// The JVM is pinned to these cores, all cores if empty.
+    std::vector<unsigned int> cpus;
+
+    /**
+     * @brief "g1" is tuned for short pauses on any Java version, "zgc" pauses below a millisecond on Java 17 and
+     * newer at the cost of more memory and CPU.
+     */
+    static std::optional<LaunchProfile> named(std::string_view name)
+    {
+        if (name == "g1")
+            return LaunchProfile{.name = "g1"};
+        if (name == "zgc")
+        {
+            // ZGC has no compressed pointers anyway and needs headroom to collect concurrently.
+            return LaunchProfile{
+                .name = "zgc",
+                .collector = GarbageCollector::Z,
+                .heapPercent = 60,
+                .maximumHeapMebibytes = 64 * 1024,
+            };
+        }
+        return std::nullopt;
+    }
+
+    /**
+     * @brief Parses cpu lists like "0-3,6". Throws std::invalid_argument for malformed lists, reversed ranges and
+     * cpus beyond maximumCpus.
+     */
+    static std::vector<unsigned int> parseCpuList(std::string_view list)
+    {
+        const std::string whole{list};
+        std::vector<unsigned int> cpus;
+        const auto number = [&whole](std::string_view part) {
+            unsigned int cpu = 0;
+            const auto [end, error] = std::from_chars(part.data(), part.data() + part.size(), cpu);
+            if (part.empty() || error != std::errc{} || end != part.data() + part.size())
+                throw std::invalid_argument("Invalid cpu list: " + whole);
+            if (cpu >= maximumCpus)
+            {
+                throw std::invalid_argument(
+                    "Cpu " + std::string{part} + " is beyond the supported " + std::to_string(maximumCpus) +
+                    " cpus: " + whole);
+            }
+            return cpu;
+        };
+        while (!list.empty())
+        {
+            const auto comma = list.find(',');
+            const auto part = list.substr(0, comma);
+            if (const auto dash = part.find('-'); dash != std::string_view::npos)
+            {
+                const auto first = number(part.substr(0, dash));
+                const auto last = number(part.substr(dash + 1));
+                if (first > last)
+                    throw std::invalid_argument("Reversed cpu range " + std::string{part} + ": " + whole);
+                for (auto cpu = first; cpu <= last; ++cpu)
+                    cpus.push_back(cpu);
+            }
+            else
+            {
+                cpus.push_back(number(part));
+            }
+            list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
+        }
+        std::sort(cpus.begin(), cpus.end());
+        cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+        return cpus;
+    }
+
+    std::uint64_t heapMebibytes(std::uint64_t hostMebibytes) const
+    {
+        return std::min(std::max(hostMebibytes * heapPercent / 100, minimumHeapMebibytes), maximumHeapMebibytes);
+    }
+
+    /**
+     * @brief The collector flags, the same for every heap size so the scripts need no logic for them.
+     */
+    std::vector<std::string> collectorArguments() const
+    {
+        if (collector == GarbageCollector::Z)
+            return {"-XX:+UseZGC", "-XX:+AlwaysPreTouch", "-XX:+DisableExplicitGC", "-XX:+PerfDisableSharedMem"};
+
+        // Aikar's flags: a large young generation for the short lived garbage of chunk generation, and mixed
+        // collections that start early so old garbage never forces a full collection.
+        return {
+            "-XX:+UseG1GC",
+            "-XX:+ParallelRefProcEnabled",
+            "-XX:MaxGCPauseMillis=200",
+            "-XX:+UnlockExperimentalVMOptions",
+            "-XX:+DisableExplicitGC",
+            "-XX:+AlwaysPreTouch",
+            "-XX:G1NewSizePercent=30",
+            "-XX:G1MaxNewSizePercent=40",
+            "-XX:G1HeapRegionSize=8M",
+            "-XX:G1ReservePercent=20",
+            "-XX:G1HeapWastePercent=5",
+            "-XX:G1MixedGCCountTarget=4",
+            "-XX:InitiatingHeapOccupancyPercent=15",
+            "-XX:G1MixedGCLiveThresholdPercent=90",
+            "-XX:G1RSetUpdatingPauseTimePercent=5",
+            "-XX:SurvivorRatio=32",
+            "-XX:+PerfDisableSharedMem",
+            "-XX:MaxTenuringThreshold=1",
+        };
+    }
+
+    /**
+     * @brief Everything between "java" and "-jar".
+     */
+    std::vector<std::string> jvmArguments(std::uint64_t hostMebibytes) const
+    {
+        const auto heap = std::to_string(heapMebibytes(hostMebibytes)) + "M";
+        std::vector<std::string> arguments{"-Xms" + heap, "-Xmx" + heap};
+        const auto collectorFlags = collectorArguments();
+        arguments.insert(arguments.end(), collectorFlags.begin(), collectorFlags.end());
+        return arguments;
+    }
+
+    /**
+     * @brief A bash script that starts the jar in the "server" folder next to it.
+     */
+    std::string posixStartScript(std::string const& jar) const
+    {
+        std::string script = "#!/bin/bash\n"
+                             "cd server\n"
+                             "if [ -r /proc/meminfo ]; then\n"
+                             "    HOST_MIB=$(( $(awk '/^MemTotal:/ { print $2 }' /proc/meminfo) / 1024 ))\n"
+                             "else\n"
+                             "    HOST_MIB=$(( $(sysctl -n hw.memsize) / 1048576 ))\n"
+                             "fi\n";
+        script += "HEAP_MIB=$(( HOST_MIB * " + std::to_string(heapPercent) + " / 100 ))\n";
+        script += "[ \"$HEAP_MIB\" -lt " + std::to_string(minimumHeapMebibytes) +
+            " ] && HEAP_MIB=" + std::to_string(minimumHeapMebibytes) + "\n";
+        script += "[ \"$HEAP_MIB\" -gt " + std::to_string(maximumHeapMebibytes) +
+            " ] && HEAP_MIB=" + std::to_string(maximumHeapMebibytes) + "\n";
+
+        script += "exec ";
+        if (!cpus.empty())
+        {
+            std::string list;
+            for (auto cpu : cpus)
+                list += (list.empty() ? "" : ",") + std::to_string(cpu);
+            // taskset is part of util-linux, macOS has no way to pin.
+            script += "$(command -v taskset >/dev/null && echo taskset -c " + list + ") ";
+        }
+        script += "java -Xms${HEAP_MIB}M -Xmx${HEAP_MIB}M";
+        for (auto const& argument : collectorArguments())
+            script += " " + argument;
+        script += " -jar \"" + jar + "\"\n";
+        return script;
+    }
+
+    /**
+     * @brief A batch script that starts the jar in the "server" folder next to it.
+     */
+    std::string windowsStartScript(std::string const& jar) const
+    {
+        std::string script = "@echo off\r\n"
+                             "cd server\r\n"
+                             "for /f %%m in ('powershell -NoProfile -Command "
+                             "\"[math]::Floor((Get-CimInstance Win32_ComputerSystem).TotalPhysicalMemory / 1MB)\"') "
+                             "do set HOST_MIB=%%m\r\n";
+        script += "set /a HEAP_MIB=HOST_MIB * " + std::to_string(heapPercent) + " / 100\r\n";
+        script += "if %HEAP_MIB% LSS " + std::to_string(minimumHeapMebibytes) +
+            " set HEAP_MIB=" + std::to_string(minimumHeapMebibytes) + "\r\n";
+        script += "if %HEAP_MIB% GTR " + std::to_string(maximumHeapMebibytes) +
+            " set HEAP_MIB=" + std::to_string(maximumHeapMebibytes) + "\r\n";
+
+        script += "start \"\" ";
+        if (const auto mask = affinityMask(); mask != 0)
+        {
+            constexpr char const* hexDigits = "0123456789ABCDEF";
+            std::string hex;
+            for (auto rest = mask; rest != 0; rest >>= 4)
+                hex.insert(hex.begin(), hexDigits[rest & 0xF]);
+            script += "/affinity " + hex + " ";
+        }
+        script += "\"java\" -Xms%HEAP_MIB%M -Xmx%HEAP_MIB%M";
+        for (auto const& argument : collectorArguments())
+            script += " " + argument;
+        script += " -jar \"" + jar + "\"\r\n";
+        return script;
+    }
+
+    /**
+     * @brief The cpus as bit mask, Windows only pins to the first 64.
+     */
+    std::uint64_t affinityMask() const
+    {
+        std::uint64_t mask = 0;
+        for (auto cpu : cpus)
+        {
+            if (cpu < 64)
+                mask |= std::uint64_t{1} << cpu;
+        }
+        return mask;
+    }
+};
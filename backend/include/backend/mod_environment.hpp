@@ -0,0 +1,44 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+
+/**
+ * @brief Where a mod has to be installed. Client only mods (shaders, minimaps, HUDs) stay out of the server and server
+ * only mods are not shipped to players.
+ */
+enum class ModEnvironment
+{
+    Both,
+    Client,
+    Server
+};
+
+std::string toString(ModEnvironment environment);
+
+/**
+ * @brief Parses "client", "server" or "both". Anything else, including an empty string, is unknown.
+ */
+std::optional<ModEnvironment> modEnvironmentFromString(std::string const& environment);
+
+/**
+ * @brief Classifies a mod from modrinths client_side and server_side fields ("required", "optional", "unsupported"
+ * or "unknown"). Returns std::nullopt if neither side rules anything out.
+ */
+std::optional<ModEnvironment> modEnvironmentFromModrinth(std::string const& clientSide, std::string const& serverSide);
+
+/**
+ * @brief Reads the "environment" of the fabric.mod.json inside the jar. Returns std::nullopt if the jar has none.
+ */
+std::optional<ModEnvironment> modEnvironmentFromJar(std::filesystem::path const& jar);
+
+inline bool belongsToClient(ModEnvironment environment)
+{
+    return environment != ModEnvironment::Server;
+}
+
+inline bool belongsToServer(ModEnvironment environment)
+{
+    return environment != ModEnvironment::Client;
+}
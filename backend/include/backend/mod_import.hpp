@@ -0,0 +1,44 @@
+#pragma once
+
+#include <backend/pack_file.hpp>
+#include <backend/tracer.hpp>
+
+#include <nlohmann/json.hpp>
+#include <nui/backend/rpc_hub.hpp>
+
+#include <filesystem>
+#include <optional>
+
+/**
+ * @brief Adopts an existing mods folder into a pack by identifying every jar through its hash instead of searching
+ * for each mod by name.
+ */
+class ModImport
+{
+  public:
+    /**
+     * @brief Use without rpc bindings, for instance from the headless command line.
+     */
+    ModImport() = default;
+    ModImport(Nui::RpcHub& hub, Tracer& tracer);
+
+    /**
+     * @brief Hashes all jars in modsDirectory in parallel, identifies them with one bulk lookup and adds the
+     * identified mods with their installed versions to the loaded pack, which is saved afterwards. The jars are copied
+     * into the client and server mods folders of the pack.
+     *
+     * @param localIndex Optional file to identify the jars with instead of modrinth. It has the shape of the
+     * response of POST /v2/version_files: An object of sha1 to version. A version may carry a "project" object with
+     * "title", "slug", "client_side" and "server_side", otherwise the version name and project id are used and the
+     * environment is read from the jar.
+     * @param jobs Number of hashing threads, 0 uses the core count.
+     *
+     * @return Summary with the number of imported mods and the file names that could not be identified.
+     */
+    nlohmann::json importFolder(
+        PackFile& pack,
+        std::filesystem::path const& modsDirectory,
+        std::optional<std::filesystem::path> const& localIndex,
+        unsigned int jobs,
+        Tracer::Span& span);
+};
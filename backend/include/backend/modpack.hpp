@@ -1,7 +1,11 @@
 #pragma once
 
+#include <backend/mod_environment.hpp>
+#include <backend/tracer.hpp>
+
 #include <filesystem>
 #include <nui/backend/rpc_hub.hpp>
+#include <optional>
 #include <string>
 
 class ModPack
@@ -10,16 +14,27 @@ class ModPack
     constexpr static char const* linuxLauncherUrl = "https://launcher.mojang.com/download/Minecraft.tar.gz";
     constexpr static char const* windowsLauncherUrl = "https://launcher.mojang.com/download/Minecraft.exe";
 
-    ModPack(Nui::RpcHub& hub);
+    /**
+     * @brief Use without rpc bindings, for instance from the headless command line.
+     */
+    ModPack() = default;
+    ModPack(Nui::RpcHub& hub, Tracer& tracer);
 
-  private:
     bool downloadLinuxLauncher(std::filesystem::path const& whereTo);
     bool downloadWindowsLauncher(std::filesystem::path const& whereTo);
-    bool installMod(
+    /**
+     * @brief Downloads the mod and places it into the client and/or server mods folder.
+     *
+     * @param environment Where the mod belongs. If unknown, the fabric.mod.json of the jar decides.
+     * @return The environment the mod was installed for, std::nullopt if the download failed.
+     */
+    std::optional<ModEnvironment> installMod(
         std::filesystem::path const& basePath,
         std::string const& name,
         std::string const& previousName,
-        std::string const& url);
+        std::string const& url,
+        std::optional<ModEnvironment> environment,
+        Tracer::Span& span);
     bool removeMod(std::filesystem::path const& basePath, std::string const& name);
     bool deployPack(std::filesystem::path const& packPath);
     bool copyExternals(std::filesystem::path const& packPath);
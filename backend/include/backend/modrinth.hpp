@@ -0,0 +1,44 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Minimal blocking modrinth client for the backend. Responses are returned as raw json in the shape
+ * documented at https://docs.modrinth.com/api.
+ */
+namespace Modrinth
+{
+    constexpr static char const* apiBaseUrl = "https://api.modrinth.com/v2";
+
+    std::optional<nlohmann::json> getVersion(std::string const& versionId);
+
+    /**
+     * @brief All versions of a project for the loader and game versions, newest first.
+     */
+    std::optional<nlohmann::json> getProjectVersions(
+        std::string const& idOrSlug,
+        std::string const& loader,
+        std::vector<std::string> const& gameVersions);
+
+    /**
+     * @brief Bulk lookup of versions by file hash (POST /version_files). Returns an object of hash to version, hashes
+     * that are unknown to modrinth are missing.
+     */
+    std::optional<nlohmann::json> getVersionsFromHashes(
+        std::vector<std::string> const& hashes,
+        std::string const& algorithm = "sha1");
+
+    /**
+     * @brief Bulk lookup of projects by id (GET /projects).
+     */
+    std::optional<nlohmann::json> getProjects(std::vector<std::string> const& ids);
+
+    /**
+     * @brief The primary file of a version, or the first file if none is marked primary.
+     */
+    nlohmann::json const* primaryFile(nlohmann::json const& version);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <backend/pack_file.hpp>
+#include <backend/tracer.hpp>
+
+#include <nlohmann/json.hpp>
+#include <nui/backend/rpc_hub.hpp>
+
+#include <filesystem>
+
+/**
+ * @brief Exports the pack in the modrinth modpack format (.mrpack): An index with path, size, hashes and download url
+ * of every mod that modrinth hosts. Only files that cannot be downloaded from there are packed as overrides.
+ * See https://docs.modrinth.com/modpacks/format.
+ */
+class MrPack
+{
+  public:
+    constexpr static char const* indexFileName = "modrinth.index.json";
+
+    /**
+     * @brief Use without rpc bindings, for instance from the headless command line.
+     */
+    MrPack() = default;
+    MrPack(Nui::RpcHub& hub, Tracer& tracer);
+
+    /**
+     * @brief Writes deployments/<timestamp>.mrpack and places the index as server/modrinth.index.json, where the
+     * update server picks it up to let clients download mods from their origin.
+     *
+     * @param jobs Number of hashing threads, 0 uses the core count.
+     * @return Summary with the path of the written file, the number of indexed files and of overrides.
+     */
+    nlohmann::json exportPack(PackFile const& pack, unsigned int jobs, Tracer::Span& span);
+};
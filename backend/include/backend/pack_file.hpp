@@ -0,0 +1,33 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <filesystem>
+#include <string>
+
+/**
+ * @brief Backend view of mcpackdev/modpack.json. The document is kept as json, so fields only the frontend knows
+ * about survive a load/save round trip.
+ */
+class PackFile
+{
+  public:
+    explicit PackFile(std::filesystem::path packPath);
+
+    /**
+     * @brief Loads the modpack.json of the pack. Throws if it does not exist or cannot be parsed.
+     */
+    void load();
+    void save() const;
+
+    nlohmann::json& mods();
+    nlohmann::json const& mods() const;
+    std::string minecraftVersion() const;
+    std::string modLoaderLowerCase() const;
+    std::filesystem::path const& packPath() const;
+    std::filesystem::path file() const;
+
+  private:
+    std::filesystem::path packPath_;
+    nlohmann::json document_;
+};
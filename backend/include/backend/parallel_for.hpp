@@ -0,0 +1,36 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Calls action(index) for every index in [0, count) on up to jobs threads and waits for all of them.
+ * Indices are handed out one at a time, so slow items do not hold up a whole batch.
+ *
+ * @param jobs Number of threads, 0 uses the core count.
+ * @return The number of threads that were used.
+ */
+template <typename FunctionT>
+unsigned int parallelFor(std::size_t count, unsigned int jobs, FunctionT&& action)
+{
+    if (jobs == 0)
+        jobs = std::max(1u, std::thread::hardware_concurrency());
+    const auto threadCount = std::max(1u, static_cast<unsigned int>(std::min<std::size_t>(jobs, count)));
+
+    std::atomic_size_t next{0};
+    auto worker = [&]() {
+        for (auto index = next++; index < count; index = next++)
+            action(index);
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < threadCount; ++i)
+        workers.emplace_back(worker);
+    worker();
+    for (auto& thread : workers)
+        thread.join();
+    return threadCount;
+}
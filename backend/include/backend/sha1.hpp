@@ -0,0 +1,14 @@
+#pragma once
+
+#include <update_server/hashing.hpp>
+
+#include <filesystem>
+#include <string>
+
+/**
+ * @brief Modrinth identifies files by sha1 (and sha512), so this is what mods are looked up by.
+ */
+[[maybe_unused]] static std::string sha1FromFile(std::filesystem::path const& source)
+{
+    return Hashing::hashFile(source, Hashing::Sha1).sha1;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <nui/backend/rpc_hub.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Collects timed spans of rpc calls from both sides of the bridge and exports them as a chrome trace. Only the
+ * most recent spans are kept, so a long session does not grow without bound.
+ */
+class Tracer
+{
+  public:
+    enum class Side
+    {
+        Frontend,
+        Backend
+    };
+
+    struct Event
+    {
+        std::string name;
+        Side side;
+        std::string responseId;
+        std::int64_t startMicroseconds;
+        std::int64_t durationMicroseconds;
+        std::uint64_t transferredBytes;
+        std::uint64_t threadId;
+    };
+
+    /**
+     * @brief Records a backend event from construction to destruction.
+     */
+    class Span
+    {
+      public:
+        Span(Tracer& tracer, std::string name, std::string responseId);
+        ~Span();
+        Span(Span const&) = delete;
+        Span& operator=(Span const&) = delete;
+
+        /**
+         * @brief Attribute bytes of a network transfer to this span.
+         */
+        void addTransferredBytes(std::uint64_t bytes);
+        std::uint64_t transferredBytes() const;
+
+      private:
+        Tracer* tracer_;
+        std::string name_;
+        std::string responseId_;
+        std::int64_t start_;
+        std::uint64_t transferredBytes_;
+    };
+
+  public:
+    /// At roughly 200 bytes each, the trace stays in the tens of megabytes.
+    constexpr static std::size_t maximumEvents = 100'000;
+
+  public:
+    Tracer();
+    explicit Tracer(Nui::RpcHub& hub);
+
+    Span span(std::string name, std::string responseId = {});
+    void record(Event event);
+    std::vector<Event> events() const;
+    void clear();
+
+    /**
+     * @brief Builds a chrome trace-event document (chrome://tracing, perfetto).
+     */
+    nlohmann::json chromeTrace() const;
+    void writeChromeTrace(std::filesystem::path const& path) const;
+
+    /**
+     * @brief Microseconds since the unix epoch, the same clock base the frontend uses.
+     */
+    static std::int64_t now();
+
+  private:
+    void registerRpc(Nui::RpcHub& hub);
+
+  private:
+    mutable std::mutex guard_;
+    /// Oldest first, the oldest is dropped once maximumEvents is reached.
+    std::deque<Event> events_;
+};
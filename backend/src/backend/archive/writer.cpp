@@ -48,11 +48,14 @@ namespace Archive
         }
     };
 
-    Writer::Writer(std::filesystem::path const& path)
+    Writer::Writer(std::filesystem::path const& path, Format format)
         : impl_{std::make_unique<Writer::Implementation>()}
     {
-        // Do not include PAX extensions if possible.
-        ::archive_write_set_format_pax_restricted(*impl_->archive_);
+        if (format == Format::Zip)
+            ::archive_write_set_format_zip(*impl_->archive_);
+        else
+            // Do not include PAX extensions if possible.
+            ::archive_write_set_format_pax_restricted(*impl_->archive_);
 #ifdef __WIN32
         auto error = ::archive_write_open_filename(*impl_->archive_, path.string().c_str());
 #else
@@ -101,6 +104,11 @@ namespace Archive
     }
 
     Error Writer::addFile(std::filesystem::path const& path)
+    {
+        return addFile(path, path.filename());
+    }
+
+    Error Writer::addFile(std::filesystem::path const& path, std::filesystem::path const& archivePath)
     {
         Entry entry;
         auto error = entry.setInformationFromFile(path);
@@ -108,6 +116,7 @@ namespace Archive
         {
             return error;
         }
+        entry.setPathname(archivePath);
         return impl_->writeEntry(entry, [&path](auto const& feeder) {
             std::ifstream reader{path.string(), std::ios_base::binary};
             std::string buffer(copyBufferSize, '\0');
@@ -0,0 +1,301 @@
+#include <backend/cli.hpp>
+
+#include <backend/fabric.hpp>
+#include <backend/mod_environment.hpp>
+#include <backend/mod_import.hpp>
+#include <backend/modpack.hpp>
+#include <backend/modrinth.hpp>
+#include <backend/mrpack.hpp>
+#include <backend/pack_file.hpp>
+#include <backend/parallel_for.hpp>
+#include <backend/tracer.hpp>
+
+#include <cxxopts.hpp>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    std::mutex outputGuard;
+
+    void printEvent(nlohmann::json const& event)
+    {
+        std::scoped_lock lock{outputGuard};
+        std::cout << event.dump() << "\n" << std::flush;
+    }
+
+    double millisecondsSince(std::int64_t startMicroseconds)
+    {
+        return static_cast<double>(Tracer::now() - startMicroseconds) / 1000.0;
+    }
+
+    /**
+     * @brief Runs the step inside a trace span and prints its result together with the elapsed time.
+     */
+    template <typename FunctionT>
+    nlohmann::json timed(Tracer& tracer, std::string const& eventName, FunctionT&& step)
+    {
+        const auto start = Tracer::now();
+        nlohmann::json result;
+        {
+            auto span = tracer.span(eventName);
+            try
+            {
+                result = step(span);
+            }
+            catch (std::exception const& e)
+            {
+                result = {{"success", false}, {"message", e.what()}};
+            }
+            result["bytes"] = span.transferredBytes();
+        }
+        result["event"] = eventName;
+        result["durationMs"] = millisecondsSince(start);
+        printEvent(result);
+        return result;
+    }
+
+    void bumpHistory(nlohmann::json& mod)
+    {
+        if (mod.value("installedName", "").empty())
+            return;
+        if (!mod.contains("history") || !mod["history"].is_array())
+            mod["history"] = nlohmann::json::array();
+        mod["history"].push_back({
+            {"name", mod.value("name", "")},
+            {"id", mod.value("id", "")},
+            {"slug", mod.value("slug", "")},
+            {"installedName", mod.value("installedName", "")},
+            {"installedTimestamp", mod.value("installedTimestamp", "")},
+            {"installedId", mod.value("installedId", "")},
+        });
+    }
+
+    /**
+     * @brief Installs the pinned version of a mod, or the newest one for the pack if none is pinned yet.
+     */
+    nlohmann::json installSingleMod(ModPack& modPack, PackFile const& pack, nlohmann::json& mod, Tracer::Span& span)
+    {
+        const auto installedId = mod.value("installedId", "");
+        const auto installedName = mod.value("installedName", "");
+        auto result = nlohmann::json{{"name", mod.value("name", "")}, {"id", mod.value("id", "")}};
+
+        const auto installedEnvironment = modEnvironmentFromString(mod.value("environment", ""));
+        const auto isPlaced = [&](std::string const& clientOrServer, bool belongs) {
+            return !belongs || std::filesystem::exists(pack.packPath() / clientOrServer / "mods" / installedName);
+        };
+        if (!installedId.empty() && !installedName.empty() && installedEnvironment &&
+            isPlaced("client", belongsToClient(*installedEnvironment)) &&
+            isPlaced("server", belongsToServer(*installedEnvironment)))
+        {
+            result["success"] = true;
+            result["cached"] = true;
+            return result;
+        }
+
+        std::optional<nlohmann::json> version;
+        if (!installedId.empty())
+            version = Modrinth::getVersion(installedId);
+        else
+        {
+            auto versions = Modrinth::getProjectVersions(
+                mod.value("id", ""), pack.modLoaderLowerCase(), {pack.minecraftVersion()});
+            if (versions && !versions->empty())
+                version = versions->front();
+        }
+        if (!version)
+        {
+            result["success"] = false;
+            result["message"] = "No matching version found.";
+            return result;
+        }
+
+        auto const* file = Modrinth::primaryFile(*version);
+        if (file == nullptr)
+        {
+            result["success"] = false;
+            result["message"] = "Version has no files.";
+            return result;
+        }
+
+        auto environment = modEnvironmentFromString(mod.value("environment", ""));
+        if (!environment)
+            environment = modEnvironmentFromModrinth(mod.value("clientSide", ""), mod.value("serverSide", ""));
+
+        const auto fileName = file->value("filename", "");
+        environment =
+            modPack.installMod(pack.packPath(), fileName, installedName, file->value("url", ""), environment, span);
+        if (!environment)
+        {
+            result["success"] = false;
+            result["message"] = "Mod download failed.";
+            return result;
+        }
+
+        if (installedId != version->value("id", ""))
+            bumpHistory(mod);
+        mod["installedName"] = fileName;
+        mod["installedTimestamp"] = version->value("date_published", "");
+        mod["installedId"] = version->value("id", "");
+        mod["environment"] = toString(*environment);
+
+        result["success"] = true;
+        result["cached"] = false;
+        result["file"] = fileName;
+        result["environment"] = toString(*environment);
+        return result;
+    }
+
+    nlohmann::json installAllMods(ModPack& modPack, PackFile& pack, Tracer& tracer, unsigned int jobs)
+    {
+        auto& mods = pack.mods();
+        std::atomic_size_t failed{0};
+
+        const auto threadCount = parallelFor(mods.size(), jobs, [&](std::size_t index) {
+            auto result = timed(tracer, "installMod", [&](Tracer::Span& span) {
+                return installSingleMod(modPack, pack, mods[index], span);
+            });
+            if (!result.value("success", false))
+                ++failed;
+        });
+
+        pack.save();
+        return {
+            {"success", failed == 0},
+            {"mods", mods.size()},
+            {"failed", failed.load()},
+            {"jobs", threadCount},
+        };
+    }
+}
+
+std::optional<CliOptions> parseCliOptions(int argc, char** argv)
+{
+    cxxopts::Options options("minecraft-modpack-maker", "Minecraft modpack maker");
+    // clang-format off
+    options.add_options()
+        ("headless", "Run pack operations without opening a window", cxxopts::value<bool>()->default_value("false"))
+        ("p,pack", "Pack directory", cxxopts::value<std::string>())
+        ("import", "Add all jars of this mods folder to the pack, identified by hash", cxxopts::value<std::string>())
+        ("import-index", "Identify imported jars with this file instead of modrinth", cxxopts::value<std::string>())
+        ("install-mods", "Resolve and install all mods of the pack", cxxopts::value<bool>()->default_value("false"))
+        ("install-loader", "Install the mod loader", cxxopts::value<bool>()->default_value("false"))
+        ("deploy", "Create a deployment of the pack", cxxopts::value<bool>()->default_value("false"))
+        ("export-mrpack", "Export the pack as .mrpack", cxxopts::value<bool>()->default_value("false"))
+        ("j,jobs", "Concurrent mod installs, 0 uses the core count", cxxopts::value<unsigned int>()->default_value("0"))
+        ("trace", "Write a chrome trace of the run to this file", cxxopts::value<std::string>())
+        ("h,help", "Print usage");
+    // clang-format on
+    options.allow_unrecognised_options();
+
+    auto result = options.parse(argc, argv);
+    if (result.count("help"))
+    {
+        std::cout << options.help() << "\n";
+        return CliOptions{.helpShown = true};
+    }
+    if (!result["headless"].as<bool>())
+        return std::nullopt;
+    if (!result.count("pack"))
+        throw std::invalid_argument("--pack is required in headless mode");
+
+    CliOptions cliOptions{
+        .packPath = result["pack"].as<std::string>(),
+        .installMods = result["install-mods"].as<bool>(),
+        .installLoader = result["install-loader"].as<bool>(),
+        .deploy = result["deploy"].as<bool>(),
+        .exportMrPack = result["export-mrpack"].as<bool>(),
+        .jobs = result["jobs"].as<unsigned int>(),
+    };
+    if (cliOptions.jobs == 0)
+        cliOptions.jobs = std::max(1u, std::thread::hardware_concurrency());
+    if (result.count("import"))
+        cliOptions.importDirectory = result["import"].as<std::string>();
+    if (result.count("import-index"))
+        cliOptions.importIndex = result["import-index"].as<std::string>();
+    if (result.count("trace"))
+        cliOptions.traceFile = result["trace"].as<std::string>();
+    return cliOptions;
+}
+
+int runHeadless(CliOptions const& options)
+{
+    const auto start = Tracer::now();
+    Tracer tracer;
+    ModPack modPack;
+    Fabric fabric;
+    ModImport modImport;
+    MrPack mrPack;
+    PackFile pack{options.packPath};
+    bool success = true;
+
+    success &= timed(tracer, "open", [&](Tracer::Span&) {
+                   pack.load();
+                   std::filesystem::create_directories(pack.packPath() / "client" / "mods");
+                   std::filesystem::create_directories(pack.packPath() / "server" / "mods");
+                   return nlohmann::json{
+                       {"success", true},
+                       {"pack", pack.packPath().string()},
+                       {"mods", pack.mods().size()},
+                       {"minecraftVersion", pack.minecraftVersion()},
+                       {"modLoader", pack.modLoaderLowerCase()},
+                   };
+               }).value("success", false);
+
+    if (success && options.importDirectory)
+    {
+        success &= timed(tracer, "import", [&](Tracer::Span& span) {
+                       return modImport.importFolder(
+                           pack, *options.importDirectory, options.importIndex, options.jobs, span);
+                   }).value("success", false);
+    }
+
+    if (success && options.installLoader)
+    {
+        success &= timed(tracer, "installLoader", [&](Tracer::Span& span) {
+                       if (pack.modLoaderLowerCase() != "fabric")
+                           return nlohmann::json{{"success", false}, {"message", "Only fabric is supported."}};
+                       std::filesystem::create_directories(pack.packPath() / "mcpackdev");
+                       const auto installed = fabric.installFabricInstaller(pack.packPath(), span) &&
+                           fabric.installFabric(pack.packPath(), pack.minecraftVersion());
+                       return nlohmann::json{{"success", installed}};
+                   }).value("success", false);
+    }
+
+    if (success && options.installMods)
+    {
+        success &= timed(tracer, "installMods", [&](Tracer::Span&) {
+                       return installAllMods(modPack, pack, tracer, options.jobs);
+                   }).value("success", false);
+    }
+
+    if (success && options.deploy)
+    {
+        success &= timed(tracer, "deploy", [&](Tracer::Span&) {
+                       return nlohmann::json{{"success", modPack.deployPack(pack.packPath())}};
+                   }).value("success", false);
+    }
+
+    if (success && options.exportMrPack)
+    {
+        success &= timed(tracer, "exportMrPack", [&](Tracer::Span& span) {
+                       return mrPack.exportPack(pack, options.jobs, span);
+                   }).value("success", false);
+    }
+
+    printEvent({
+        {"event", "total"},
+        {"success", success},
+        {"durationMs", millisecondsSince(start)},
+    });
+
+    if (options.traceFile)
+        tracer.writeChromeTrace(*options.traceFile);
+
+    return success ? 0 : 1;
+}
@@ -21,11 +21,12 @@ namespace
     };
 }
 
-Fabric::Fabric(Nui::RpcHub& hub)
+Fabric::Fabric(Nui::RpcHub& hub, Tracer& tracer)
 {
     hub.registerFunction(
         "fabricInstallStatus",
-        [&hub](std::string const& responseId, std::string const& path, std::string const& mcVersion) {
+        [&hub, &tracer](std::string const& responseId, std::string const& path, std::string const& mcVersion) {
+            auto span = tracer.span("fabricInstallStatus", responseId);
             auto versionsPath = std::filesystem::path{path} / "client" / "versions";
             if (!std::filesystem::exists(versionsPath))
             {
@@ -74,10 +75,11 @@ Fabric::Fabric(Nui::RpcHub& hub)
         });
     hub.registerFunction(
         "installFabric",
-        [&hub, this](std::string const& responseId, std::string const& path, std::string const& mcVersion) {
+        [&hub, &tracer, this](std::string const& responseId, std::string const& path, std::string const& mcVersion) {
+            auto span = tracer.span("installFabric", responseId);
             try
             {
-                if (!installFabricInstaller(path))
+                if (!installFabricInstaller(path, span))
                 {
                     hub.callRemote(
                         responseId,
@@ -108,13 +110,14 @@ Fabric::Fabric(Nui::RpcHub& hub)
             }
         });
 }
-bool Fabric::installFabricInstaller(std::filesystem::path const& whereTo)
+bool Fabric::installFabricInstaller(std::filesystem::path const& whereTo, Tracer::Span& span)
 {
     using namespace std::string_literals;
 
     std::stringstream mavenXml{};
     Roar::Curl::Request{}.followRedirects(true).sink(mavenXml).verifyPeer(false).verifyHost(false).get(
         std::string{mainPageBaseUrl} + "/maven-metadata.xml");
+    span.addTransferredBytes(mavenXml.str().size());
     boost::property_tree::ptree tree;
     mavenXml.seekg(0);
     boost::property_tree::read_xml(mavenXml, tree);
@@ -147,6 +150,15 @@ bool Fabric::installFabricInstaller(std::filesystem::path const& whereTo)
         .verifyHost(false)
         .sink(whereTo / "mcpackdev" / "fabric-installer-windows.exe")
         .get(std::string{mainPageBaseUrl} + "/" + latest + "/" + (baseName + ".exe"));
+
+    for (auto const& installer :
+         {"fabric-installer.jar", "fabric-installer-server.jar", "fabric-installer-windows.exe"})
+    {
+        std::error_code ec;
+        const auto size = std::filesystem::file_size(whereTo / "mcpackdev" / installer, ec);
+        if (!ec)
+            span.addTransferredBytes(size);
+    }
     return true;
 }
 bool Fabric::installFabric(std::filesystem::path const& whereTo, std::string const& mcVersion)
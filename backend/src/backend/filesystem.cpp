@@ -4,17 +4,18 @@
 
 #include <fstream>
 
-void FileSystem::registerAll(Nui::RpcHub const& hub)
+void FileSystem::registerAll(Nui::RpcHub const& hub, Tracer& tracer)
 {
-    registerReadFile(hub);
-    registerWriteFile(hub);
-    registerCreateDirectory(hub);
-    registerFileExists(hub);
-    registerGetPackDevHome(hub);
+    registerReadFile(hub, tracer);
+    registerWriteFile(hub, tracer);
+    registerCreateDirectory(hub, tracer);
+    registerFileExists(hub, tracer);
+    registerGetPackDevHome(hub, tracer);
 }
-void FileSystem::registerReadFile(Nui::RpcHub const& hub)
+void FileSystem::registerReadFile(Nui::RpcHub const& hub, Tracer& tracer)
 {
-    hub.registerFunction("readFile", [&hub](std::string const& responseId, std::string const& path) {
+    hub.registerFunction("readFile", [&hub, &tracer](std::string const& responseId, std::string const& path) {
+        auto span = tracer.span("readFile", responseId);
         try
         {
             std::ifstream file(path, std::ios_base::binary);
@@ -51,10 +52,12 @@ void FileSystem::registerReadFile(Nui::RpcHub const& hub)
         }
     });
 }
-void FileSystem::registerWriteFile(Nui::RpcHub const& hub)
+void FileSystem::registerWriteFile(Nui::RpcHub const& hub, Tracer& tracer)
 {
     hub.registerFunction(
-        "writeFile", [&hub](std::string const& responseId, std::string const& path, std::string const& data) {
+        "writeFile",
+        [&hub, &tracer](std::string const& responseId, std::string const& path, std::string const& data) {
+            auto span = tracer.span("writeFile", responseId);
             try
             {
                 std::ofstream file(path, std::ios_base::binary);
@@ -87,9 +90,10 @@ void FileSystem::registerWriteFile(Nui::RpcHub const& hub)
             }
         });
 }
-void FileSystem::registerGetPackDevHome(Nui::RpcHub const& hub)
+void FileSystem::registerGetPackDevHome(Nui::RpcHub const& hub, Tracer& tracer)
 {
-    hub.registerFunction("getPackDevHome", [&hub](std::string const& responseId) {
+    hub.registerFunction("getPackDevHome", [&hub, &tracer](std::string const& responseId) {
+        auto span = tracer.span("getPackDevHome", responseId);
         const auto resolved = Nui::resolvePath("~/.mcpackdev");
         if (!std::filesystem::exists(resolved))
             std::filesystem::create_directory(resolved);
@@ -102,9 +106,10 @@ void FileSystem::registerGetPackDevHome(Nui::RpcHub const& hub)
             });
     });
 }
-void FileSystem::registerCreateDirectory(Nui::RpcHub const& hub)
+void FileSystem::registerCreateDirectory(Nui::RpcHub const& hub, Tracer& tracer)
 {
-    hub.registerFunction("createDirectory", [&hub](std::string const& responseId, std::string const& path) {
+    hub.registerFunction("createDirectory", [&hub, &tracer](std::string const& responseId, std::string const& path) {
+        auto span = tracer.span("createDirectory", responseId);
         try
         {
             std::filesystem::create_directory(path);
@@ -125,9 +130,10 @@ void FileSystem::registerCreateDirectory(Nui::RpcHub const& hub)
         }
     });
 }
-void FileSystem::registerFileExists(Nui::RpcHub const& hub)
+void FileSystem::registerFileExists(Nui::RpcHub const& hub, Tracer& tracer)
 {
-    hub.registerFunction("fileExists", [&hub](std::string const& responseId, std::string const& path) {
+    hub.registerFunction("fileExists", [&hub, &tracer](std::string const& responseId, std::string const& path) {
+        auto span = tracer.span("fileExists", responseId);
         try
         {
             hub.callRemote(
@@ -1,7 +1,11 @@
+#include <backend/cli.hpp>
 #include <backend/executeable_path.hpp>
 #include <backend/fabric.hpp>
 #include <backend/filesystem.hpp>
+#include <backend/mod_import.hpp>
 #include <backend/modpack.hpp>
+#include <backend/mrpack.hpp>
+#include <backend/tracer.hpp>
 
 #include <nui/backend/rpc_hub.hpp>
 #include <nui/core.hpp>
@@ -22,6 +26,21 @@ int main(int argc, char** argv)
     using namespace Nui;
     using namespace std::string_literals;
 
+    std::optional<CliOptions> cliOptions;
+    try
+    {
+        cliOptions = parseCliOptions(argc, argv);
+    }
+    catch (std::exception const& e)
+    {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    if (cliOptions && cliOptions->helpShown)
+        return 0;
+    if (cliOptions)
+        return runHeadless(*cliOptions);
+
     // Set verbosity to true
     pfd::settings::verbose(true);
 
@@ -37,9 +56,12 @@ int main(int argc, char** argv)
         "assets", (getExecuteablePath().parent_path() / "assets").string(), HostResourceAccessKind::Allow);
 
     RpcHub hub{window};
-    ModPack launcherTools{hub};
-    Fabric fabricTools{hub};
-    FileSystem::registerAll(hub);
+    Tracer tracer{hub};
+    ModPack launcherTools{hub, tracer};
+    Fabric fabricTools{hub, tracer};
+    ModImport modImport{hub, tracer};
+    MrPack mrPack{hub, tracer};
+    FileSystem::registerAll(hub, tracer);
     hub.enableAll();
     window.run();
 }
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include <backend/mod_environment.hpp>
+
+#include <backend/archive/archive.hpp>
+
+#include <archive_entry.h>
+#include <nlohmann/json.hpp>
+
+#include <string_view>
+
+std::string toString(ModEnvironment environment)
+{
+    switch (environment)
+    {
+        case (ModEnvironment::Client):
+            return "client";
+        case (ModEnvironment::Server):
+            return "server";
+        default:
+            return "both";
+    }
+}
+
+std::optional<ModEnvironment> modEnvironmentFromString(std::string const& environment)
+{
+    if (environment == "client")
+        return ModEnvironment::Client;
+    if (environment == "server")
+        return ModEnvironment::Server;
+    if (environment == "both")
+        return ModEnvironment::Both;
+    return std::nullopt;
+}
+
+std::optional<ModEnvironment> modEnvironmentFromModrinth(std::string const& clientSide, std::string const& serverSide)
+{
+    if (serverSide == "unsupported" && clientSide != "unsupported")
+        return ModEnvironment::Client;
+    if (clientSide == "unsupported" && serverSide != "unsupported")
+        return ModEnvironment::Server;
+    if (clientSide == "required" && serverSide == "required")
+        return ModEnvironment::Both;
+    return std::nullopt;
+}
+
+std::optional<ModEnvironment> modEnvironmentFromJar(std::filesystem::path const& jar)
+{
+    Archive::ArchiveReader archive;
+    ::archive_read_support_format_zip(archive);
+    if (::archive_read_open_filename(archive, jar.string().c_str(), 65536) != ARCHIVE_OK)
+        return std::nullopt;
+
+    ::archive_entry* entry = nullptr;
+    while (::archive_read_next_header(archive, &entry) == ARCHIVE_OK)
+    {
+        if (std::string_view{::archive_entry_pathname(entry)} != "fabric.mod.json")
+            continue;
+
+        std::string content;
+        char buffer[4096];
+        for (la_ssize_t amount; (amount = ::archive_read_data(archive, buffer, sizeof(buffer))) > 0;)
+            content.append(buffer, static_cast<std::size_t>(amount));
+
+        const auto modJson = nlohmann::json::parse(content, nullptr, false);
+        if (modJson.is_discarded() || !modJson.is_object())
+            return std::nullopt;
+        const auto environment = modJson.value("environment", "*");
+        if (environment == "client")
+            return ModEnvironment::Client;
+        if (environment == "server")
+            return ModEnvironment::Server;
+        return ModEnvironment::Both;
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,234 @@
+#include <backend/mod_import.hpp>
+
+#include <backend/mod_environment.hpp>
+#include <backend/modrinth.hpp>
+#include <backend/parallel_for.hpp>
+#include <backend/sha1.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+    struct ModFile
+    {
+        std::filesystem::path path;
+        std::string sha1;
+    };
+
+    std::vector<ModFile> findJars(std::filesystem::path const& modsDirectory)
+    {
+        std::vector<ModFile> jars;
+        for (auto const& entry : std::filesystem::directory_iterator{modsDirectory})
+        {
+            if (entry.is_regular_file() && entry.path().extension() == ".jar")
+                jars.push_back({.path = entry.path(), .sha1 = {}});
+        }
+        std::sort(jars.begin(), jars.end(), [](auto const& a, auto const& b) {
+            return a.path.filename() < b.path.filename();
+        });
+        return jars;
+    }
+
+    void hashAll(std::vector<ModFile>& jars, unsigned int jobs, Tracer::Span& span)
+    {
+        std::atomic_uint64_t bytes{0};
+        parallelFor(jars.size(), jobs, [&](std::size_t index) {
+            jars[index].sha1 = sha1FromFile(jars[index].path);
+            bytes += std::filesystem::file_size(jars[index].path);
+        });
+        span.addTransferredBytes(bytes);
+    }
+
+    nlohmann::json readLocalIndex(std::filesystem::path const& file)
+    {
+        std::ifstream reader{file, std::ios_base::binary};
+        if (!reader.good())
+            throw std::runtime_error("Could not open mod index: " + file.string());
+        auto index = nlohmann::json::parse(reader);
+        if (!index.is_object())
+            throw std::runtime_error("Mod index must map hashes to versions: " + file.string());
+        return index;
+    }
+
+    /**
+     * @brief Collects title and slug for every project of the identified versions, keyed by project id.
+     */
+    std::unordered_map<std::string, nlohmann::json> resolveProjects(nlohmann::json const& versions, bool remote)
+    {
+        std::unordered_map<std::string, nlohmann::json> projects;
+        std::set<std::string> missing;
+        for (auto const& [hash, version] : versions.items())
+        {
+            const auto projectId = version.value("project_id", "");
+            if (version.contains("project"))
+                projects[projectId] = version["project"];
+            else
+                missing.insert(projectId);
+        }
+        if (!remote || missing.empty())
+            return projects;
+
+        auto fetched = Modrinth::getProjects({missing.begin(), missing.end()});
+        if (!fetched)
+            throw std::runtime_error("Could not load project information from modrinth.");
+        for (auto const& project : *fetched)
+            projects[project.value("id", "")] = project;
+        return projects;
+    }
+
+    void copyInto(std::filesystem::path const& jar, std::filesystem::path const& modsDirectory)
+    {
+        std::filesystem::create_directories(modsDirectory);
+        const auto target = modsDirectory / jar.filename();
+        if (std::filesystem::exists(target) && std::filesystem::equivalent(jar, target))
+            return;
+        std::filesystem::copy_file(jar, target, std::filesystem::copy_options::overwrite_existing);
+    }
+}
+
+ModImport::ModImport(Nui::RpcHub& hub, Tracer& tracer)
+{
+    hub.registerFunction(
+        "importMods",
+        [&hub, &tracer, this](
+            std::string const& responseId,
+            std::string const& packPath,
+            std::string const& modsDirectory,
+            std::string const& localIndex) {
+            auto span = tracer.span("importMods", responseId);
+            try
+            {
+                PackFile pack{packPath};
+                pack.load();
+                auto result = importFolder(
+                    pack,
+                    modsDirectory,
+                    localIndex.empty() ? std::nullopt : std::optional<std::filesystem::path>{localIndex},
+                    0,
+                    span);
+                hub.callRemote(responseId, result);
+            }
+            catch (std::exception const& e)
+            {
+                hub.callRemote(
+                    responseId,
+                    nlohmann::json{
+                        {"success", false},
+                        {"message", e.what()},
+                    });
+            }
+        });
+}
+
+nlohmann::json ModImport::importFolder(
+    PackFile& pack,
+    std::filesystem::path const& modsDirectory,
+    std::optional<std::filesystem::path> const& localIndex,
+    unsigned int jobs,
+    Tracer::Span& span)
+{
+    auto jars = findJars(modsDirectory);
+    hashAll(jars, jobs, span);
+
+    std::vector<std::string> hashes;
+    hashes.reserve(jars.size());
+    for (auto const& jar : jars)
+        hashes.push_back(jar.sha1);
+
+    std::optional<nlohmann::json> versions;
+    if (localIndex)
+        versions = readLocalIndex(*localIndex);
+    else
+        versions = Modrinth::getVersionsFromHashes(hashes);
+    if (!versions)
+        throw std::runtime_error("Could not identify mods through modrinth.");
+
+    const auto projects = resolveProjects(*versions, !localIndex);
+
+    auto& mods = pack.mods();
+    std::unordered_map<std::string, std::size_t> modIndex;
+    for (std::size_t i = 0; i != mods.size(); ++i)
+        modIndex[mods[i].value("id", "")] = i;
+
+    auto unidentified = nlohmann::json::array();
+    std::size_t imported = 0;
+    std::size_t alreadyPresent = 0;
+    for (auto const& jar : jars)
+    {
+        const auto fileName = jar.path.filename().string();
+        if (!versions->contains(jar.sha1))
+        {
+            unidentified.push_back(fileName);
+            continue;
+        }
+
+        auto const& version = (*versions)[jar.sha1];
+        const auto projectId = version.value("project_id", "");
+        const auto existing = modIndex.find(projectId);
+        if (existing != modIndex.end() && !mods[existing->second].value("installedId", "").empty())
+        {
+            ++alreadyPresent;
+            continue;
+        }
+
+        auto project = nlohmann::json::object();
+        if (auto it = projects.find(projectId); it != projects.end())
+            project = it->second;
+
+        const auto clientSide = project.value("client_side", "");
+        const auto serverSide = project.value("server_side", "");
+        auto environment = modEnvironmentFromModrinth(clientSide, serverSide);
+        if (!environment)
+            environment = modEnvironmentFromJar(jar.path).value_or(ModEnvironment::Both);
+
+        if (belongsToClient(*environment))
+            copyInto(jar.path, pack.packPath() / "client" / "mods");
+        if (belongsToServer(*environment))
+            copyInto(jar.path, pack.packPath() / "server" / "mods");
+
+        nlohmann::json mod{
+            {"name", project.value("title", version.value("name", fileName))},
+            {"id", projectId},
+            {"slug", project.value("slug", projectId)},
+            {"installedName", fileName},
+            {"installedTimestamp", version.value("date_published", "")},
+            {"logoPng64", ""},
+            {"newestTimestamp", version.value("date_published", "")},
+            {"installedId", version.value("id", "")},
+            {"history", nlohmann::json::array()},
+            {"clientSide", clientSide},
+            {"serverSide", serverSide},
+            {"environment", toString(*environment)},
+        };
+        if (existing != modIndex.end())
+        {
+            // Listed but never installed, keep the logo that was fetched when it was added.
+            mod["logoPng64"] = mods[existing->second].value("logoPng64", "");
+            mods[existing->second] = std::move(mod);
+        }
+        else
+        {
+            modIndex[projectId] = mods.size();
+            mods.push_back(std::move(mod));
+        }
+        ++imported;
+    }
+
+    std::sort(mods.begin(), mods.end(), [](auto const& a, auto const& b) {
+        return a.value("name", "") < b.value("name", "");
+    });
+    pack.save();
+
+    return {
+        {"success", true},
+        {"files", jars.size()},
+        {"imported", imported},
+        {"alreadyPresent", alreadyPresent},
+        {"unidentified", unidentified},
+    };
+}
@@ -1,5 +1,6 @@
 #include <backend/modpack.hpp>
 
+#include <backend/pack_file.hpp>
 #include <backend/tar_extractor_sink.hpp>
 
 #include <roar/curl/request.hpp>
@@ -7,51 +8,65 @@
 #include <chrono>
 #include <fstream>
 #include <iomanip>
+#include <set>
 #include <sstream>
 
-ModPack::ModPack(Nui::RpcHub& hub)
+ModPack::ModPack(Nui::RpcHub& hub, Tracer& tracer)
 {
-    hub.registerFunction("installLaunchers", [&hub, this](std::string const& responseId, std::string const& path) {
-        try
-        {
-            if (!downloadLinuxLauncher(path))
+    hub.registerFunction(
+        "installLaunchers", [&hub, &tracer, this](std::string const& responseId, std::string const& path) {
+            auto span = tracer.span("installLaunchers", responseId);
+            try
             {
-                hub.callRemote(responseId, nlohmann::json{{"success", false}, {"message", "Linux download failed."}});
-                return;
+                if (!downloadLinuxLauncher(path))
+                {
+                    hub.callRemote(
+                        responseId, nlohmann::json{{"success", false}, {"message", "Linux download failed."}});
+                    return;
+                }
+                if (!downloadWindowsLauncher(path))
+                {
+                    hub.callRemote(
+                        responseId, nlohmann::json{{"success", false}, {"message", "Windows download failed."}});
+                    return;
+                }
+                hub.callRemote(
+                    responseId,
+                    nlohmann::json{
+                        {"success", true},
+                    });
             }
-            if (!downloadWindowsLauncher(path))
+            catch (std::exception const& e)
             {
-                hub.callRemote(responseId, nlohmann::json{{"success", false}, {"message", "Windows download failed."}});
-                return;
+                hub.callRemote(
+                    responseId,
+                    nlohmann::json{
+                        {"success", false},
+                        {"message", e.what()},
+                    });
             }
-            hub.callRemote(
-                responseId,
-                nlohmann::json{
-                    {"success", true},
-                });
-        }
-        catch (std::exception const& e)
-        {
-            hub.callRemote(
-                responseId,
-                nlohmann::json{
-                    {"success", false},
-                    {"message", e.what()},
-                });
-        }
-    });
+        });
 
     hub.registerFunction(
         "installMod",
-        [&hub, this](
+        [&hub, &tracer, this](
             std::string const& responseId,
             std::string const& basePath,
             std::string const& name,
             std::string const& previousName,
-            std::string const& url) {
+            std::string const& url,
+            std::string const& environment,
+            std::string const& clientSide,
+            std::string const& serverSide) {
+            auto span = tracer.span("installMod", responseId);
             try
             {
-                if (!installMod(basePath, name, previousName, url))
+                auto knownEnvironment = modEnvironmentFromString(environment);
+                if (!knownEnvironment)
+                    knownEnvironment = modEnvironmentFromModrinth(clientSide, serverSide);
+
+                const auto installedFor = installMod(basePath, name, previousName, url, knownEnvironment, span);
+                if (!installedFor)
                 {
                     hub.callRemote(responseId, nlohmann::json{{"success", false}, {"message", "Mod download failed."}});
                     return;
@@ -60,6 +75,7 @@ ModPack::ModPack(Nui::RpcHub& hub)
                     responseId,
                     nlohmann::json{
                         {"success", true},
+                        {"environment", toString(*installedFor)},
                     });
             }
             catch (std::exception const& e)
@@ -73,7 +89,8 @@ ModPack::ModPack(Nui::RpcHub& hub)
             }
         });
 
-    hub.registerFunction("deploy", [&hub, this](std::string const& responseId, std::string const& packPath) {
+    hub.registerFunction("deploy", [&hub, &tracer, this](std::string const& responseId, std::string const& packPath) {
+        auto span = tracer.span("deploy", responseId);
         try
         {
             if (!deployPack(packPath))
@@ -100,7 +117,8 @@ ModPack::ModPack(Nui::RpcHub& hub)
 
     hub.registerFunction(
         "removeMod",
-        [&hub, this](std::string const& responseId, std::string const& packPath, std::string const& modName) {
+        [&hub, &tracer, this](std::string const& responseId, std::string const& packPath, std::string const& modName) {
+            auto span = tracer.span("removeMod", responseId);
             try
             {
                 if (!removeMod(packPath, modName))
@@ -125,30 +143,33 @@ ModPack::ModPack(Nui::RpcHub& hub)
             }
         });
 
-    hub.registerFunction("copyExternals", [&hub, this](std::string const& responseId, std::string const& packPath) {
-        try
-        {
-            if (!copyExternals(packPath))
+    hub.registerFunction(
+        "copyExternals", [&hub, &tracer, this](std::string const& responseId, std::string const& packPath) {
+            auto span = tracer.span("copyExternals", responseId);
+            try
             {
-                hub.callRemote(responseId, nlohmann::json{{"success", false}, {"message", "Copy externals failed."}});
-                return;
+                if (!copyExternals(packPath))
+                {
+                    hub.callRemote(
+                        responseId, nlohmann::json{{"success", false}, {"message", "Copy externals failed."}});
+                    return;
+                }
+                hub.callRemote(
+                    responseId,
+                    nlohmann::json{
+                        {"success", true},
+                    });
             }
-            hub.callRemote(
-                responseId,
-                nlohmann::json{
-                    {"success", true},
-                });
-        }
-        catch (std::exception const& e)
-        {
-            hub.callRemote(
-                responseId,
-                nlohmann::json{
-                    {"success", false},
-                    {"message", e.what()},
-                });
-        }
-    });
+            catch (std::exception const& e)
+            {
+                hub.callRemote(
+                    responseId,
+                    nlohmann::json{
+                        {"success", false},
+                        {"message", e.what()},
+                    });
+            }
+        });
 }
 bool ModPack::copyExternals(std::filesystem::path const& packPath)
 {
@@ -158,14 +179,19 @@ bool ModPack::copyExternals(std::filesystem::path const& packPath)
 
     for (auto const& entry : std::filesystem::directory_iterator(externalsPath))
     {
-        std::filesystem::copy_file(
-            entry.path(),
-            packPath / "client" / "mods" / entry.path().filename(),
-            std::filesystem::copy_options::overwrite_existing);
-        std::filesystem::copy_file(
-            entry.path(),
-            packPath / "server" / "mods" / entry.path().filename(),
-            std::filesystem::copy_options::overwrite_existing);
+        const auto environment = modEnvironmentFromJar(entry.path()).value_or(ModEnvironment::Both);
+        const auto clientMod = packPath / "client" / "mods" / entry.path().filename();
+        const auto serverMod = packPath / "server" / "mods" / entry.path().filename();
+
+        if (belongsToClient(environment))
+            std::filesystem::copy_file(entry.path(), clientMod, std::filesystem::copy_options::overwrite_existing);
+        else
+            std::filesystem::remove(clientMod);
+
+        if (belongsToServer(environment))
+            std::filesystem::copy_file(entry.path(), serverMod, std::filesystem::copy_options::overwrite_existing);
+        else
+            std::filesystem::remove(serverMod);
     }
     return true;
 }
@@ -175,20 +201,33 @@ bool ModPack::removeMod(std::filesystem::path const& basePath, std::string const
     std::filesystem::remove(basePath / "server" / "mods" / name);
     return true;
 }
-bool ModPack::installMod(
+std::optional<ModEnvironment> ModPack::installMod(
     std::filesystem::path const& basePath,
     std::string const& name,
     std::string const& previousName,
-    std::string const& url)
+    std::string const& url,
+    std::optional<ModEnvironment> environment,
+    Tracer::Span& span)
 {
+    const auto temporary = basePath / (name + ".Mtemp");
     {
-        std::ofstream writer{basePath / (name + ".Mtemp"), std::ios::binary};
-        auto response =
-            Roar::Curl::Request{}.followRedirects(true).verifyPeer(false).verifyHost(false).sink(writer).get(url);
+        std::ofstream writer{temporary, std::ios::binary};
+        auto response = Roar::Curl::Request{}
+                            .followRedirects(true)
+                            .verifyPeer(false)
+                            .verifyHost(false)
+                            .sink([&writer, &span](char const* buffer, std::size_t amount) {
+                                writer.write(buffer, static_cast<std::streamsize>(amount));
+                                span.addTransferredBytes(amount);
+                            })
+                            .get(url);
         if (response.code() != boost::beast::http::status::ok)
-            return false;
+            return std::nullopt;
     }
 
+    if (!environment)
+        environment = modEnvironmentFromJar(temporary).value_or(ModEnvironment::Both);
+
     auto backupModFor = [&](std::string const& clientOrServer) {
         if (!previousName.empty())
         {
@@ -215,10 +254,12 @@ bool ModPack::installMod(
     if (std::filesystem::exists(basePath / "server" / "mods" / name))
         std::filesystem::remove(basePath / "server" / "mods" / name);
 
-    std::filesystem::copy_file(basePath / (name + ".Mtemp"), basePath / "client" / "mods" / name);
-    std::filesystem::copy_file(basePath / (name + ".Mtemp"), basePath / "server" / "mods" / name);
-    std::filesystem::remove(basePath / (name + ".Mtemp"));
-    return true;
+    if (belongsToClient(*environment))
+        std::filesystem::copy_file(temporary, basePath / "client" / "mods" / name);
+    if (belongsToServer(*environment))
+        std::filesystem::copy_file(temporary, basePath / "server" / "mods" / name);
+    std::filesystem::remove(temporary);
+    return environment;
 }
 bool ModPack::downloadLinuxLauncher(std::filesystem::path const& whereTo)
 {
@@ -281,8 +322,12 @@ bool ModPack::deployPack(std::filesystem::path const& packPath)
     std::filesystem::create_directory(deploymentPath / "server");
     std::filesystem::create_directory(deploymentPath / "client");
 
+    std::set<std::filesystem::path> misplaced;
     std::function<void(std::filesystem::path const& relative)> copyRecursive;
     copyRecursive = [&](std::filesystem::path const& relative) {
+        if (misplaced.contains(relative))
+            return;
+
         const auto source = packPath / relative;
         const auto target = deploymentPath / relative;
 
@@ -301,6 +346,25 @@ bool ModPack::deployPack(std::filesystem::path const& packPath)
     const auto server = std::filesystem::path{"server"};
     const auto client = std::filesystem::path{"client"};
     const auto mcpackdev = std::filesystem::path{"mcpackdev"};
+
+    // Packs installed before mods were classified have every mod on both sides.
+    if (std::filesystem::exists(packPath / "mcpackdev" / "modpack.json"))
+    {
+        PackFile pack{packPath};
+        pack.load();
+        for (auto const& mod : pack.mods())
+        {
+            const auto installedName = mod.value("installedName", "");
+            const auto environment = modEnvironmentFromString(mod.value("environment", ""));
+            if (installedName.empty() || !environment)
+                continue;
+            if (!belongsToClient(*environment))
+                misplaced.insert(client / "mods" / installedName);
+            if (!belongsToServer(*environment))
+                misplaced.insert(server / "mods" / installedName);
+        }
+    }
+
     copyRecursive("start.sh");
     copyRecursive("start.bat");
     copyRecursive("start_server.sh");
@@ -0,0 +1,133 @@
+#include <backend/modrinth.hpp>
+
+#include <roar/curl/request.hpp>
+#include <roar/url/encode.hpp>
+
+#include <algorithm>
+
+#ifndef MODMAKER_VERSION
+#    define MODMAKER_VERSION "dev"
+#endif
+
+namespace Modrinth
+{
+    namespace
+    {
+        std::string url(std::string const& path)
+        {
+            return std::string{apiBaseUrl} + path;
+        }
+
+        std::string jsonList(std::vector<std::string> const& values)
+        {
+            return nlohmann::json(values).dump();
+        }
+
+        std::string userAgent()
+        {
+            using namespace std::string_literals;
+            return "github.com/5cript/minecraft-modpack-maker"s + "/" + MODMAKER_VERSION;
+        }
+
+        std::optional<nlohmann::json> parseResponse(Roar::Curl::Response const& response, std::string const& body)
+        {
+            if (response.code() != boost::beast::http::status::ok)
+                return std::nullopt;
+            auto parsed = nlohmann::json::parse(body, nullptr, false);
+            if (parsed.is_discarded())
+                return std::nullopt;
+            return parsed;
+        }
+
+        std::optional<nlohmann::json> getJson(std::string const& url)
+        {
+            std::string body;
+            auto response = Roar::Curl::Request{}
+                                .followRedirects(true)
+                                .verifyPeer(false)
+                                .verifyHost(false)
+                                .setHeader("User-Agent", userAgent())
+                                .sink(body)
+                                .get(url);
+            return parseResponse(response, body);
+        }
+
+        std::optional<nlohmann::json> postJson(std::string const& url, nlohmann::json const& payload)
+        {
+            std::string body;
+            auto response = Roar::Curl::Request{}
+                                .followRedirects(true)
+                                .verifyPeer(false)
+                                .verifyHost(false)
+                                .setHeader("User-Agent", userAgent())
+                                .setHeader("Content-Type", "application/json")
+                                .source(payload.dump())
+                                .sink(body)
+                                .post(url);
+            return parseResponse(response, body);
+        }
+    }
+
+    std::optional<nlohmann::json> getVersion(std::string const& versionId)
+    {
+        return getJson(url("/version/" + Roar::urlEncode(versionId)));
+    }
+
+    std::optional<nlohmann::json> getProjectVersions(
+        std::string const& idOrSlug,
+        std::string const& loader,
+        std::vector<std::string> const& gameVersions)
+    {
+        auto versions = getJson(
+            url("/project/" + Roar::urlEncode(idOrSlug) + "/version?loaders=" + Roar::urlEncode(jsonList({loader})) +
+                "&game_versions=" + Roar::urlEncode(jsonList(gameVersions))));
+        if (!versions || !versions->is_array())
+            return std::nullopt;
+
+        // ISO 8601 timestamps order lexicographically.
+        std::sort(versions->begin(), versions->end(), [](auto const& a, auto const& b) {
+            return a.value("date_published", "") > b.value("date_published", "");
+        });
+        return versions;
+    }
+
+    std::optional<nlohmann::json> getVersionsFromHashes(
+        std::vector<std::string> const& hashes,
+        std::string const& algorithm)
+    {
+        if (hashes.empty())
+            return nlohmann::json::object();
+        return postJson(url("/version_files"), {{"hashes", hashes}, {"algorithm", algorithm}});
+    }
+
+    std::optional<nlohmann::json> getProjects(std::vector<std::string> const& ids)
+    {
+        // Keeps the query string at a length every proxy accepts.
+        constexpr std::size_t chunkSize = 100;
+
+        auto projects = nlohmann::json::array();
+        for (std::size_t offset = 0; offset < ids.size(); offset += chunkSize)
+        {
+            const auto chunk = std::vector<std::string>(
+                ids.begin() + offset, ids.begin() + std::min(ids.size(), offset + chunkSize));
+            auto result = getJson(url("/projects?ids=" + Roar::urlEncode(jsonList(chunk))));
+            if (!result || !result->is_array())
+                return std::nullopt;
+            projects.insert(projects.end(), result->begin(), result->end());
+        }
+        return projects;
+    }
+
+    nlohmann::json const* primaryFile(nlohmann::json const& version)
+    {
+        if (!version.contains("files") || version["files"].empty())
+            return nullptr;
+        auto const& files = version["files"];
+        auto it = std::find_if(files.begin(), files.end(), [](auto const& file) {
+            return file.value("primary", false);
+        });
+        if (it == files.end())
+            return &files.front();
+        return &*it;
+    }
+}
@@ -0,0 +1,211 @@
+#include <backend/mrpack.hpp>
+
+#include <backend/archive/writer.hpp>
+#include <backend/modrinth.hpp>
+#include <backend/parallel_for.hpp>
+#include <update_server/file_hashes.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    struct PackedMod
+    {
+        std::string name;
+        std::filesystem::path source;
+        bool onClient = false;
+        bool onServer = false;
+        FileHashes hashes = {};
+        std::uintmax_t size = 0;
+    };
+
+    std::vector<PackedMod> collectMods(std::filesystem::path const& packPath)
+    {
+        std::map<std::string, PackedMod> mods;
+        for (auto const* side : {"client", "server"})
+        {
+            const auto modsDirectory = packPath / side / "mods";
+            if (!std::filesystem::exists(modsDirectory))
+                continue;
+            for (auto const& entry : std::filesystem::directory_iterator{modsDirectory})
+            {
+                if (!entry.is_regular_file() || entry.path().extension() != ".jar")
+                    continue;
+                auto& mod = mods[entry.path().filename().string()];
+                mod.name = entry.path().filename().string();
+                mod.source = entry.path();
+                (std::string_view{side} == "client" ? mod.onClient : mod.onServer) = true;
+            }
+        }
+
+        std::vector<PackedMod> result;
+        result.reserve(mods.size());
+        for (auto& [name, mod] : mods)
+            result.push_back(std::move(mod));
+        return result;
+    }
+
+    std::string timestamp()
+    {
+        const auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        std::stringstream sstr;
+        sstr << std::put_time(std::localtime(&now), "%Y-%m-%d_%H-%M-%S");
+        return sstr.str();
+    }
+
+    std::string loaderVersion(std::filesystem::path const& packPath)
+    {
+        std::ifstream reader{packPath / "server" / "versions.json", std::ios_base::binary};
+        if (!reader.good())
+            return "";
+        const auto versions = nlohmann::json::parse(reader, nullptr, false);
+        if (versions.is_discarded() || !versions.is_object())
+            return "";
+        return versions.value("loaderVersion", "");
+    }
+
+    /**
+     * @brief The download url of the modrinth file with exactly this sha1, empty if modrinth does not host it.
+     */
+    std::string downloadUrl(nlohmann::json const& versions, std::string const& sha1)
+    {
+        if (!versions.contains(sha1))
+            return "";
+        for (auto const& file : versions[sha1].value("files", nlohmann::json::array()))
+        {
+            if (file.contains("hashes") && file["hashes"].value("sha1", "") == sha1)
+                return file.value("url", "");
+        }
+        return "";
+    }
+}
+
+MrPack::MrPack(Nui::RpcHub& hub, Tracer& tracer)
+{
+    hub.registerFunction(
+        "exportMrPack", [&hub, &tracer, this](std::string const& responseId, std::string const& packPath) {
+            auto span = tracer.span("exportMrPack", responseId);
+            try
+            {
+                PackFile pack{packPath};
+                pack.load();
+                hub.callRemote(responseId, exportPack(pack, 0, span));
+            }
+            catch (std::exception const& e)
+            {
+                hub.callRemote(
+                    responseId,
+                    nlohmann::json{
+                        {"success", false},
+                        {"message", e.what()},
+                    });
+            }
+        });
+}
+
+nlohmann::json MrPack::exportPack(PackFile const& pack, unsigned int jobs, Tracer::Span& span)
+{
+    auto mods = collectMods(pack.packPath());
+
+    std::atomic_uint64_t bytes{0};
+    parallelFor(mods.size(), jobs, [&](std::size_t index) {
+        mods[index].hashes = hashesFromFile(mods[index].source);
+        mods[index].size = std::filesystem::file_size(mods[index].source);
+        bytes += mods[index].size;
+    });
+    span.addTransferredBytes(bytes);
+
+    std::vector<std::string> hashes;
+    hashes.reserve(mods.size());
+    for (auto const& mod : mods)
+        hashes.push_back(mod.hashes.sha1);
+    const auto versions = Modrinth::getVersionsFromHashes(hashes);
+    if (!versions)
+        throw std::runtime_error("Could not look up mod files on modrinth.");
+
+    auto dependencies = nlohmann::json{{"minecraft", pack.minecraftVersion()}};
+    if (const auto loader = loaderVersion(pack.packPath()); !loader.empty())
+        dependencies[pack.modLoaderLowerCase() + "-loader"] = loader;
+
+    const auto versionId = timestamp();
+    auto index = nlohmann::json{
+        {"formatVersion", 1},
+        {"game", "minecraft"},
+        {"versionId", versionId},
+        {"name", pack.packPath().filename().string()},
+        {"files", nlohmann::json::array()},
+        {"dependencies", dependencies},
+    };
+
+    std::vector<std::pair<std::filesystem::path, std::filesystem::path>> overrides;
+    for (auto const& mod : mods)
+    {
+        const auto url = downloadUrl(*versions, mod.hashes.sha1);
+        if (url.empty())
+        {
+            std::string overridesDirectory = "overrides";
+            if (!mod.onServer)
+                overridesDirectory = "client-overrides";
+            else if (!mod.onClient)
+                overridesDirectory = "server-overrides";
+            overrides.emplace_back(mod.source, std::filesystem::path{overridesDirectory} / "mods" / mod.name);
+            continue;
+        }
+        index["files"].push_back({
+            {"path", "mods/" + mod.name},
+            {"hashes", {{"sha1", mod.hashes.sha1}, {"sha512", mod.hashes.sha512}}},
+            {"env",
+             {{"client", mod.onClient ? "required" : "unsupported"},
+              {"server", mod.onServer ? "required" : "unsupported"}}},
+            {"downloads", {url}},
+            {"fileSize", mod.size},
+        });
+    }
+
+    const auto deploymentsDir = pack.packPath() / "deployments";
+    std::filesystem::create_directories(deploymentsDir);
+    const auto target = deploymentsDir / (versionId + ".mrpack");
+    {
+        Archive::Writer writer{target, Archive::Writer::Format::Zip};
+        if (auto error = writer.addString(
+                index.dump(4),
+                indexFileName,
+                std::filesystem::perms::owner_read | std::filesystem::perms::owner_write |
+                    std::filesystem::perms::group_read | std::filesystem::perms::others_read);
+            error)
+            throw error;
+        for (auto const& [source, archivePath] : overrides)
+        {
+            if (auto error = writer.addFile(source, archivePath); error)
+                throw error;
+        }
+    }
+
+    // The update server hands this file out, a half written one must never replace the last good one.
+    {
+        const auto serverIndex = pack.packPath() / "server" / indexFileName;
+        const auto temporary = std::filesystem::path{serverIndex.string() + ".tmp"};
+        {
+            std::ofstream writer{temporary, std::ios_base::binary};
+            writer << index.dump(4);
+            if (!writer.good())
+                throw std::runtime_error("Could not write " + temporary.string());
+        }
+        std::filesystem::rename(temporary, serverIndex);
+    }
+
+    return {
+        {"success", true},
+        {"file", target.string()},
+        {"indexed", index["files"].size()},
+        {"overrides", overrides.size()},
+    };
+}
@@ -0,0 +1,54 @@
+#include <backend/pack_file.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+PackFile::PackFile(std::filesystem::path packPath)
+    : packPath_{std::move(packPath)}
+    , document_{}
+{}
+void PackFile::load()
+{
+    std::ifstream reader{file(), std::ios_base::binary};
+    if (!reader.good())
+        throw std::runtime_error("Could not open modpack file: " + file().string());
+    document_ = nlohmann::json::parse(reader);
+    if (!document_.contains("mods") || !document_["mods"].is_array())
+        document_["mods"] = nlohmann::json::array();
+}
+void PackFile::save() const
+{
+    std::ofstream writer{file(), std::ios_base::binary};
+    if (!writer.good())
+        throw std::runtime_error("Could not write modpack file: " + file().string());
+    writer << document_.dump(4);
+}
+nlohmann::json& PackFile::mods()
+{
+    return document_["mods"];
+}
+nlohmann::json const& PackFile::mods() const
+{
+    return document_.at("mods");
+}
+std::string PackFile::minecraftVersion() const
+{
+    return document_.value("minecraftVersion", "");
+}
+std::string PackFile::modLoaderLowerCase() const
+{
+    auto loader = document_.value("modLoader", "");
+    std::transform(loader.begin(), loader.end(), loader.begin(), [](auto c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return loader;
+}
+std::filesystem::path const& PackFile::packPath() const
+{
+    return packPath_;
+}
+std::filesystem::path PackFile::file() const
+{
+    return packPath_ / "mcpackdev" / "modpack.json";
+}
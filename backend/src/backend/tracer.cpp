@@ -0,0 +1,185 @@
+#include <backend/tracer.hpp>
+
+#include <nui/backend/filesystem/special_paths.hpp>
+
+#include <fstream>
+#include <functional>
+#include <thread>
+
+namespace
+{
+    constexpr int frontendPid = 1;
+    constexpr int backendPid = 2;
+
+    std::uint64_t currentThreadId()
+    {
+        return static_cast<std::uint64_t>(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    }
+}
+
+Tracer::Span::Span(Tracer& tracer, std::string name, std::string responseId)
+    : tracer_{&tracer}
+    , name_{std::move(name)}
+    , responseId_{std::move(responseId)}
+    , start_{Tracer::now()}
+    , transferredBytes_{0}
+{}
+Tracer::Span::~Span()
+{
+    tracer_->record({
+        .name = std::move(name_),
+        .side = Side::Backend,
+        .responseId = std::move(responseId_),
+        .startMicroseconds = start_,
+        .durationMicroseconds = Tracer::now() - start_,
+        .transferredBytes = transferredBytes_,
+        .threadId = currentThreadId(),
+    });
+}
+void Tracer::Span::addTransferredBytes(std::uint64_t bytes)
+{
+    transferredBytes_ += bytes;
+}
+std::uint64_t Tracer::Span::transferredBytes() const
+{
+    return transferredBytes_;
+}
+Tracer::Tracer()
+    : guard_{}
+    , events_{}
+{}
+Tracer::Tracer(Nui::RpcHub& hub)
+    : guard_{}
+    , events_{}
+{
+    registerRpc(hub);
+}
+void Tracer::registerRpc(Nui::RpcHub& hub)
+{
+    hub.registerFunction(
+        "recordTraceSpan",
+        [this](
+            std::string const& name,
+            std::string const& responseId,
+            double startMicroseconds,
+            double endMicroseconds) {
+            record({
+                .name = name,
+                .side = Side::Frontend,
+                .responseId = responseId,
+                .startMicroseconds = static_cast<std::int64_t>(startMicroseconds),
+                .durationMicroseconds = static_cast<std::int64_t>(endMicroseconds - startMicroseconds),
+                .transferredBytes = 0,
+                .threadId = 0,
+            });
+        });
+    hub.registerFunction("getTrace", [&hub, this](std::string const& responseId, std::string const& path) {
+        try
+        {
+            const auto target =
+                path.empty() ? Nui::resolvePath("~/.mcpackdev/trace.json") : std::filesystem::path{path};
+            writeChromeTrace(target);
+            hub.callRemote(
+                responseId,
+                nlohmann::json{
+                    {"success", true},
+                    {"path", target.string()},
+                });
+        }
+        catch (std::exception const& e)
+        {
+            hub.callRemote(
+                responseId,
+                nlohmann::json{
+                    {"success", false},
+                    {"message", e.what()},
+                });
+        }
+    });
+    hub.registerFunction("clearTrace", [&hub, this](std::string const& responseId) {
+        clear();
+        hub.callRemote(responseId, nlohmann::json{{"success", true}});
+    });
+}
+Tracer::Span Tracer::span(std::string name, std::string responseId)
+{
+    return Span{*this, std::move(name), std::move(responseId)};
+}
+void Tracer::record(Event event)
+{
+    std::scoped_lock lock{guard_};
+    if (events_.size() == maximumEvents)
+        events_.pop_front();
+    events_.push_back(std::move(event));
+}
+std::vector<Tracer::Event> Tracer::events() const
+{
+    std::scoped_lock lock{guard_};
+    return {events_.begin(), events_.end()};
+}
+void Tracer::clear()
+{
+    std::scoped_lock lock{guard_};
+    events_.clear();
+}
+std::int64_t Tracer::now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+nlohmann::json Tracer::chromeTrace() const
+{
+    auto traceEvents = nlohmann::json::array();
+    traceEvents.push_back(
+        {{"name", "process_name"}, {"ph", "M"}, {"pid", frontendPid}, {"args", {{"name", "frontend"}}}});
+    traceEvents.push_back(
+        {{"name", "process_name"}, {"ph", "M"}, {"pid", backendPid}, {"args", {{"name", "backend"}}}});
+
+    const auto allEvents = events();
+    for (auto const& event : allEvents)
+    {
+        const auto pid = event.side == Side::Frontend ? frontendPid : backendPid;
+        traceEvents.push_back({
+            {"name", event.name},
+            {"cat", "rpc"},
+            {"ph", "X"},
+            {"ts", event.startMicroseconds},
+            {"dur", event.durationMicroseconds},
+            {"pid", pid},
+            {"tid", event.threadId},
+            {"args",
+             {
+                 {"responseId", event.responseId},
+                 {"transferredBytes", event.transferredBytes},
+             }},
+        });
+
+        if (event.responseId.empty())
+            continue;
+
+        // Flow arrows from the frontend call to the backend handler that answered it.
+        traceEvents.push_back({
+            {"name", event.name},
+            {"cat", "rpc"},
+            {"ph", event.side == Side::Frontend ? "s" : "f"},
+            {"bp", "e"},
+            {"id", event.responseId},
+            {"ts", event.startMicroseconds},
+            {"pid", pid},
+            {"tid", event.threadId},
+        });
+    }
+
+    return nlohmann::json{
+        {"traceEvents", std::move(traceEvents)},
+        {"displayTimeUnit", "ms"},
+    };
+}
+void Tracer::writeChromeTrace(std::filesystem::path const& path) const
+{
+    std::ofstream writer{path, std::ios_base::binary};
+    if (!writer.good())
+        throw std::runtime_error("Could not open trace file for writing: " + path.string());
+    writer << chromeTrace().dump();
+}
@@ -63,18 +63,38 @@ struct Mod
     std::string newestTimestamp;
     std::string installedId;
     std::vector<ModHistoryEntry> history;
+    // modrinth client_side and server_side: "required", "optional", "unsupported" or "unknown".
+    std::string clientSide;
+    std::string serverSide;
+    // "client", "server" or "both" once installed, decides which mods folders receive the jar.
+    std::string environment;
 };
 BOOST_DESCRIBE_STRUCT(
     Mod,
     (),
-    (name, id, slug, installedName, installedTimestamp, logoPng64, newestTimestamp, installedId, history));
+    (name,
+     id,
+     slug,
+     installedName,
+     installedTimestamp,
+     logoPng64,
+     newestTimestamp,
+     installedId,
+     history,
+     clientSide,
+     serverSide,
+     environment));
 struct ModPack
 {
     Nui::Observed<std::vector<Mod>> mods;
     std::string minecraftVersion;
     std::string modLoader;
+    // Name of the LaunchProfile the server start scripts use, "g1" if empty.
+    std::string launchProfile;
+    // Cores the server is pinned to, like "0-3". Empty for all cores.
+    std::string serverCpus;
 };
-BOOST_DESCRIBE_STRUCT(ModPack, (), (mods, minecraftVersion, modLoader));
+BOOST_DESCRIBE_STRUCT(ModPack, (), (mods, minecraftVersion, modLoader, launchProfile, serverCpus));
 
 class ModPackManager
 {
@@ -116,7 +136,11 @@ class ModPackManager
         bool featuredOnly,
         std::function<void(bool)> onUpdateDone);
     void deploy(std::function<void(bool)> onDeployDone = [](bool) {});
+    // Writes a .mrpack into the deployments and the index for the update server.
+    void exportMrPack(std::function<void(bool)> onExportDone = [](bool) {});
     void copyExternals(std::function<void(bool)> onCopyDone = [](bool) {});
+    // Identifies all jars of an existing mods folder by hash and adds them to the pack file. Reopen afterwards.
+    void importMods(std::filesystem::path const& modsDirectory, std::function<void(bool)> onImportDone);
     void resetAllInstalls(std::function<void()> onResetDone);
     void installMissing(
         bool fuzzy,
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <nui/frontend/rpc_client.hpp>
+
+#include <emscripten/val.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace Tracing
+{
+    /**
+     * @brief Microseconds since the unix epoch, comparable with the backend clock.
+     */
+    double nowMicroseconds();
+
+    /**
+     * @brief Send a finished frontend span to the backend tracer.
+     */
+    void recordSpan(std::string const& name, std::string const& responseId, double start, double end);
+
+    /**
+     * @brief Export the collected trace as a chrome trace-event file. An empty path uses the pack dev home.
+     */
+    void exportTrace(std::string const& path, std::function<void(bool, std::string const&)> onExportDone);
+
+    /**
+     * @brief Drop-in replacement for RpcClient::getRemoteCallableWithBackChannel that records the round trip.
+     *
+     * The span is keyed by the responseId of the back channel, which is the same id the backend handler sees.
+     */
+    template <typename FunctionT>
+    auto callWithBackChannel(std::string name, FunctionT&& onResponse)
+    {
+        auto start = std::make_shared<double>(0.0);
+        auto responseId = std::make_shared<std::string>();
+        *responseId = Nui::RpcClient::registerFunctionOnce(
+            [name, start, responseId, onResponse = std::forward<FunctionT>(onResponse)](
+                emscripten::val response) mutable {
+                recordSpan(name, *responseId, *start, nowMicroseconds());
+                onResponse(std::move(response));
+            });
+        return [name = std::move(name), start, responseId](auto&&... args) {
+            *start = nowMicroseconds();
+            Nui::RpcClient::getRemoteCallable(name)(*responseId, std::forward<decltype(args)>(args)...);
+        };
+    }
+}
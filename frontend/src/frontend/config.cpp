@@ -1,4 +1,5 @@
 #include <frontend/config.hpp>
+#include <frontend/tracing.hpp>
 
 #include <nui/frontend/api/console.hpp>
 #include <nui/frontend/api/json.hpp>
@@ -16,7 +17,7 @@ namespace
 void loadConfig(std::function<void(Config&&)> onLoad)
 {
     auto loadConfigImpl = [onLoad = std::move(onLoad)](std::filesystem::path const& home) {
-        RpcClient::getRemoteCallableWithBackChannel("readFile", [onLoad = std::move(onLoad)](emscripten::val response) {
+        Tracing::callWithBackChannel("readFile", [onLoad = std::move(onLoad)](emscripten::val response) {
             if (response["success"].as<bool>())
             {
                 Config cfg;
@@ -30,7 +31,7 @@ void loadConfig(std::function<void(Config&&)> onLoad)
 
     if (packdevHome.empty())
     {
-        RpcClient::getRemoteCallableWithBackChannel("getPackDevHome", [loadConfigImpl](emscripten::val response) {
+        Tracing::callWithBackChannel("getPackDevHome", [loadConfigImpl](emscripten::val response) {
             packdevHome = response["path"].as<std::string>();
             loadConfigImpl(packdevHome);
         })();
@@ -41,7 +42,7 @@ void loadConfig(std::function<void(Config&&)> onLoad)
 void saveConfig(Config const& config, std::function<void(bool)> onSaveComplete)
 {
     auto saveConfigImpl = [&config, onSaveComplete = std::move(onSaveComplete)](std::filesystem::path const& home) {
-        RpcClient::getRemoteCallableWithBackChannel(
+        Tracing::callWithBackChannel(
             "writeFile", [onSaveComplete = std::move(onSaveComplete)](emscripten::val response) {
                 onSaveComplete(response["success"].as<bool>());
             })((home / "config.json").string(), JSON::stringify(convertToVal(config)));
@@ -49,7 +50,7 @@ void saveConfig(Config const& config, std::function<void(bool)> onSaveComplete)
 
     if (packdevHome.empty())
     {
-        RpcClient::getRemoteCallableWithBackChannel("getPackDevHome", [saveConfigImpl](emscripten::val response) {
+        Tracing::callWithBackChannel("getPackDevHome", [saveConfigImpl](emscripten::val response) {
             packdevHome = response["path"].as<std::string>();
             saveConfigImpl(packdevHome);
         })();
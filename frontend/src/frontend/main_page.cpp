@@ -45,6 +45,7 @@
 
 #include <frontend/api/minecraft.hpp>
 #include <frontend/api/modrinth.hpp>
+#include <frontend/tracing.hpp>
 
 #include <iostream>
 #include <tuple>
@@ -308,6 +309,8 @@ void MainPage::onSelectSearchedMod(auto const& searchHit)
                     .installedTimestamp = "",
                     .logoPng64 = "data:image/png;base64,"s + *response.body,
                     .newestTimestamp = versions.empty() ? "" : versions.front().date_published,
+                    .clientSide = searchHit.client_side,
+                    .serverSide = searchHit.server_side,
                 });
                 {
                     auto proxy = searchFieldValue_.modify();
@@ -559,6 +562,24 @@ Nui::ElementRenderer MainPage::packControls()
             }(
                 "Deploy"
             ),
+            button{
+                class_ = observe(updateControlLock_).generate([this](){
+                    if (updateControlLock_.value())
+                        return "btn btn-primary disabled";
+                    return
+                        "btn btn-primary";
+                }),
+                onClick = [this](){
+                    if (updateControlLock_.value())
+                        return;
+                    showBlocker("Exporting pack index...");
+                    modPack_.exportMrPack([this](bool){
+                        hideBlocker();
+                    });
+                }
+            }(
+                "Export .mrpack"
+            ),
             button{
                 class_ = observe(updateControlLock_).generate([this](){
                     if (updateControlLock_.value())
@@ -578,6 +599,47 @@ Nui::ElementRenderer MainPage::packControls()
             }(
                 "Copy Externals"
             ),
+            button{
+                class_ = observe(updateControlLock_).generate([this](){
+                    if (updateControlLock_.value())
+                        return "btn btn-primary disabled";
+                    return
+                        "btn btn-primary";
+                }),
+                onClick = [this](){
+                    if (updateControlLock_.value())
+                        return;
+
+                    FileDialog::showDirectoryDialog({}, [this](std::optional<std::vector<std::filesystem::path>> result) {
+                        if (!result)
+                            return;
+                        showBlocker("Identifying and importing mods...");
+                        modPack_.importMods(result.value()[0], [this](bool){
+                            hideBlocker();
+                            openModPack();
+                        });
+                    });
+                }
+            }(
+                "Import Mods"
+            ),
+            button{
+                class_ = observe(config_.openPack).generate([this](){
+                    if (config_.openPack.empty())
+                        return "btn btn-secondary disabled";
+                    return
+                        "btn btn-secondary";
+                }),
+                onClick = [this](){
+                    const auto tracePath = std::filesystem::path{config_.openPack.value()} / "mcpackdev" / "trace.json";
+                    Tracing::exportTrace(tracePath.string(), [](bool success, std::string const& path){
+                        if (success)
+                            Console::log("Trace written to: ", path);
+                    });
+                }
+            }(
+                "Export Trace"
+            ),
             button{
                 class_ = observe(updateControlLock_).generate([this](){
                     if (updateControlLock_.value())
@@ -1,6 +1,8 @@
+#include <backend/launch_profile.hpp>
 #include <frontend/modpack.hpp>
 
 #include <frontend/api/http.hpp>
+#include <frontend/tracing.hpp>
 #include <nui/frontend/api/console.hpp>
 #include <nui/frontend/api/json.hpp>
 #include <nui/frontend/rpc_client.hpp>
@@ -55,7 +57,7 @@ ModPackManager::ModPackManager()
 void ModPackManager::open(std::filesystem::path path, std::function<void()> onOpen)
 {
     openPack_ = std::move(path);
-    RpcClient::getRemoteCallableWithBackChannel(
+    Tracing::callWithBackChannel(
         "readFile", [this, onOpenCb = std::move(onOpen)](emscripten::val response) {
             if (response["success"].as<bool>())
             {
@@ -66,7 +68,7 @@ void ModPackManager::open(std::filesystem::path path, std::function<void()> onOp
             }
             else
             {
-                RpcClient::getRemoteCallableWithBackChannel("createDirectory", [this](emscripten::val response) {
+                Tracing::callWithBackChannel("createDirectory", [this](emscripten::val response) {
                     save();
                 })((openPack_ / "mcpackdev").string());
             }
@@ -145,7 +147,7 @@ void ModPackManager::removeMod(std::string const& id)
     {
         if (!it->installedName.empty())
         {
-            RpcClient::getRemoteCallableWithBackChannel("removeMod", [this, it](emscripten::val response) {
+            Tracing::callWithBackChannel("removeMod", [this, it](emscripten::val response) {
                 if (response["success"].as<bool>())
                 {
                     pack_.mods.erase(it);
@@ -167,7 +169,7 @@ void ModPackManager::removeMod(std::string const& id)
 //---------------------------------------------------------------------------------------------------------------------
 void ModPackManager::save()
 {
-    RpcClient::getRemoteCallableWithBackChannel("writeFile", [](emscripten::val response) {
+    Tracing::callWithBackChannel("writeFile", [](emscripten::val response) {
         if (!response["success"].as<bool>())
             Console::error("Failed to save modpack");
     })(modpackFile().string(), JSON::stringify(convertToVal(pack_), 4));
@@ -277,7 +279,7 @@ void ModPackManager::installMod(
         return;
 
     auto onDirCreationDone = [this, version, file = *it, mod = *modIt, onInstallComplete]() {
-        RpcClient::getRemoteCallableWithBackChannel(
+        Tracing::callWithBackChannel(
             "installMod", [this, version, file, mod, onInstallComplete](emscripten::val installResponse) {
                 if (installResponse["success"].as<bool>())
                 {
@@ -289,6 +291,7 @@ void ModPackManager::installMod(
                     modIt->installedName = file.filename;
                     modIt->installedTimestamp = version.date_published;
                     modIt->installedId = version.id;
+                    modIt->environment = installResponse["environment"].as<std::string>();
                     save();
                     globalEventContext.executeActiveEventsImmediately();
                     onInstallComplete(true);
@@ -298,12 +301,12 @@ void ModPackManager::installMod(
                     Console::error("Failed to install mod", installResponse);
                     onInstallComplete(false);
                 }
-            })(openPack_, file.filename, mod.installedName, file.url);
+            })(openPack_, file.filename, mod.installedName, file.url, mod.environment, mod.clientSide, mod.serverSide);
     };
 
     // create mods directory
-    RpcClient::getRemoteCallableWithBackChannel("createDirectory", [this, onDirCreationDone](emscripten::val response) {
-        RpcClient::getRemoteCallableWithBackChannel("createDirectory", [onDirCreationDone](emscripten::val response) {
+    Tracing::callWithBackChannel("createDirectory", [this, onDirCreationDone](emscripten::val response) {
+        Tracing::callWithBackChannel("createDirectory", [onDirCreationDone](emscripten::val response) {
             onDirCreationDone();
         })(openPack_ / "server" / "mods");
     })(openPack_ / "client" / "mods");
@@ -341,11 +344,11 @@ Nui::Observed<ModPackManager::LoaderInstallStatus> const& ModPackManager::loader
 //---------------------------------------------------------------------------------------------------------------------
 void ModPackManager::setupAndFixDirectories()
 {
-    RpcClient::getRemoteCallableWithBackChannel("createDirectory", [this](emscripten::val) {
+    Tracing::callWithBackChannel("createDirectory", [this](emscripten::val) {
         setupStartScripts();
         installLauncher();
     })((openPack_ / "client").string());
-    RpcClient::getRemoteCallableWithBackChannel("createDirectory", [](emscripten::val) {})(
+    Tracing::callWithBackChannel("createDirectory", [](emscripten::val) {})(
         (openPack_ / "server").string());
 }
 //---------------------------------------------------------------------------------------------------------------------
@@ -360,7 +363,7 @@ void ModPackManager::installLoader(std::function<void(bool)> onInstallDone)
         return;
 
     // TODO: show dialog
-    RpcClient::getRemoteCallableWithBackChannel(
+    Tracing::callWithBackChannel(
         remoteCallable, [this, onInstallDone = std::move(onInstallDone)](emscripten::val response) {
             auto success = response["success"].as<bool>();
             if (success)
@@ -373,7 +376,7 @@ void ModPackManager::installLoader(std::function<void(bool)> onInstallDone)
 //---------------------------------------------------------------------------------------------------------------------
 void ModPackManager::installLauncher()
 {
-    RpcClient::getRemoteCallableWithBackChannel("installLaunchers", [](emscripten::val response) {
+    Tracing::callWithBackChannel("installLaunchers", [](emscripten::val response) {
         if (response["success"].as<bool>())
         {
             // TODO: show dialog
@@ -389,7 +392,7 @@ void ModPackManager::updateLoaderInstalledStatus()
 {
     if (pack_.modLoader == "Fabric")
     {
-        RpcClient::getRemoteCallableWithBackChannel("fabricInstallStatus", [this](emscripten::val response) {
+        Tracing::callWithBackChannel("fabricInstallStatus", [this](emscripten::val response) {
             loaderInstallStatus_ = static_cast<LoaderInstallStatus>(response.as<int>());
             globalEventContext.executeActiveEventsImmediately();
         })((openPack_).string(), pack_.minecraftVersion);
@@ -424,7 +427,7 @@ void ModPackManager::resetModsRecursive(std::vector<Mod>::iterator iter, std::fu
     bumpHistory(*iter);
     if (!iter->installedName.empty())
     {
-        RpcClient::getRemoteCallableWithBackChannel("removeMod", [recurse, iter](emscripten::val response) mutable {
+        Tracing::callWithBackChannel("removeMod", [recurse, iter](emscripten::val response) mutable {
             if (response["success"].as<bool>())
             {
                 iter->installedName.clear();
@@ -530,24 +533,32 @@ void ModPackManager::setupStartScripts()
         set WORKDIR=%cd%\client
         start "" "client/Minecraft.exe" --workDir "%WORKDIR%"
     )bat");
-    const auto linuxServerStartScript = fixWhitespace(R"sh(
-        #!/bin/bash
-        cd server
-        java -jar server.jar
-    )sh");
-    const auto windowsServerStartScript = fixWhitespace(R"sh(
-        @echo off
-        cd server
-        start "" "java" -jar "server.jar"
-    )sh");
+    // The update server starts the game server from the same profile.
+    auto profile = LaunchProfile::named(pack_.launchProfile);
+    if (!profile)
+    {
+        if (!pack_.launchProfile.empty())
+            Console::warn("Unknown launch profile, using the default: ", pack_.launchProfile);
+        profile = LaunchProfile::named(LaunchProfile::defaultName);
+    }
+    try
+    {
+        profile->cpus = LaunchProfile::parseCpuList(pack_.serverCpus);
+    }
+    catch (std::exception const& e)
+    {
+        Console::error(e.what());
+    }
+    const auto linuxServerStartScript = profile->posixStartScript("server.jar");
+    const auto windowsServerStartScript = profile->windowsStartScript("server.jar");
 
-    RpcClient::getRemoteCallableWithBackChannel("writeFile", [](emscripten::val) {})(
+    Tracing::callWithBackChannel("writeFile", [](emscripten::val) {})(
         (openPack_ / "start.sh").string(), linuxClientStartScript);
-    RpcClient::getRemoteCallableWithBackChannel("writeFile", [](emscripten::val) {})(
+    Tracing::callWithBackChannel("writeFile", [](emscripten::val) {})(
         (openPack_ / "start.bat").string(), windowsClientStartScript);
-    RpcClient::getRemoteCallableWithBackChannel("writeFile", [](emscripten::val) {})(
+    Tracing::callWithBackChannel("writeFile", [](emscripten::val) {})(
         (openPack_ / "start_server.sh").string(), linuxServerStartScript);
-    RpcClient::getRemoteCallableWithBackChannel("writeFile", [](emscripten::val) {})(
+    Tracing::callWithBackChannel("writeFile", [](emscripten::val) {})(
         (openPack_ / "start_server.bat").string(), windowsServerStartScript);
 }
 //---------------------------------------------------------------------------------------------------------------------
@@ -575,13 +586,13 @@ void ModPackManager::minecraftVersion(std::string const& version)
 //---------------------------------------------------------------------------------------------------------------------
 void ModPackManager::writeVersionsFile()
 {
-    RpcClient::getRemoteCallableWithBackChannel("readFile", [this](emscripten::val response) {
+    Tracing::callWithBackChannel("readFile", [this](emscripten::val response) {
         if (response["success"].as<bool>())
         {
             auto data = response["data"].as<std::string>();
             auto versions = Nui::JSON::parse(data);
             versions.set("minecraftVersion", pack_.minecraftVersion);
-            RpcClient::getRemoteCallableWithBackChannel("writeFile", [](emscripten::val response) {
+            Tracing::callWithBackChannel("writeFile", [](emscripten::val response) {
                 if (!response["success"].as<bool>())
                     Console::error("Failed to write versions file");
             })((openPack_ / "server" / "versions.json").string(), Nui::JSON::stringify(versions, 4));
@@ -592,7 +603,7 @@ void ModPackManager::writeVersionsFile()
             versions.set("minecraftVersion", pack_.minecraftVersion);
             // cannot know at this point
             versions.set("loaderVersion", "");
-            RpcClient::getRemoteCallableWithBackChannel("writeFile", [](emscripten::val response) {
+            Tracing::callWithBackChannel("writeFile", [](emscripten::val response) {
                 if (!response["success"].as<bool>())
                     Console::error("Failed to write versions file");
             })((openPack_ / "server" / "versions.json").string(), Nui::JSON::stringify(versions, 4));
@@ -607,7 +618,7 @@ std::string ModPackManager::minecraftVersion() const
 //---------------------------------------------------------------------------------------------------------------------
 void ModPackManager::deploy(std::function<void(bool)> onDeployDone)
 {
-    RpcClient::getRemoteCallableWithBackChannel(
+    Tracing::callWithBackChannel(
         "deploy", [onDeployDone = std::move(onDeployDone)](emscripten::val deployResponse) {
             auto success = deployResponse["success"].as<bool>();
             if (!success)
@@ -616,9 +627,22 @@ void ModPackManager::deploy(std::function<void(bool)> onDeployDone)
         })((openPack_).string());
 }
 //---------------------------------------------------------------------------------------------------------------------
+void ModPackManager::exportMrPack(std::function<void(bool)> onExportDone)
+{
+    Tracing::callWithBackChannel(
+        "exportMrPack", [onExportDone = std::move(onExportDone)](emscripten::val exportResponse) {
+            auto success = exportResponse["success"].as<bool>();
+            if (!success)
+                Console::error("Failed to export mrpack: ", exportResponse["message"]);
+            else
+                Console::log("Exported: ", exportResponse["file"]);
+            onExportDone(success);
+        })((openPack_).string());
+}
+//---------------------------------------------------------------------------------------------------------------------
 void ModPackManager::copyExternals(std::function<void(bool)> onCopyDone)
 {
-    RpcClient::getRemoteCallableWithBackChannel(
+    Tracing::callWithBackChannel(
         "copyExternals", [onCopyDone = std::move(onCopyDone)](emscripten::val copyResponse) {
             auto success = copyResponse["success"].as<bool>();
             if (!success)
@@ -626,4 +650,21 @@ void ModPackManager::copyExternals(std::function<void(bool)> onCopyDone)
             onCopyDone(success);
         })((openPack_).string());
 }
+//---------------------------------------------------------------------------------------------------------------------
+void ModPackManager::importMods(std::filesystem::path const& modsDirectory, std::function<void(bool)> onImportDone)
+{
+    Tracing::callWithBackChannel(
+        "importMods", [onImportDone = std::move(onImportDone)](emscripten::val importResponse) {
+            auto success = importResponse["success"].as<bool>();
+            if (!success)
+                Console::error("Failed to import mods: ", importResponse["message"]);
+            else
+            {
+                Console::log("Imported mods: ", importResponse["imported"]);
+                if (importResponse["unidentified"]["length"].as<int>() > 0)
+                    Console::warn("Could not identify: ", importResponse["unidentified"]);
+            }
+            onImportDone(success);
+        })(openPack_.string(), modsDirectory.string(), std::string{});
+}
 // #####################################################################################################################
\ No newline at end of file
@@ -0,0 +1,33 @@
+#include <frontend/tracing.hpp>
+
+#include <nui/frontend/api/console.hpp>
+
+using namespace Nui;
+
+namespace Tracing
+{
+    double nowMicroseconds()
+    {
+        auto performance = emscripten::val::global("performance");
+        return (performance["timeOrigin"].as<double>() + performance.call<double>("now")) * 1000.0;
+    }
+
+    void recordSpan(std::string const& name, std::string const& responseId, double start, double end)
+    {
+        RpcClient::getRemoteCallable("recordTraceSpan")(name, responseId, start, end);
+    }
+
+    void exportTrace(std::string const& path, std::function<void(bool, std::string const&)> onExportDone)
+    {
+        RpcClient::getRemoteCallableWithBackChannel(
+            "getTrace", [onExportDone = std::move(onExportDone)](emscripten::val response) {
+                if (!response["success"].as<bool>())
+                {
+                    Console::error("Failed to export trace", response["message"]);
+                    onExportDone(false, "");
+                    return;
+                }
+                onExportDone(true, response["path"].as<std::string>());
+            })(path);
+    }
+}
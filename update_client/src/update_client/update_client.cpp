@@ -1,5 +1,9 @@
 #include "update_client.hpp"
 
+#include <update_server/delta.hpp>
+#include <update_server/hashing.hpp>
+#include <update_server/tar_stream.hpp>
+
 #include <nlohmann/json.hpp>
 #include <roar/curl/request.hpp>
 #include <roar/url/encode.hpp>
@@ -8,14 +12,31 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/xml_parser.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <exception>
 #include <iostream>
+#include <mutex>
 #include <sstream>
+#include <thread>
 
 using json = nlohmann::json;
 using namespace std::string_literals;
 using namespace std::chrono_literals;
 
+namespace
+{
+    constexpr char const* generationHeader = "X-Mod-Generation";
+
+    std::optional<std::uint64_t> generationOf(json const& response)
+    {
+        if (!response.contains("generation"))
+            return std::nullopt;
+        return response.at("generation").get<std::uint64_t>();
+    }
+}
+
 UpdateClient::UpdateClient(std::filesystem::path selfDirectory, std::string remoteAddress, unsigned short port)
     : selfDirectory_{std::move(selfDirectory)}
     , remoteAddress_{std::move(remoteAddress)}
@@ -27,8 +48,34 @@ void UpdateClient::performUpdate(Config const& conf, ProgressCallbacks const& cb
     conf_ = conf;
     cbs_ = cbs;
 
-    installFabric();
-    updateMods();
+    const auto synced = sync(loadManifestState());
+    if (!synced)
+    {
+        installFabric(fetchVersions());
+        updateMods();
+        return;
+    }
+
+    // Everything is known after the one request, the fabric installer runs while the mods are transferred.
+    std::exception_ptr fabricError;
+    {
+        std::jthread fabric{[this, &synced, &fabricError]() {
+            try
+            {
+                if (synced->versions)
+                    installFabric(*synced->versions);
+                else
+                    std::cout << "Update server has no versions, leaving the fabric installation as it is.\n";
+            }
+            catch (...)
+            {
+                fabricError = std::current_exception();
+            }
+        }};
+        updateMods(*synced);
+    }
+    if (fabricError)
+        std::rethrow_exception(fabricError);
 }
 
 std::filesystem::path UpdateClient::getClientDir() const
@@ -38,7 +85,7 @@ std::filesystem::path UpdateClient::getClientDir() const
     return conf_.clientDirectory;
 }
 
-void UpdateClient::installFabric()
+Versions UpdateClient::fetchVersions() const
 {
     Roar::Curl::Request req;
     std::string response;
@@ -60,7 +107,11 @@ void UpdateClient::installFabric()
         std::cout << response << "\n";
         std::rethrow_exception(std::current_exception());
     }
+    return versions;
+}
 
+void UpdateClient::installFabric(Versions const& versions)
+{
     if ((versions.loaderVersion != conf_.loaderVersion || versions.minecraftVersion != conf_.minecraftVersion) &&
         cbs_.onFabricInstall())
     {
@@ -167,31 +218,319 @@ std::optional<std::filesystem::path> UpdateClient::findJava() const
     return path;
 }
 
+std::optional<SyncResponse> UpdateClient::sync(std::optional<ManifestState> const& state)
+{
+    // Without a state, or after local changes, the server has to see the local mods. Otherwise the generation is
+    // enough, unless the server is more than one generation ahead and asks for the mods after all.
+    const auto knownEtag = state && state->localFingerprint == localModsFingerprint() ? state->etag : ""s;
+    auto request = json{{"etag", knownEtag}};
+    if (knownEtag.empty())
+        request["mods"] = loadLocalMods();
+
+    for (int attempt = 0; attempt != 2; ++attempt)
+    {
+        Roar::Curl::Request req;
+        std::string response;
+        const auto res = req.setHeader("Expect", "").source(request.dump()).sink(response).post(url("/sync"));
+        if (res.code() != boost::beast::http::status::ok)
+        {
+            std::cout << "Update server cannot sync in one request, asking step by step.\n";
+            return std::nullopt;
+        }
+
+        try
+        {
+            const auto parsed = json::parse(response);
+            if (parsed.at("needMods").get<bool>())
+            {
+                request["mods"] = loadLocalMods();
+                continue;
+            }
+
+            SyncResponse synced{
+                .upToDate = parsed.at("upToDate").get<bool>(),
+                .fromChangelog = parsed.at("changelog").get<bool>(),
+                .etag = parsed.at("etag").get<std::string>(),
+                .versions = std::nullopt,
+                .index = {},
+                .instructions = {},
+                .patches = parsed.at("patches").get<std::vector<PatchInstruction>>(),
+                .blobs = {},
+                .generation = generationOf(parsed),
+            };
+            if (auto const& versions = parsed.at("versions"); !versions.is_null())
+                synced.versions = versions.get<Versions>();
+            if (auto const& index = parsed.at("modrinthIndex"); !index.is_null())
+                synced.index = parseModrinthIndex(index);
+            parsed.at("remove").get_to(synced.instructions.remove);
+            for (auto const& download : parsed.at("download"))
+            {
+                auto blob = download.get<BlobDownload>();
+                synced.instructions.download.push_back(blob.name);
+                synced.blobs[blob.name] = std::move(blob);
+            }
+            return synced;
+        }
+        catch (std::exception const& exc)
+        {
+            std::cout << "Could not parse sync response, asking step by step: " << exc.what() << "\n";
+            return std::nullopt;
+        }
+    }
+    return std::nullopt;
+}
+
+void UpdateClient::updateMods(SyncResponse const& synced)
+{
+    if (synced.upToDate)
+    {
+        std::cout << "Mods are up to date.\n";
+        return;
+    }
+
+    pinnedGeneration_ = synced.generation;
+    auto instructions = synced.instructions;
+    if (synced.fromChangelog)
+    {
+        std::cout << "Applying the changes of the last server update.\n";
+        dropIgnoredMods(instructions);
+    }
+    applyUpdate(std::move(instructions), synced.patches, synced.index, synced.etag, synced.blobs);
+}
+
 void UpdateClient::updateMods()
 {
+    const auto check = checkManifest(loadManifestState());
+    if (check.upToDate)
+    {
+        std::cout << "Mods are up to date.\n";
+        return;
+    }
+
+    const auto index = loadModrinthIndex();
+    UpdateInstructions instructions;
+    std::vector<PatchInstruction> patches;
+    std::string etag = check.etag;
+    pinnedGeneration_ = check.generation;
+    if (check.changelog)
+    {
+        std::cout << "Applying the changes of the last server update.\n";
+        instructions = *check.changelog;
+        patches = check.patches;
+        dropIgnoredMods(instructions);
+    }
+    else
+    {
+        Roar::Curl::Request req;
+        std::string response;
+        std::cout << "Getting minecraft mod file list...\n";
+        req.setHeader("Expect", "")
+            .source(json{{"mods", loadLocalMods()}}.dump())
+            .sink(response)
+            .post(url("/make_file_difference"));
+        std::cout << "List was obtained:\n";
+        std::cout << response << "\n";
+        try
+        {
+            const auto parsed = json::parse(response);
+            parsed.get_to(instructions);
+            // Older servers do not send patches or generations.
+            if (parsed.contains("patches"))
+                parsed["patches"].get_to(patches);
+            etag = parsed.value("etag", "");
+            pinnedGeneration_ = generationOf(parsed);
+        }
+        catch (std::exception const& exc)
+        {
+            std::cout << "Could not parse make_file_difference response: " << exc.what() << "\n";
+            std::cout << response << "\n";
+            std::rethrow_exception(std::current_exception());
+        }
+    }
+
+    applyUpdate(std::move(instructions), patches, index, etag, {});
+}
+
+void UpdateClient::applyUpdate(
+    UpdateInstructions instructions,
+    std::vector<PatchInstruction> const& patches,
+    ModrinthIndex const& index,
+    std::string const& etag,
+    std::map<std::string, BlobDownload> const& blobs)
+{
+    applyModrinthIndex(instructions, index);
+    // Before the removal, the patches start from the old versions.
+    applyPatches(patches, instructions);
+    removeOldMods(instructions.remove);
+    if (downloadMods(instructions.download, index, blobs) && !etag.empty())
+        saveManifestState(etag);
+}
+
+void UpdateClient::dropIgnoredMods(UpdateInstructions& instructions) const
+{
+    for (auto* list : {&instructions.download, &instructions.remove})
+    {
+        std::erase_if(*list, [this](std::string const& name) {
+            return conf_.ignoreMods.contains(name);
+        });
+    }
+}
+
+ManifestCheck UpdateClient::checkManifest(std::optional<ManifestState> const& state) const
+{
+    // Without a state, or after local changes, only the full diff is safe.
+    const auto knownEtag = state && state->localFingerprint == localModsFingerprint() ? state->etag : ""s;
+
     Roar::Curl::Request req;
     std::string response;
-    std::cout << "Getting minecraft mod file list...\n";
-    req.setHeader("Expect", "")
-        .source(json{{"mods", loadLocalMods()}}.dump())
-        .sink(response)
-        .post(url("/make_file_difference"));
-    std::cout << "List was obtained:\n";
-    std::cout << response << "\n";
-    UpdateInstructions instructions;
+    if (!knownEtag.empty())
+        req.setHeader("If-None-Match", knownEtag);
+    const auto res = req.sink(response).get(url("/manifest"));
+    if (res.code() == boost::beast::http::status::not_modified)
+    {
+        return ManifestCheck{
+            .upToDate = true,
+            .etag = knownEtag,
+            .changelog = std::nullopt,
+            .patches = {},
+            .generation = std::nullopt,
+        };
+    }
+    if (res.code() != boost::beast::http::status::ok)
+        return {};
+
+    ManifestCheck check;
     try
     {
-        json::parse(response).get_to(instructions);
+        const auto manifest = json::parse(response);
+        check.etag = manifest.value("etag", "");
+        check.generation = generationOf(manifest);
+        if (auto const& changelog = manifest.at("changelog"); !changelog.is_null())
+        {
+            check.changelog = changelog.get<UpdateInstructions>();
+            changelog.at("patches").get_to(check.patches);
+        }
     }
     catch (std::exception const& exc)
     {
-        std::cout << "Could not parse make_file_difference response: " << exc.what() << "\n";
-        std::cout << response << "\n";
-        std::rethrow_exception(std::current_exception());
+        std::cout << "Could not parse manifest, doing a full update: " << exc.what() << "\n";
+        return {};
+    }
+    return check;
+}
+
+std::optional<ManifestState> UpdateClient::loadManifestState() const
+{
+    std::ifstream reader{getClientDir() / ".update_manifest.json", std::ios_base::binary};
+    if (!reader.good())
+        return std::nullopt;
+    const auto state = json::parse(reader, nullptr, false);
+    if (state.is_discarded())
+        return std::nullopt;
+    try
+    {
+        return state.get<ManifestState>();
+    }
+    catch (std::exception const&)
+    {
+        return std::nullopt;
     }
+}
 
-    removeOldMods(instructions.remove);
-    downloadMods(instructions.download);
+void UpdateClient::saveManifestState(std::string const& etag) const
+{
+    std::ofstream writer{getClientDir() / ".update_manifest.json", std::ios_base::binary};
+    writer << json(ManifestState{.etag = etag, .localFingerprint = localModsFingerprint()}).dump();
+}
+
+std::string UpdateClient::localModsFingerprint() const
+{
+    std::vector<std::string> entries;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator mods{getClientDir() / "mods", ec}, end; !ec && mods != end;
+         mods.increment(ec))
+    {
+        const auto size = std::filesystem::file_size(mods->path(), ec);
+        const auto modified = std::filesystem::last_write_time(mods->path(), ec).time_since_epoch().count();
+        entries.push_back(
+            mods->path().filename().string() + "\n" + std::to_string(size) + "\n" + std::to_string(modified) + "\n");
+    }
+    std::sort(entries.begin(), entries.end());
+
+    Hashing::MultiDigest digest{Hashing::Sha256};
+    for (auto const& entry : entries)
+        digest.update(entry.data(), entry.size());
+    return digest.finish().sha256;
+}
+
+ModrinthIndex UpdateClient::loadModrinthIndex()
+{
+    Roar::Curl::Request req;
+    std::string response;
+    const auto res = req.sink(response).get(url("/modrinth_index"));
+    if (res.code() != boost::beast::http::status::ok)
+    {
+        std::cout << "Update server has no modrinth index, all mods come from the update server.\n";
+        return {};
+    }
+
+    const auto parsed = json::parse(response, nullptr, false);
+    if (parsed.is_discarded())
+    {
+        std::cout << "Could not parse modrinth index, ignoring it.\n";
+        return {};
+    }
+    return parseModrinthIndex(parsed);
+}
+
+ModrinthIndex UpdateClient::parseModrinthIndex(json const& modrinthIndex) const
+{
+    ModrinthIndex index;
+    try
+    {
+        for (auto const& file : modrinthIndex.at("files"))
+        {
+            const auto path = std::filesystem::path{file.at("path").get<std::string>()};
+            if (path.parent_path() != "mods")
+                continue;
+            const auto env = file.value("env", json::object());
+            index[path.filename().string()] = IndexedMod{
+                .sha1 = file.at("hashes").value("sha1", ""),
+                .sha512 = file.at("hashes").value("sha512", ""),
+                .downloads = file.value("downloads", std::vector<std::string>{}),
+                .client = env.value("client", "required") != "unsupported",
+                .server = env.value("server", "required") != "unsupported",
+            };
+        }
+    }
+    catch (std::exception const& exc)
+    {
+        std::cout << "Could not parse modrinth index, ignoring it: " << exc.what() << "\n";
+        return {};
+    }
+    return index;
+}
+
+void UpdateClient::applyModrinthIndex(UpdateInstructions& instructions, ModrinthIndex const& index) const
+{
+    // The difference is built against the mods folder of the server, which lacks client only mods and has server
+    // only mods the client must not load.
+    std::erase_if(instructions.download, [&index](std::string const& name) {
+        auto it = index.find(name);
+        return it != index.end() && !it->second.client;
+    });
+
+    const auto modsDirectory = getClientDir() / "mods";
+    for (auto const& [name, mod] : index)
+    {
+        if (!mod.client || mod.server || conf_.ignoreMods.contains(name))
+            continue;
+
+        std::erase(instructions.remove, name);
+        const auto local = modsDirectory / name;
+        if (!std::filesystem::exists(local) || hashesFromFile(local).sha1 != mod.sha1)
+            instructions.download.push_back(name);
+    }
 }
 
 std::vector<HashedMod> UpdateClient::loadLocalMods()
@@ -200,7 +539,7 @@ std::vector<HashedMod> UpdateClient::loadLocalMods()
     {
         const auto modsDirectory = getClientDir() / "mods";
         std::filesystem::directory_iterator mods{modsDirectory}, end;
-        std::vector<HashedMod> localMods;
+        std::vector<std::filesystem::path> paths;
 
         for (; mods != end; ++mods)
         {
@@ -210,11 +549,18 @@ std::vector<HashedMod> UpdateClient::loadLocalMods()
                 continue;
             }
             if (conf_.ignoreMods.find(mods->path().filename().string()) == conf_.ignoreMods.end())
-                localMods.push_back(
-                    {.path = mods->path(),
-                     .name = mods->path().filename().string(),
-                     .hash = sha256FromFile(mods->path())});
+                paths.push_back(mods->path());
         }
+        std::sort(paths.begin(), paths.end());
+
+        const auto hashes = ParallelHasher{}.hash(paths, [](std::filesystem::path const& path) {
+            return sha256FromFile(path);
+        });
+
+        std::vector<HashedMod> localMods;
+        localMods.reserve(paths.size());
+        for (std::size_t i = 0; i != paths.size(); ++i)
+            localMods.push_back({.path = paths[i], .name = paths[i].filename().string(), .hash = hashes[i]});
         return localMods;
     }
     catch (const std::exception& e)
@@ -231,21 +577,210 @@ void UpdateClient::removeOldMods(std::vector<std::string> const& removalList)
         std::filesystem::remove(modsDirectory / remove);
 }
 
-void UpdateClient::downloadMods(std::vector<std::string> const& downloadList)
+void UpdateClient::applyPatches(std::vector<PatchInstruction> const& patches, UpdateInstructions& instructions) const
+{
+    const auto modsDirectory = getClientDir() / "mods";
+    for (auto const& patch : patches)
+    {
+        const auto isPlainName = [](std::string const& name) {
+            return !name.empty() && name.find_first_of("/\\") == std::string::npos;
+        };
+        if (!isPlainName(patch.name) || !isPlainName(patch.from) ||
+            std::find(instructions.download.begin(), instructions.download.end(), patch.name) ==
+                instructions.download.end())
+        {
+            continue;
+        }
+
+        try
+        {
+            Roar::Curl::Request req;
+            std::string delta;
+            const auto res = req.sink(delta).get(url("/patch/" + patch.fromHash + "/" + patch.hash));
+            if (res.code() != boost::beast::http::status::ok)
+                continue;
+
+            const auto patched = Delta::apply(Delta::readFile(modsDirectory / patch.from), delta);
+            Hashing::MultiDigest digest{Hashing::Sha256};
+            digest.update(patched.data(), patched.size());
+            if (digest.finish().sha256 != patch.hash)
+            {
+                std::cout << "Patched " << patch.name << " has the wrong hash, downloading it whole.\n";
+                continue;
+            }
+
+            const auto target = modsDirectory / patch.name;
+            const auto partial = std::filesystem::path{target.string() + ".part"};
+            {
+                std::ofstream writer{partial, std::ios_base::binary};
+                writer.write(patched.data(), static_cast<std::streamsize>(patched.size()));
+                if (!writer.good())
+                    throw std::runtime_error("Could not write " + partial.string());
+            }
+            std::filesystem::rename(partial, target);
+            // A mod patched under the same name must not be removed afterwards.
+            std::erase(instructions.download, patch.name);
+            std::erase(instructions.remove, patch.name);
+            std::cout << "Patched " << patch.from << " to " << patch.name << " with " << delta.size() << " bytes.\n";
+        }
+        catch (std::exception const& exc)
+        {
+            std::cout << "Patching " << patch.name << " failed, downloading it whole: " << exc.what() << "\n";
+        }
+    }
+}
+
+bool UpdateClient::downloadMods(
+    std::vector<std::string> const& downloadList,
+    ModrinthIndex const& index,
+    std::map<std::string, BlobDownload> const& blobs)
 {
     const auto modsDirectory = getClientDir() / "mods";
     cbs_.onDownloadProgress(0, downloadList.size(), "No File");
-    int i = 0;
-    for (auto const& download : downloadList)
+
+    std::mutex progressGuard;
+    int done = 0;
+    auto progress = [&](std::string const& name) {
+        std::scoped_lock lock{progressGuard};
+        cbs_.onDownloadProgress(++done, downloadList.size(), name);
+    };
+
+    // Mods with a known origin are fetched from there in parallel, the rest comes from the update server in a
+    // single bundle.
+    std::vector<std::string> fromServer;
+    std::atomic_size_t next{0};
+    auto worker = [&]() {
+        for (auto i = next++; i < downloadList.size(); i = next++)
+        {
+            auto const& download = downloadList[i];
+            const auto indexed = index.find(download);
+            if (indexed != index.end() && downloadFromOrigin(modsDirectory / download, indexed->second))
+            {
+                progress(download);
+                continue;
+            }
+            std::scoped_lock lock{progressGuard};
+            fromServer.push_back(download);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    const auto threadCount = std::min<std::size_t>(parallelDownloads, downloadList.size());
+    for (std::size_t i = 0; i < threadCount; ++i)
+        workers.emplace_back(worker);
+    for (auto& thread : workers)
+        thread.join();
+
+    const auto received = downloadBundle(fromServer, progress);
+    bool success = true;
+    for (auto const& download : fromServer)
     {
-        Roar::Curl::Request req;
-        std::ofstream writer{modsDirectory / download, std::ios_base::binary};
-        cbs_.onDownloadProgress(1 + i++, downloadList.size(), download);
-        req.sink([&writer](char const* buf, std::size_t count) {
-               writer.write(buf, count);
-           })
-            .get(url("/download_mod/"s + Roar::urlEncode(download)));
+        if (received.contains(download))
+            continue;
+        const auto blob = blobs.find(download);
+        success &=
+            downloadFromServer(modsDirectory / download, download, blob == blobs.end() ? nullptr : &blob->second);
+        progress(download);
     }
+    return success;
+}
+
+std::set<std::string> UpdateClient::downloadBundle(
+    std::vector<std::string> const& names,
+    std::function<void(std::string const&)> const& onFile) const
+{
+    std::set<std::string> received;
+    if (names.empty())
+        return received;
+
+    Tar::StreamExtractor extractor{getClientDir() / "mods", [&](std::string const& name) {
+                                       received.insert(name);
+                                       onFile(name);
+                                   }};
+    std::optional<std::string> error;
+    Roar::Curl::Request req;
+    if (pinnedGeneration_)
+        req.setHeader(generationHeader, std::to_string(*pinnedGeneration_));
+    const auto res = req.setHeader("Expect", "")
+                         .source(json{{"mods", names}}.dump())
+                         .sink([&extractor, &error](char const* buf, std::size_t count) {
+                             // Must not throw through curl, the rest of the stream is dropped instead.
+                             if (error)
+                                 return;
+                             try
+                             {
+                                 extractor.feed(buf, count);
+                             }
+                             catch (std::exception const& exc)
+                             {
+                                 error = exc.what();
+                             }
+                         })
+                         .post(url("/download_bundle"));
+
+    if (res.code() == boost::beast::http::status::gone)
+        std::cout << "Update server removed the mods this update started from, update again.\n";
+    else if (res.code() != boost::beast::http::status::ok)
+        std::cout << "Update server cannot send bundles, downloading mods one by one.\n";
+    else if (error)
+        std::cout << "Mod bundle broken off: " << *error << "\n";
+    else if (!extractor.finished())
+        std::cout << "Mod bundle ended early.\n";
+    return received;
+}
+
+bool UpdateClient::downloadFromOrigin(std::filesystem::path const& target, IndexedMod const& mod) const
+{
+    for (auto const& origin : mod.downloads)
+    {
+        {
+            Roar::Curl::Request req;
+            std::ofstream writer{target, std::ios_base::binary};
+            const auto res = req.sink([&writer](char const* buf, std::size_t count) {
+                                    writer.write(buf, count);
+                                })
+                                 .followRedirects(true)
+                                 .get(origin);
+            if (res.code() != boost::beast::http::status::ok)
+                continue;
+        }
+
+        const auto hashes = hashesFromFile(target);
+        if ((mod.sha512.empty() || hashes.sha512 == mod.sha512) && (mod.sha1.empty() || hashes.sha1 == mod.sha1))
+            return true;
+        std::cout << "Hash mismatch for " << target.filename().string() << " from " << origin << "\n";
+    }
+    return false;
+}
+
+bool UpdateClient::downloadFromServer(
+    std::filesystem::path const& target,
+    std::string const& name,
+    BlobDownload const* blob) const
+{
+    Roar::Curl::Request req;
+    if (pinnedGeneration_)
+        req.setHeader(generationHeader, std::to_string(*pinnedGeneration_));
+    std::optional<boost::beast::http::status> status;
+    {
+        std::ofstream writer{target, std::ios_base::binary};
+        status = req.sink([&writer](char const* buf, std::size_t count) {
+                        writer.write(buf, count);
+                    })
+                     .get(url(blob ? blob->url : "/download_mod/"s + Roar::urlEncode(name)))
+                     .code();
+    }
+    std::error_code ec;
+    if (status == boost::beast::http::status::ok &&
+        (!blob || (std::filesystem::file_size(target, ec) == blob->size && sha256FromFile(target) == blob->sha256)))
+    {
+        return true;
+    }
+
+    // Do not leave the error page behind as a jar.
+    std::cout << "Could not download " << name << "\n";
+    std::filesystem::remove(target);
+    return false;
 }
 
 std::string UpdateClient::url(std::string const& path) const
@@ -1,13 +1,18 @@
 #pragma once
 
 #include "config.hpp"
+#include <update_server/file_hashes.hpp>
+#include <update_server/parallel_hasher.hpp>
 #include <update_server/sha256.hpp>
 
 #include <nlohmann/json.hpp>
 
+#include <cstdint>
 #include <filesystem>
 #include <functional>
+#include <map>
 #include <optional>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -24,15 +29,95 @@ struct UpdateInstructions
     std::vector<std::string> remove;
 };
 
+/**
+ * @brief A mod the update server can send as binary patch against a version the client already has.
+ */
+struct PatchInstruction
+{
+    std::string name;
+    std::string hash;
+    std::string from;
+    std::string fromHash;
+};
+
+/**
+ * @brief A mod of the modrinth.index.json the update server publishes, downloadable from its origin.
+ */
+struct IndexedMod
+{
+    std::string sha1;
+    std::string sha512;
+    std::vector<std::string> downloads;
+    bool client = true;
+    bool server = true;
+};
+
+/// Indexed mods by file name.
+using ModrinthIndex = std::map<std::string, IndexedMod>;
+
+/**
+ * @brief What the client knows after the last complete update. Kept in the client directory.
+ */
+struct ManifestState
+{
+    /// ETag of the server manifest generation the mods were updated to.
+    std::string etag;
+    /// Names, sizes and modification times of the local mods right after that update.
+    std::string localFingerprint;
+};
+
+struct ManifestCheck
+{
+    bool upToDate = false;
+    std::string etag;
+    /// Only set if the server is exactly one generation ahead.
+    std::optional<UpdateInstructions> changelog;
+    std::vector<PatchInstruction> patches;
+    /// std::nullopt from servers that do not keep generations.
+    std::optional<std::uint64_t> generation;
+};
+
 struct Versions
 {
     std::string loaderVersion;
     std::string minecraftVersion;
 };
 
+/**
+ * @brief A mod to download from the update server by its content, the url never changes for the same bytes.
+ */
+struct BlobDownload
+{
+    std::string name;
+    std::string sha256;
+    std::uint64_t size = 0;
+    std::string url;
+};
+
+/**
+ * @brief The answer of /sync, all the client needs to start every transfer at once.
+ */
+struct SyncResponse
+{
+    bool upToDate = false;
+    /// The instructions are the changelog since the known generation, not a diff to the local mods.
+    bool fromChangelog = false;
+    std::string etag;
+    std::optional<Versions> versions;
+    ModrinthIndex index;
+    UpdateInstructions instructions;
+    std::vector<PatchInstruction> patches;
+    /// By mod name.
+    std::map<std::string, BlobDownload> blobs;
+    std::optional<std::uint64_t> generation;
+};
+
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(HashedMod, name, hash)
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(UpdateInstructions, download, remove)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(PatchInstruction, name, hash, from, fromHash)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(ManifestState, etag, localFingerprint)
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(Versions, loaderVersion, minecraftVersion)
+NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(BlobDownload, name, sha256, size, url)
 
 class UpdateClient
 {
@@ -43,18 +128,90 @@ class UpdateClient
         std::function<void(int, int, std::string const&)> onDownloadProgress;
     };
 
+  public:
+    constexpr static unsigned int parallelDownloads = 8;
+
   public:
     UpdateClient(std::filesystem::path selfDirectory, std::string remoteAddress, unsigned short port);
     void performUpdate(Config const& conf, ProgressCallbacks const& cbs);
     std::filesystem::path getClientDir() const;
 
   private:
+    /**
+     * @brief Gets versions, modrinth index and the mods to change in one request. std::nullopt if the server is too
+     * old to have /sync.
+     */
+    std::optional<SyncResponse> sync(std::optional<ManifestState> const& state);
     void updateMods();
+    void updateMods(SyncResponse const& synced);
+
+    /**
+     * @brief Patches, removes and downloads as instructed and remembers the generation if everything arrived.
+     */
+    void applyUpdate(
+        UpdateInstructions instructions,
+        std::vector<PatchInstruction> const& patches,
+        ModrinthIndex const& index,
+        std::string const& etag,
+        std::map<std::string, BlobDownload> const& blobs);
+
+    /**
+     * @brief The full diff never sees ignored mods, changes taken from a changelog must not touch them either.
+     */
+    void dropIgnoredMods(UpdateInstructions& instructions) const;
+
+    /**
+     * @brief Asks the server whether its mods changed since the last update.
+     */
+    ManifestCheck checkManifest(std::optional<ManifestState> const& state) const;
+    std::optional<ManifestState> loadManifestState() const;
+    void saveManifestState(std::string const& etag) const;
+
+    /**
+     * @brief Cheap fingerprint of the mods folder from names, sizes and modification times, detects local changes
+     * without hashing.
+     */
+    std::string localModsFingerprint() const;
     std::string url(std::string const& path) const;
     std::vector<HashedMod> loadLocalMods();
     void removeOldMods(std::vector<std::string> const& removalList);
-    void downloadMods(std::vector<std::string> const& downloadList);
-    void installFabric();
+
+    /**
+     * @brief Patches mods from the versions that are still in the mods folder and takes them off the download list.
+     * A patch that fails or produces the wrong hash leaves the mod to be downloaded whole.
+     */
+    void applyPatches(std::vector<PatchInstruction> const& patches, UpdateInstructions& instructions) const;
+    ModrinthIndex loadModrinthIndex();
+    ModrinthIndex parseModrinthIndex(nlohmann::json const& modrinthIndex) const;
+    void applyModrinthIndex(UpdateInstructions& instructions, ModrinthIndex const& index) const;
+
+    /**
+     * @return False if any mod could not be downloaded.
+     */
+    bool downloadMods(
+        std::vector<std::string> const& downloadList,
+        ModrinthIndex const& index,
+        std::map<std::string, BlobDownload> const& blobs);
+
+    /**
+     * @brief Streams the mods from the update server as one tar into the mods folder.
+     *
+     * @return The mods that were received completely, the server leaves out those it does not have.
+     */
+    std::set<std::string> downloadBundle(
+        std::vector<std::string> const& names,
+        std::function<void(std::string const&)> const& onFile) const;
+    bool downloadFromOrigin(std::filesystem::path const& target, IndexedMod const& mod) const;
+
+    /**
+     * @param blob If known, the mod is fetched by its content and checked against size and hash.
+     */
+    bool downloadFromServer(
+        std::filesystem::path const& target,
+        std::string const& name,
+        BlobDownload const* blob) const;
+    Versions fetchVersions() const;
+    void installFabric(Versions const& versions);
     std::optional<std::filesystem::path> findJava() const;
 
   private:
@@ -63,4 +220,7 @@ class UpdateClient
     std::filesystem::path selfDirectory_;
     std::string remoteAddress_;
     unsigned short port_;
+    /// The server generation the update diffed against. Downloads ask for exactly its files, even if the server
+    /// publishes new mods meanwhile.
+    std::optional<std::uint64_t> pinnedGeneration_;
 };
\ No newline at end of file
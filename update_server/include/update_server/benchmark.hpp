@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+
+/**
+ * @brief Measurements of the update server hot paths. They run from the command line instead of serving, so they can
+ * be pointed at a real mods folder.
+ */
+namespace Benchmark
+{
+    /**
+     * @brief Hashes every file of the directory with the previous sha256FromFile implementation and with the hashing
+     * engine and prints the throughput of each in GB/s.
+     */
+    void hashing(std::filesystem::path const& directory, unsigned int repetitions);
+
+    /**
+     * @brief Diffs a synthetic client mod list against as many server mods with the previous set based
+     * buildDifference and with ModIndex and prints the time per request of each.
+     */
+    void difference(std::size_t entries, unsigned int repetitions);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <backend/launch_profile.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Keeps an AppCDS archive for the current server.jar, so the game server does not load and verify the same
+ * classes again on every start. When there is none for the current setup, a training run starts the server without
+ * mods on a throwaway world in a scratch directory and dumps the loaded classes into an archive when it stops.
+ *
+ * The JVM archives classes of its own class loaders only: those of the JDK, the Fabric loader and its libraries.
+ * Minecraft and the mods go through Fabric's class loader and are not part of the archive, so the archive depends on
+ * server.jar, the loader libraries, the Java installation and the launch profile, but not on the mods.
+ */
+class ClassDataSharing
+{
+  public:
+    /// Lets the game server finish its own start first, the training would only slow it down.
+    constexpr static std::chrono::seconds trainingDelay{60};
+    /// Generating the spawn area of a new world takes minutes on a slow machine.
+    constexpr static std::chrono::minutes trainingTimeout{10};
+    constexpr static std::chrono::minutes stopTimeout{2};
+
+    /**
+     * @param profile The profile the game server is started with, training uses its collector with a small heap.
+     */
+    ClassDataSharing(std::filesystem::path serverDirectory, std::filesystem::path directory, LaunchProfile profile);
+    ~ClassDataSharing();
+    ClassDataSharing(ClassDataSharing const&) = delete;
+    ClassDataSharing& operator=(ClassDataSharing const&) = delete;
+
+    /**
+     * @brief JVM arguments that use the archive for the current setup, empty if there is none yet.
+     */
+    std::vector<std::string> jvmArguments() const;
+
+    /**
+     * @brief Trains an archive for the current setup in the background after trainingDelay, unless there is one.
+     */
+    void train();
+
+  private:
+    void run();
+    void trainNow();
+    void prepareScratchDirectory(std::filesystem::path const& scratch) const;
+    /**
+     * @brief Over server.jar, the loader libraries, the Java installation and the launch profile.
+     */
+    std::string fingerprint() const;
+    std::filesystem::path archiveFile(std::string const& fingerprint) const;
+
+  private:
+    std::filesystem::path serverDirectory_;
+    std::filesystem::path directory_;
+    LaunchProfile profile_;
+    std::mutex guard_;
+    std::condition_variable wake_;
+    bool requested_;
+    bool stop_;
+    std::thread thread_;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+/**
+ * @brief The message of a console line the game server logged from its main thread at this level, like "INFO" or
+ * "WARN". Chat and the commands of players are logged the same way, but their messages start with the name of the
+ * player, so comparing the whole message against what the server itself prints cannot be fooled by them.
+ *
+ * Understands the layouts of vanilla "[12:34:56] [Server thread/INFO]: message", Fabric
+ * "[12:34:56] [Server thread/INFO] (Minecraft) message" and Forge
+ * "[12:34:56] [Server thread/INFO] [minecraft/DedicatedServer]: message".
+ */
+inline std::optional<std::string_view> serverMessage(std::string_view line, std::string_view level)
+{
+    constexpr std::string_view thread = "[Server thread/";
+    // The timestamp.
+    if (!line.starts_with('['))
+        return std::nullopt;
+    const auto timeEnd = line.find("] ");
+    if (timeEnd == std::string_view::npos)
+        return std::nullopt;
+    line.remove_prefix(timeEnd + 2);
+
+    if (!line.starts_with(thread) || !line.substr(thread.size()).starts_with(level) ||
+        !line.substr(thread.size() + level.size()).starts_with(']'))
+    {
+        return std::nullopt;
+    }
+    line.remove_prefix(thread.size() + level.size() + 1);
+
+    if (line.starts_with(": "))
+        return line.substr(2);
+    // After the name of the logger, its first closing bracket cannot be part of the message.
+    if (line.starts_with(" ("))
+    {
+        if (const auto end = line.find(") "); end != std::string_view::npos)
+            return line.substr(end + 2);
+    }
+    else if (line.starts_with(" ["))
+    {
+        if (const auto end = line.find("]: "); end != std::string_view::npos)
+            return line.substr(end + 3);
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <zstd.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+/**
+ * @brief Binary patches between two versions of a file, in the format of zstd --patch-from: a zstd frame that was
+ * compressed with the old file as prefix, so everything the versions have in common costs almost nothing.
+ */
+namespace Delta
+{
+    /// Files above this are not patched, the old and new version are held in memory on both ends.
+    constexpr std::uint64_t maximumFileSize = 512ull * 1024 * 1024;
+
+    namespace Detail
+    {
+        struct CompressDeleter
+        {
+            void operator()(ZSTD_CCtx* context) const
+            {
+                ZSTD_freeCCtx(context);
+            }
+        };
+        struct DecompressDeleter
+        {
+            void operator()(ZSTD_DCtx* context) const
+            {
+                ZSTD_freeDCtx(context);
+            }
+        };
+
+        inline void check(std::size_t result)
+        {
+            if (ZSTD_isError(result))
+                throw std::runtime_error(std::string{"zstd: "} + ZSTD_getErrorName(result));
+        }
+
+        /**
+         * @brief The match window has to reach back over the whole old file from the end of the new one.
+         */
+        inline int windowLog(std::uint64_t referenceSize, std::uint64_t targetSize)
+        {
+            const auto bounds = ZSTD_cParam_getBounds(ZSTD_c_windowLog);
+            const auto needed = static_cast<int>(std::bit_width(referenceSize + targetSize));
+            return std::clamp(needed, bounds.lowerBound, bounds.upperBound);
+        }
+    }
+
+    inline std::string readFile(std::filesystem::path const& path)
+    {
+        if (std::filesystem::file_size(path) > maximumFileSize)
+            throw std::runtime_error("File too large to patch: " + path.string());
+        std::ifstream reader{path, std::ios_base::binary};
+        if (!reader.good())
+            throw std::runtime_error("Could not open " + path.string());
+        return std::string{std::istreambuf_iterator<char>{reader}, std::istreambuf_iterator<char>{}};
+    }
+
+    /**
+     * @brief Creates the patch that turns reference into target.
+     */
+    inline std::string create(std::string const& reference, std::string const& target, int level = 15)
+    {
+        std::unique_ptr<ZSTD_CCtx, Detail::CompressDeleter> context{ZSTD_createCCtx()};
+        if (!context)
+            throw std::bad_alloc{};
+        Detail::check(ZSTD_CCtx_setParameter(context.get(), ZSTD_c_compressionLevel, level));
+        Detail::check(ZSTD_CCtx_setParameter(context.get(), ZSTD_c_enableLongDistanceMatching, 1));
+        Detail::check(ZSTD_CCtx_setParameter(
+            context.get(), ZSTD_c_windowLog, Detail::windowLog(reference.size(), target.size())));
+        Detail::check(ZSTD_CCtx_refPrefix(context.get(), reference.data(), reference.size()));
+
+        std::string patch(ZSTD_compressBound(target.size()), '\0');
+        const auto size =
+            ZSTD_compress2(context.get(), patch.data(), patch.size(), target.data(), target.size());
+        Detail::check(size);
+        patch.resize(size);
+        return patch;
+    }
+
+    /**
+     * @brief Applies a patch made by create with the same reference. Throws if the patch is broken or was made
+     * against another reference, callers still have to verify the hash of the result.
+     */
+    inline std::string apply(std::string const& reference, std::string const& patch)
+    {
+        const auto contentSize = ZSTD_getFrameContentSize(patch.data(), patch.size());
+        if (contentSize == ZSTD_CONTENTSIZE_ERROR || contentSize == ZSTD_CONTENTSIZE_UNKNOWN ||
+            contentSize > maximumFileSize)
+        {
+            throw std::runtime_error("Patch has no usable content size");
+        }
+
+        std::unique_ptr<ZSTD_DCtx, Detail::DecompressDeleter> context{ZSTD_createDCtx()};
+        if (!context)
+            throw std::bad_alloc{};
+        Detail::check(ZSTD_DCtx_setParameter(
+            context.get(), ZSTD_d_windowLogMax, ZSTD_dParam_getBounds(ZSTD_d_windowLogMax).upperBound));
+        Detail::check(ZSTD_DCtx_refPrefix(context.get(), reference.data(), reference.size()));
+
+        std::string target(contentSize, '\0');
+        ZSTD_inBuffer input{patch.data(), patch.size(), 0};
+        ZSTD_outBuffer output{target.data(), target.size(), 0};
+        while (input.pos != input.size)
+        {
+            const auto remaining = ZSTD_decompressStream(context.get(), &output, &input);
+            Detail::check(remaining);
+            if (remaining == 0)
+                break;
+            if (output.pos == output.size)
+                throw std::runtime_error("Patch produces more than its content size");
+        }
+        if (output.pos != target.size())
+            throw std::runtime_error("Patch is truncated");
+        return target;
+    }
+}
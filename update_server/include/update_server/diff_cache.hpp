@@ -0,0 +1,53 @@
+#pragma once
+
+#include <update_server/mod_index.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief sha256 over the sorted name and hash pairs a client sent. Clients with the same mods have the same
+ * fingerprint, no matter in which order they list them.
+ */
+std::string clientFingerprint(std::vector<ModAndHash> const& files);
+
+/**
+ * @brief Least recently used cache of make_file_difference responses by client fingerprint. Entries belong to one
+ * mod snapshot, the first entry of a newer snapshot drops all others. Entries of older snapshots are ignored, so a
+ * handler that finishes after a publish cannot push out the answers for the new one.
+ */
+class DiffCache
+{
+  public:
+    explicit DiffCache(std::size_t capacity);
+
+    std::optional<std::string> find(std::string const& snapshotEtag, std::string const& fingerprint);
+    void insert(
+        std::uint64_t generation,
+        std::string const& snapshotEtag,
+        std::string const& fingerprint,
+        std::string response);
+
+    std::size_t hits() const;
+    std::size_t misses() const;
+
+  private:
+    using Entry = std::pair<std::string, std::string>;
+
+    mutable std::mutex guard_;
+    std::size_t capacity_;
+    std::uint64_t generation_;
+    std::string snapshotEtag_;
+    /// Most recently used first.
+    std::list<Entry> entries_;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    std::size_t hits_;
+    std::size_t misses_;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <update_server/hashing.hpp>
+
+#include <filesystem>
+#include <string>
+
+/**
+ * @brief The hashes modrinth publishes for each file, see https://docs.modrinth.com/modpacks/format.
+ */
+struct FileHashes
+{
+    std::string sha1;
+    std::string sha512;
+};
+
+/**
+ * @brief Computes sha1 and sha512 of the file in a single read.
+ */
+[[maybe_unused]] static FileHashes hashesFromFile(std::filesystem::path const& source)
+{
+    auto digests = Hashing::hashFile(source, Hashing::Sha1 | Hashing::Sha512);
+    return FileHashes{.sha1 = std::move(digests.sha1), .sha512 = std::move(digests.sha512)};
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/core/file.hpp>
+#include <boost/beast/http/error.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/optional.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/**
+ * @brief What a Range header asks for, see RFC 9110 14.2.
+ */
+struct RangeRequest
+{
+    enum class Kind
+    {
+        Full,
+        Partial,
+        Unsatisfiable
+    };
+
+    Kind kind = Kind::Full;
+    std::uint64_t begin = 0;
+    // Exclusive.
+    std::uint64_t end = 0;
+};
+
+/**
+ * @brief Parses a single "bytes=" range. Multiple ranges and anything malformed are ignored, which the RFC allows,
+ * so the whole file is served instead.
+ */
+[[maybe_unused]] static RangeRequest parseRange(std::string_view header, std::uint64_t size)
+{
+    const auto full = RangeRequest{.kind = RangeRequest::Kind::Full, .begin = 0, .end = size};
+    constexpr std::string_view unit = "bytes=";
+    if (!header.starts_with(unit) || header.find(',') != std::string_view::npos)
+        return full;
+    header.remove_prefix(unit.size());
+
+    const auto dash = header.find('-');
+    if (dash == std::string_view::npos)
+        return full;
+
+    const auto parseNumber = [](std::string_view text) -> boost::optional<std::uint64_t> {
+        std::uint64_t value = 0;
+        const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (text.empty() || ec != std::errc{} || end != text.data() + text.size())
+            return boost::none;
+        return value;
+    };
+
+    const auto first = header.substr(0, dash);
+    const auto last = header.substr(dash + 1);
+    RangeRequest range{.kind = RangeRequest::Kind::Partial, .begin = 0, .end = size};
+    if (first.empty())
+    {
+        // Suffix range: the last n bytes.
+        const auto suffix = parseNumber(last);
+        if (!suffix)
+            return full;
+        if (*suffix == 0 || size == 0)
+            return {.kind = RangeRequest::Kind::Unsatisfiable};
+        range.begin = size - std::min(*suffix, size);
+        return range;
+    }
+
+    const auto begin = parseNumber(first);
+    if (!begin)
+        return full;
+    if (*begin >= size)
+        return {.kind = RangeRequest::Kind::Unsatisfiable};
+    range.begin = *begin;
+    if (!last.empty())
+    {
+        const auto end = parseNumber(last);
+        if (!end || *end < *begin)
+            return full;
+        range.end = std::min(*end + 1, size);
+    }
+    return range;
+}
+
+/**
+ * @brief A beast body that sends a byte range of a file. Unlike file_body it reads in large chunks, so big jars go
+ * out with few syscalls.
+ */
+struct FileRangeBody
+{
+    class value_type
+    {
+      public:
+        void open(char const* path, boost::beast::error_code& ec)
+        {
+            file_.open(path, boost::beast::file_mode::scan, ec);
+            if (ec)
+                return;
+            fileSize_ = file_.size(ec);
+            begin_ = 0;
+            end_ = fileSize_;
+        }
+
+        bool is_open() const
+        {
+            return file_.is_open();
+        }
+
+        std::uint64_t fileSize() const
+        {
+            return fileSize_;
+        }
+
+        void range(std::uint64_t begin, std::uint64_t end)
+        {
+            begin_ = std::min(begin, fileSize_);
+            end_ = std::clamp(end, begin_, fileSize_);
+        }
+
+      private:
+        friend struct FileRangeBody;
+
+        boost::beast::file file_{};
+        std::uint64_t fileSize_ = 0;
+        std::uint64_t begin_ = 0;
+        std::uint64_t end_ = 0;
+    };
+
+    static std::uint64_t size(value_type const& body)
+    {
+        return body.end_ - body.begin_;
+    }
+
+    class writer
+    {
+      public:
+        using const_buffers_type = boost::asio::const_buffer;
+
+        template <bool isRequest, class Fields>
+        writer(boost::beast::http::header<isRequest, Fields>&, value_type& body)
+            : body_{body}
+            , remaining_{body.end_ - body.begin_}
+        {}
+
+        void init(boost::beast::error_code& ec)
+        {
+            body_.file_.seek(body_.begin_, ec);
+        }
+
+        boost::optional<std::pair<const_buffers_type, bool>> get(boost::beast::error_code& ec)
+        {
+            const auto amount = static_cast<std::size_t>(std::min<std::uint64_t>(remaining_, sizeof(buffer_)));
+            if (amount == 0)
+            {
+                ec = {};
+                return boost::none;
+            }
+            const auto read = body_.file_.read(buffer_, amount, ec);
+            if (ec)
+                return boost::none;
+            if (read == 0)
+            {
+                // The file shrunk while it was sent.
+                ec = boost::beast::http::error::short_read;
+                return boost::none;
+            }
+            remaining_ -= read;
+            return {{const_buffers_type{buffer_, read}, remaining_ > 0}};
+        }
+
+      private:
+        value_type& body_;
+        std::uint64_t remaining_;
+        char buffer_[64 * 1024];
+    };
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Persistent sha256 cache for the mods folder. An entry stays valid as long as inode, size and modification
+ * time of the file are unchanged, so only new or replaced jars are hashed again.
+ */
+class HashCache
+{
+  public:
+    explicit HashCache(std::filesystem::path cacheFile);
+
+    /**
+     * @brief Reads the cache file. A missing or unreadable file starts an empty cache.
+     */
+    void load();
+
+    /**
+     * @brief Writes the cache file if anything changed since the last load or save.
+     */
+    void save();
+
+    /**
+     * @brief Returns the cached hash if the file is unchanged, hashes it otherwise.
+     */
+    std::string sha256(std::filesystem::path const& file);
+
+    /**
+     * @brief Records the hash of a file that was hashed elsewhere, like while it was uploaded.
+     */
+    void remember(std::filesystem::path const& file, std::string const& sha256);
+
+    /**
+     * @brief Drops all entries for files that are not in the list.
+     */
+    void retainOnly(std::vector<std::filesystem::path> const& files);
+
+    std::size_t hashesComputed() const;
+
+  private:
+    struct Entry
+    {
+        std::uint64_t inode;
+        std::uintmax_t size;
+        std::int64_t modified;
+        std::string sha256;
+    };
+    static Entry identify(std::filesystem::path const& file);
+
+  private:
+    mutable std::mutex guard_;
+    std::filesystem::path cacheFile_;
+    std::unordered_map<std::string, Entry> entries_;
+    bool dirty_;
+    std::size_t hashesComputed_;
+};
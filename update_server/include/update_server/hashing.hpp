@@ -0,0 +1,191 @@
+#pragma once
+
+#include <openssl/evp.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#ifndef _WIN32
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+/**
+ * @brief File hashing for mod scans. Goes through the EVP interface, so openssl picks the SHA-NI or ARMv8 crypto
+ * extension implementations where available, maps files instead of copying them through stream buffers and computes
+ * all requested digests in a single pass over the data.
+ */
+namespace Hashing
+{
+    enum Algorithm : unsigned int
+    {
+        Sha1 = 1 << 0,
+        Sha256 = 1 << 1,
+        Sha512 = 1 << 2,
+    };
+
+    /**
+     * @brief Hex encoded digests, only the requested ones are set.
+     */
+    struct Digests
+    {
+        std::string sha1;
+        std::string sha256;
+        std::string sha512;
+    };
+
+    /// Files are read in chunks of this size where they cannot be mapped.
+    constexpr std::size_t readBufferSize = 1 << 20;
+    /// Mapped files are fed to the digests in chunks of this size.
+    constexpr std::size_t digestChunkSize = 64 << 10;
+
+    inline std::string toHex(unsigned char const* data, std::size_t size)
+    {
+        constexpr char const* digits = "0123456789abcdef";
+        std::string hex(size * 2, '\0');
+        for (std::size_t i = 0; i != size; ++i)
+        {
+            hex[i * 2] = digits[data[i] >> 4];
+            hex[i * 2 + 1] = digits[data[i] & 0x0f];
+        }
+        return hex;
+    }
+
+    /**
+     * @brief Feeds the same data into several digests at once.
+     */
+    class MultiDigest
+    {
+      public:
+        explicit MultiDigest(unsigned int algorithms)
+        {
+            const std::array<EVP_MD const*, 3> digests{EVP_sha1(), EVP_sha256(), EVP_sha512()};
+            for (std::size_t i = 0; i != contexts_.size(); ++i)
+            {
+                if ((algorithms & (1u << i)) == 0)
+                    continue;
+                contexts_[i] = ContextPointer{EVP_MD_CTX_new(), &EVP_MD_CTX_free};
+                if (!contexts_[i] || !EVP_DigestInit_ex(contexts_[i].get(), digests[i], nullptr))
+                    throw std::runtime_error("Could not initialize hash context.");
+            }
+        }
+
+        void update(void const* data, std::size_t size)
+        {
+            for (auto& context : contexts_)
+            {
+                if (context && !EVP_DigestUpdate(context.get(), data, size))
+                    throw std::runtime_error("Could not feed hash data");
+            }
+        }
+
+        Digests finish()
+        {
+            std::array<std::string, 3> hex;
+            for (std::size_t i = 0; i != contexts_.size(); ++i)
+            {
+                if (!contexts_[i])
+                    continue;
+                unsigned char hash[EVP_MAX_MD_SIZE];
+                unsigned int length = 0;
+                if (!EVP_DigestFinal_ex(contexts_[i].get(), hash, &length))
+                    throw std::runtime_error("Could not finalize hash");
+                hex[i] = toHex(hash, length);
+            }
+            return Digests{.sha1 = std::move(hex[0]), .sha256 = std::move(hex[1]), .sha512 = std::move(hex[2])};
+        }
+
+      private:
+        using ContextPointer = std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)>;
+        std::array<ContextPointer, 3> contexts_{
+            ContextPointer{nullptr, &EVP_MD_CTX_free},
+            ContextPointer{nullptr, &EVP_MD_CTX_free},
+            ContextPointer{nullptr, &EVP_MD_CTX_free},
+        };
+    };
+
+    namespace Detail
+    {
+        inline void readBuffered(std::filesystem::path const& source, MultiDigest& digest)
+        {
+            std::unique_ptr<std::FILE, decltype(&std::fclose)> file{
+#ifdef _WIN32
+                ::_wfopen(source.c_str(), L"rb"),
+#else
+                std::fopen(source.c_str(), "rb"),
+#endif
+                &std::fclose};
+            if (!file)
+                throw std::runtime_error("Could not open file to generate hash: " + source.string());
+
+            auto buffer = std::make_unique<char[]>(readBufferSize);
+            for (std::size_t amount; (amount = std::fread(buffer.get(), 1, readBufferSize, file.get())) > 0;)
+                digest.update(buffer.get(), amount);
+            if (std::ferror(file.get()))
+                throw std::runtime_error("Could not read file to generate hash: " + source.string());
+        }
+
+#ifndef _WIN32
+        /**
+         * @return false if the file could not be mapped and has to be read instead.
+         */
+        inline bool readMapped(std::filesystem::path const& source, MultiDigest& digest)
+        {
+            const int descriptor = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+            if (descriptor < 0)
+                throw std::runtime_error("Could not open file to generate hash: " + source.string());
+
+            struct stat status;
+            if (::fstat(descriptor, &status) != 0 || status.st_size == 0)
+            {
+                ::close(descriptor);
+                return false;
+            }
+
+            const auto size = static_cast<std::size_t>(status.st_size);
+            void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            ::close(descriptor);
+            if (mapping == MAP_FAILED)
+                return false;
+
+            ::madvise(mapping, size, MADV_SEQUENTIAL);
+            try
+            {
+                // Chunked, so every digest sees the data while it is still in the cpu cache.
+                auto const* data = static_cast<char const*>(mapping);
+                for (std::size_t offset = 0; offset < size; offset += digestChunkSize)
+                    digest.update(data + offset, std::min(digestChunkSize, size - offset));
+            }
+            catch (...)
+            {
+                ::munmap(mapping, size);
+                throw;
+            }
+            ::munmap(mapping, size);
+            return true;
+        }
+#endif
+    }
+
+    /**
+     * @brief Computes the requested digests (a combination of Algorithm flags) of the file in one pass.
+     */
+    inline Digests hashFile(std::filesystem::path const& source, unsigned int algorithms)
+    {
+        MultiDigest digest{algorithms};
+#ifndef _WIN32
+        if (!Detail::readMapped(source, digest))
+            Detail::readBuffered(source, digest);
+#else
+        Detail::readBuffered(source, digest);
+#endif
+        return digest.finish();
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <thread>
+
+/**
+ * @brief Follows the log of the game server while it exists and reports every "Can't keep up!" it writes. Only lines
+ * written after the start count. A log that shrinks was rotated and is followed from its beginning.
+ */
+class LagMonitor
+{
+  public:
+    LagMonitor(std::filesystem::path logFile, std::function<void()> onLag);
+    ~LagMonitor();
+    LagMonitor(LagMonitor const&) = delete;
+    LagMonitor& operator=(LagMonitor const&) = delete;
+
+  private:
+    void run();
+
+  private:
+    std::filesystem::path logFile_;
+    std::function<void()> onLag_;
+    std::atomic_bool stop_;
+    std::thread thread_;
+};
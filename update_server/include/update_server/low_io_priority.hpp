@@ -0,0 +1,50 @@
+#pragma once
+
+#ifdef _WIN32
+#    include <windows.h>
+#elif defined(__linux__)
+#    include <sys/syscall.h>
+#    include <unistd.h>
+#endif
+
+/**
+ * @brief Puts the I/O of the current thread into the idle class while it exists, the disk serves it only when nothing
+ * else waits. Threads started meanwhile inherit the class. Has no effect where the platform or the I/O scheduler
+ * (like mq-deadline without ioprio support) has no priorities.
+ */
+class LowIoPriority
+{
+  public:
+    LowIoPriority()
+    {
+#ifdef _WIN32
+        active_ = SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN) != 0;
+#elif defined(__linux__)
+        previous_ = static_cast<int>(::syscall(SYS_ioprio_get, ioprioWhoProcess, 0));
+        active_ = previous_ >= 0 &&
+            ::syscall(SYS_ioprio_set, ioprioWhoProcess, 0, ioprioClassIdle << ioprioClassShift) == 0;
+#endif
+    }
+    ~LowIoPriority()
+    {
+        if (!active_)
+            return;
+#ifdef _WIN32
+        SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+#elif defined(__linux__)
+        ::syscall(SYS_ioprio_set, ioprioWhoProcess, 0, previous_);
+#endif
+    }
+    LowIoPriority(LowIoPriority const&) = delete;
+    LowIoPriority& operator=(LowIoPriority const&) = delete;
+
+  private:
+#ifdef __linux__
+    // From linux/ioprio.h, which glibc does not wrap. With who = process and id 0 the calling thread is meant.
+    constexpr static int ioprioWhoProcess = 1;
+    constexpr static int ioprioClassIdle = 3;
+    constexpr static int ioprioClassShift = 13;
+    int previous_ = 0;
+#endif
+    bool active_ = false;
+};
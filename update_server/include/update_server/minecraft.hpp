@@ -5,19 +5,125 @@
 #endif
 #include <boost/process.hpp>
 
+#include <backend/launch_profile.hpp>
+
+#include <chrono>
+#include <condition_variable>
 #include <csignal>
+#include <filesystem>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
+/**
+ * @brief Runs the game server as a child process. Its console goes through this process: the output is echoed and
+ * handed to an observer, it can be waited for, and commands can be sent from code besides those typed into
+ * forwardIo().
+ */
 class Minecraft
 {
   public:
-    Minecraft();
-    void start(std::string const& serverJar);
+    using LineMatcher = std::function<bool(std::string_view line)>;
+    using OutputHandler = std::function<void(std::string_view line)>;
+
+    struct LaunchOptions
+    {
+        /// Added after those of the profile.
+        std::vector<std::string> jvmArguments;
+        /// For runs that must not slow down a game server beside them.
+        bool lowPriority = false;
+        /// Where the server keeps its world, configuration and logs. The directory of the jar if empty.
+        std::filesystem::path workingDirectory;
+    };
+
+    /**
+     * @param onOutput Called with every line the game server writes to stdout or stderr, from reader threads.
+     * @param echoOutput Whether the output also goes to the console of this process.
+     */
+    explicit Minecraft(OutputHandler onOutput = {}, bool echoOutput = true);
+    ~Minecraft();
+    Minecraft(Minecraft const&) = delete;
+    Minecraft& operator=(Minecraft const&) = delete;
+
+    /**
+     * @brief Starts the jar in its directory, with heap, collector and cores from the profile.
+     */
+    void start(std::string const& serverJar, LaunchProfile const& profile);
+    void start(std::string const& serverJar, LaunchProfile const& profile, LaunchOptions const& options);
     bool stop(int waitTimeoutSeconds = 120);
+
+    /**
+     * @brief Kills the game server right away, without saving. For servers whose world does not matter.
+     */
+    void terminate();
+
+    /**
+     * @brief Waits for the game server to exit on its own, after a "stop" command for example.
+     */
+    bool waitForExit(std::chrono::seconds timeout);
+
+    /**
+     * @brief True from start() until the game server closes its console.
+     */
+    bool running() const;
+
+    /**
+     * @brief The process id of the game server, only valid after start().
+     */
+    int processId() const;
+
+    /**
+     * @brief Forwards what is typed into this process to the game server until "/stop" is entered.
+     */
     void forwardIo();
 
+    /**
+     * @brief Sends a command to the console of the game server. False if it is not running.
+     */
+    bool sendCommand(std::string const& command);
+
+    /**
+     * @brief Sends a command and waits for the first line of output the matcher accepts, from the time of the call
+     * on. Commands sent concurrently each wait for their own line.
+     *
+     * @return The line, std::nullopt on timeout or if the game server is not running.
+     */
+    std::optional<std::string>
+    sendCommand(std::string const& command, LineMatcher matcher, std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Waits for the first line of output the matcher accepts, from the time of the call on.
+     */
+    std::optional<std::string> waitForOutput(LineMatcher matcher, std::chrono::milliseconds timeout);
+
+  private:
+    struct Waiter
+    {
+        LineMatcher matcher;
+        std::optional<std::string> line;
+    };
+
+    void readOutput();
+    void readErrors();
+
   private:
+    OutputHandler onOutput_;
+    bool echoOutput_;
+    std::mutex inputGuard_;
+    mutable std::mutex waitersGuard_;
+    std::condition_variable lineArrived_;
+    std::vector<Waiter*> waiters_;
+    bool outputClosed_;
+    boost::process::opstream input_;
+    boost::process::ipstream output_;
+    boost::process::ipstream errors_;
     std::unique_ptr<boost::process::child> process_;
-    boost::asio::streambuf inputBuffer_;
+    std::thread outputReader_;
+    std::thread errorReader_;
 };
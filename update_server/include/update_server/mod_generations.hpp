@@ -0,0 +1,93 @@
+#pragma once
+
+#include <update_server/mod_index.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Immutable copies of the mods folder, one directory per published generation. Clients download from the
+ * generation they diffed against, so jars swapped in the mods folder meanwhile never mix into an update that is
+ * already running.
+ *
+ * A jar is copied once when it first shows up, later generations hard link it from an earlier one. The copies are
+ * never written again, unlike the jars in the mods folder which can be overwritten in place. A generation is
+ * removed once it is no longer current and no client pinned it within the lease duration.
+ */
+class ModGenerations
+{
+  public:
+    /// Every request of a client renews the lease of its generation, an update pauses far shorter than this.
+    constexpr static std::chrono::minutes leaseDuration{30};
+
+    explicit ModGenerations(std::filesystem::path directory);
+
+    /**
+     * @brief Picks up the generations of the last run, each with a fresh lease for the clients still updating from
+     * it. Unfinished generations are removed.
+     */
+    void load();
+
+    /**
+     * @brief Creates the directory of a generation and makes it the current one. A generation that is already there
+     * with the same mods is reused, one with other mods is never built again. Throws if the generation exists with
+     * other mods, or if a jar cannot be copied or changed while it was copied, the generation is not created then.
+     *
+     * @return The directory of the generation.
+     */
+    std::filesystem::path publish(std::uint64_t generation, std::vector<ModAndHash> const& mods);
+
+    /**
+     * @brief The generation to publish the mods as after a start. The wanted one if it is past every generation
+     * on disk, or is the newest with the same mods. Otherwise one past the newest, so a lost or stale counter never
+     * reuses a number clients may have pinned.
+     */
+    std::uint64_t nextGeneration(std::uint64_t wanted, std::vector<ModAndHash> const& mods) const;
+
+    /**
+     * @brief Renews the lease of a generation and removes those that are neither current nor leased anymore.
+     *
+     * @return False if the generation is gone, its client has to start over from the current one.
+     */
+    bool pin(std::uint64_t generation);
+
+    /**
+     * @brief The mod of a generation by name, the path points into the generation directory.
+     */
+    std::optional<ModAndHash> find(std::uint64_t generation, std::string const& name) const;
+
+    /**
+     * @brief The mod of a generation by its sha256.
+     */
+    std::optional<ModAndHash> findByHash(std::uint64_t generation, std::string const& sha256) const;
+
+    std::size_t retained() const;
+
+  private:
+    struct Generation
+    {
+        std::filesystem::path directory;
+        ModIndex mods;
+        std::chrono::steady_clock::time_point leasedUntil;
+    };
+
+    std::filesystem::path generationDirectory(std::uint64_t generation) const;
+    std::filesystem::path manifestFile(std::uint64_t generation) const;
+
+    /**
+     * @brief Removes the generations that are neither current nor leased.
+     */
+    void collect();
+
+  private:
+    mutable std::mutex guard_;
+    std::filesystem::path directory_;
+    std::map<std::uint64_t, Generation> generations_;
+    std::optional<std::uint64_t> current_;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <update_server/mod_index.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A mod the client can patch from a version it already has instead of downloading it whole.
+ */
+struct ModPatch
+{
+    std::string name;
+    std::string sha256;
+    std::string from;
+    std::string fromSha256;
+};
+
+/**
+ * @brief The name of a mod without its version, "sodium-fabric-0.5.8+mc1.20.6.jar" becomes "sodium-fabric". Used to
+ * pair an old jar of the client with its replacement.
+ */
+std::string modStem(std::string const& fileName);
+
+/**
+ * @brief Keeps the last versions of every mod as hard links in a history folder, so clients that are still on an
+ * old version can be sent a binary patch to the new one instead of the whole jar.
+ *
+ * Patches exist only from the older versions of a mod to its current version. One background thread builds them
+ * after each scan, one at a time, so requests never wait for a patch and at most two jars are held in memory.
+ */
+class ModHistory
+{
+  public:
+    ModHistory(std::filesystem::path directory, std::size_t versionsKept);
+    ~ModHistory();
+    ModHistory(ModHistory const&) = delete;
+    ModHistory& operator=(ModHistory const&) = delete;
+
+    /**
+     * @brief Reads the history index. A missing or unreadable index starts an empty history.
+     */
+    void load();
+
+    /**
+     * @brief Adds the mods that are not in the history yet and drops versions beyond versionsKept per mod, together
+     * with their patches. Queues the patches from the older versions of every mod to its current one.
+     */
+    void record(std::vector<ModAndHash> const& mods);
+
+    /**
+     * @brief For each mod to download, a version the client has that the history patches from. A patch that is
+     * still queued is offered too, the client downloads the whole jar until it exists.
+     */
+    std::vector<ModPatch> patchesFor(
+        std::vector<std::string> const& downloads,
+        std::vector<ModAndHash> const& clientMods,
+        ModIndex const& mods) const;
+
+    /**
+     * @brief The patch between two versions of the same mod. std::nullopt if it is not built yet, is no pair
+     * patchesFor offers, or would not be meaningfully smaller than the jar itself.
+     */
+    std::optional<std::filesystem::path> patch(std::string const& fromSha256, std::string const& toSha256) const;
+
+  private:
+    struct Version
+    {
+        std::string name;
+        std::int64_t recorded;
+    };
+
+    std::filesystem::path versionFile(std::string const& sha256) const;
+    std::filesystem::path patchFile(std::string const& fromSha256, std::string const& toSha256) const;
+    static std::string patchKey(std::string const& fromSha256, std::string const& toSha256);
+    void forget(std::string const& sha256);
+    void save() const;
+
+    /**
+     * @brief Builds the queued patches until the history is destroyed.
+     */
+    void buildPatches();
+
+    /**
+     * @brief Writes the patch file, false if it came out too large or a version is unusable.
+     */
+    bool buildPatch(std::string const& fromSha256, std::string const& toSha256);
+
+  private:
+    mutable std::mutex guard_;
+    std::filesystem::path directory_;
+    std::size_t versionsKept_;
+    /// By sha256.
+    std::unordered_map<std::string, Version> versions_;
+    /// Patches that came out too large, not attempted again.
+    std::unordered_set<std::string> rejectedPatches_;
+    /// By patchKey, the pairs of the last scan. Only these are offered and served.
+    std::unordered_set<std::string> wantedPatches_;
+    /// Wanted patches whose file exists.
+    std::unordered_set<std::string> readyPatches_;
+    /// From and to sha256, every wanted patch is queued once.
+    std::deque<std::pair<std::string, std::string>> queue_;
+    std::condition_variable wake_;
+    bool stop_;
+    std::thread builder_;
+};
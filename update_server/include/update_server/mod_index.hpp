@@ -0,0 +1,66 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct UpdateInstructions
+{
+    std::vector<std::string> download;
+    std::vector<std::string> remove;
+};
+
+struct ModAndHash
+{
+    std::filesystem::path path;
+    std::string sha256;
+};
+
+/**
+ * @brief The mods of the server by file name. Built once whenever the mods folder changes, so requests only do hash
+ * lookups.
+ */
+class ModIndex
+{
+  public:
+    ModIndex() = default;
+    explicit ModIndex(std::vector<ModAndHash> const& mods);
+
+    /**
+     * @brief Compares the mods of a client against this index in one pass over each side.
+     *
+     * @param remoteFiles Mods of the client, path is the file name. An empty hash only checks for presence.
+     * @return download: Mods the client is missing or has in a different version. remove: Mods the client has but
+     * the server does not, or has in a different version.
+     */
+    UpdateInstructions difference(std::vector<ModAndHash> const& remoteFiles) const;
+
+    /**
+     * @brief The sha256 of the mod, nullptr if there is no mod with that name.
+     */
+    std::string const* find(std::string const& name) const;
+
+    /**
+     * @brief The name of the mod with this sha256, nullptr if there is none.
+     */
+    std::string const* nameOf(std::string const& sha256) const;
+
+    std::vector<std::string> const& names() const;
+
+    /**
+     * @brief The mods as name and hash pairs, in name order.
+     */
+    std::vector<ModAndHash> entries() const;
+
+    /**
+     * @brief sha256 over all names and hashes. Equal for equal mod sets.
+     */
+    std::string fingerprint() const;
+
+  private:
+    /// Sorted, so the download list has a stable order.
+    std::vector<std::string> names_;
+    std::unordered_map<std::string, std::string> hashes_;
+    std::unordered_map<std::string, std::string> namesByHash_;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <update_server/mod_history.hpp>
+#include <update_server/mod_index.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief What changed from one manifest generation to the next, so clients one generation behind skip the diff.
+ */
+struct ModChangelog
+{
+    std::string fromEtag;
+    UpdateInstructions instructions;
+    std::vector<ModPatch> patches;
+};
+
+/**
+ * @brief One published state of the mods folder. Immutable once published, handlers share it without locking.
+ */
+struct ModSnapshot
+{
+    ModIndex mods;
+    /// Increases every time the mods or the modrinth index change, also across restarts.
+    std::uint64_t generation = 0;
+    std::string fingerprint;
+    /// sha256 of modrinth.index.json, empty without one.
+    std::string modrinthIndexHash;
+    /// modrinth.index.json and versions.json as they were published, null without them.
+    nlohmann::json modrinthIndex;
+    nlohmann::json versions;
+    /// Strong ETag of this generation, quoted.
+    std::string etag;
+    std::optional<ModChangelog> changelog;
+    /// Copy of the mods of this generation that stays untouched while the mods folder changes.
+    std::filesystem::path directory;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Watches a directory through inotify and reports when files were added, replaced or removed. Several events
+ * in quick succession (like copying a whole mods folder) are reported once. When the directory itself is replaced,
+ * moved or removed, the watch is set up again as soon as the directory exists, followed by a change report.
+ *
+ * Given names, only changes of the files with these names in the directory are reported, for single files in a busy
+ * directory.
+ */
+class ModsWatcher
+{
+  public:
+    ModsWatcher(
+        std::filesystem::path directory,
+        std::function<void()> onChange,
+        std::vector<std::string> names = {});
+    ~ModsWatcher();
+    ModsWatcher(ModsWatcher const&) = delete;
+    ModsWatcher& operator=(ModsWatcher const&) = delete;
+
+    /**
+     * @brief False if the platform has no inotify, the watch could not be set up or the directory is gone. Callers
+     * have to rescan themselves then.
+     */
+    bool watching() const;
+
+    /**
+     * @brief Watches the directory again after it was replaced, without waiting for the event of the old watch.
+     */
+    void rewatch();
+
+  private:
+    void run();
+
+  private:
+    std::filesystem::path directory_;
+    std::function<void()> onChange_;
+    std::vector<std::string> names_;
+    int inotifyFd_;
+    /// Only changed by the watcher thread, -1 while the directory is gone.
+    std::atomic_int watchDescriptor_;
+    std::atomic_bool rewatchRequested_;
+    std::atomic_bool stop_;
+    std::thread thread_;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <backend/parallel_for.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Hashes many files on a pool of threads. Shared by the update server and the update client to scan mods
+ * folders.
+ */
+class ParallelHasher
+{
+  public:
+    /**
+     * @brief Hashing jars is mostly bound by the cpu once the files are in the page cache, cold reads from disk
+     * profit from a few requests in flight. One thread per core covers both without oversubscribing small machines.
+     */
+    static unsigned int defaultThreadCount()
+    {
+        return std::clamp(std::thread::hardware_concurrency(), 1u, maxThreadCount);
+    }
+
+    explicit ParallelHasher(unsigned int threadCount = defaultThreadCount())
+        : threadCount_{std::max(1u, threadCount)}
+    {}
+
+    /**
+     * @brief Calls hash(file) for every file. The results are in the same order as the files, regardless of which
+     * thread finished first. The first exception thrown by hash is rethrown after all threads stopped.
+     */
+    template <typename HashFunctionT>
+    auto hash(std::vector<std::filesystem::path> const& files, HashFunctionT&& hash) const
+        -> std::vector<std::invoke_result_t<HashFunctionT&, std::filesystem::path const&>>
+    {
+        std::vector<std::invoke_result_t<HashFunctionT&, std::filesystem::path const&>> results(files.size());
+
+        std::atomic_bool failed{false};
+        std::exception_ptr firstError;
+        std::mutex errorGuard;
+        parallelFor(files.size(), threadCount_, [&](std::size_t index) {
+            if (failed)
+                return;
+            try
+            {
+                results[index] = hash(files[index]);
+            }
+            catch (...)
+            {
+                std::scoped_lock lock{errorGuard};
+                if (!firstError)
+                    firstError = std::current_exception();
+                failed = true;
+            }
+        });
+
+        if (firstError)
+            std::rethrow_exception(firstError);
+        return results;
+    }
+
+    unsigned int threadCount() const
+    {
+        return threadCount_;
+    }
+
+  private:
+    constexpr static unsigned int maxThreadCount = 32;
+    unsigned int threadCount_;
+};
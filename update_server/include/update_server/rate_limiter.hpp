@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+/**
+ * @brief Token bucket shared by the threads of a backup, so together they stay below a number of bytes per second.
+ * Reads and writes both draw from it.
+ *
+ * The rate adapts to the game server: every lag it reports halves the rate, and after a while without lag the rate
+ * climbs back towards the cap.
+ */
+class RateLimiter
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    /// The rate never drops below this, backups have to finish eventually.
+    constexpr static double minimumRate = 4.0 * 1024 * 1024;
+    /// Lag reported within this time of the last slow down counts as the same lag.
+    constexpr static std::chrono::seconds slowDownInterval{5};
+    /// Time without lag after which the rate is raised again.
+    constexpr static std::chrono::seconds recoveryInterval{30};
+
+    /**
+     * @param bytesPerSecond The cap, 0 for none. Lag slows down uncapped backups all the same.
+     */
+    explicit RateLimiter(std::uint64_t bytesPerSecond);
+
+    /**
+     * @brief Blocks until the bytes may be read or written.
+     */
+    void acquire(std::uint64_t bytes);
+
+    /**
+     * @brief The game server fell behind, halves the rate.
+     */
+    void slowDown();
+
+    /**
+     * @brief Bytes per second currently allowed, 0 if there is no limit.
+     */
+    std::uint64_t currentRate() const;
+
+  private:
+    void refill(Clock::time_point now);
+
+  private:
+    mutable std::mutex guard_;
+    double cap_;
+    double rate_;
+    double tokens_;
+    Clock::time_point lastRefill_;
+    Clock::time_point lastChange_;
+    /// What went through since the first acquire, the starting point when an uncapped backup has to slow down.
+    std::uint64_t transferred_;
+    Clock::time_point firstAcquire_;
+    double uncappedAt_;
+};
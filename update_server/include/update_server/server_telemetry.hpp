@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A "Can't keep up!" of the game server, with the mods generation that was current.
+ */
+struct LagWarning
+{
+    std::int64_t time;
+    std::uint64_t millisecondsBehind;
+    std::uint64_t ticksBehind;
+    std::uint64_t generation;
+};
+
+/**
+ * @brief CPU and memory of the game server process at one point in time.
+ */
+struct ProcessSample
+{
+    std::int64_t time;
+    /// Of one core, a server busy on several cores exceeds 100.
+    double cpuPercent;
+    std::uint64_t residentBytes;
+};
+
+/**
+ * @brief Lag while a mods generation was current, for comparing before and after an update.
+ */
+struct GenerationLag
+{
+    std::uint64_t generation;
+    std::int64_t since;
+    std::uint64_t lagWarnings = 0;
+    std::uint64_t ticksBehind = 0;
+};
+
+struct ServerMetrics
+{
+    std::optional<double> startupSeconds;
+    /// Whether the game server was started with a class data sharing archive, compare startupSeconds across starts.
+    bool classDataSharing = false;
+    std::uint64_t lagWarnings = 0;
+    std::uint64_t ticksBehind = 0;
+    std::uint64_t saves = 0;
+    std::optional<double> lastSaveSeconds;
+    double longestSaveSeconds = 0;
+    std::vector<LagWarning> recentLag;
+    std::vector<ProcessSample> samples;
+    std::vector<GenerationLag> generations;
+};
+
+/**
+ * @brief Watches the game server: keeps its recent output, parses it for lag warnings, save times and the startup
+ * duration, and samples CPU and memory of its process from /proc. Times are milliseconds since the epoch.
+ */
+class ServerTelemetry
+{
+  public:
+    constexpr static std::size_t outputLinesKept = 2000;
+    constexpr static std::size_t lagWarningsKept = 500;
+    constexpr static std::size_t generationsKept = 20;
+    /// An hour of samples.
+    constexpr static std::size_t samplesKept = 360;
+    constexpr static std::chrono::seconds sampleInterval{10};
+
+    ServerTelemetry();
+    ~ServerTelemetry();
+    ServerTelemetry(ServerTelemetry const&) = delete;
+    ServerTelemetry& operator=(ServerTelemetry const&) = delete;
+
+    /**
+     * @brief A line the game server wrote to stdout or stderr.
+     */
+    void onOutput(std::string_view line);
+
+    /**
+     * @brief The game server was started, with or without a class data sharing archive.
+     */
+    void serverStarted(bool classDataSharing);
+
+    /**
+     * @brief Samples the process every sampleInterval until it exits. Only supported on Linux.
+     */
+    void watchProcess(int processId);
+
+    /**
+     * @brief Calls onLag under the lock of the telemetry for every lag warning from now on, replacing the previous
+     * listener. An empty function removes it.
+     */
+    void setLagListener(std::function<void()> onLag);
+
+    /**
+     * @brief Lag from now on is attributed to this mods generation.
+     */
+    void modsPublished(std::uint64_t generation);
+
+    ServerMetrics metrics() const;
+
+    /**
+     * @brief The last lines of output, oldest first.
+     */
+    std::vector<std::string> recentOutput() const;
+
+  private:
+    void sampleProcess(int processId);
+
+  private:
+    mutable std::mutex guard_;
+    std::deque<std::string> output_;
+    std::chrono::steady_clock::time_point saveStarted_;
+    bool saving_;
+    ServerMetrics metrics_;
+    std::deque<LagWarning> recentLag_;
+    std::deque<ProcessSample> samples_;
+    std::map<std::uint64_t, GenerationLag> generations_;
+    std::uint64_t generation_;
+    std::function<void()> onLag_;
+    std::condition_variable stopRequested_;
+    bool stop_;
+    std::thread sampler_;
+};
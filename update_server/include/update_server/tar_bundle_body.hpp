@@ -0,0 +1,171 @@
+#pragma once
+
+#include <update_server/tar_stream.hpp>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/core/file.hpp>
+#include <boost/beast/http/error.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/optional.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A beast body that sends files as one tar stream. Headers are generated and files are read while the
+ * response is written, so memory use does not depend on the number or size of the files.
+ */
+struct TarBundleBody
+{
+    class value_type
+    {
+      public:
+        /**
+         * @brief Adds a file under its file name. The size is taken now, so Content-Length is known up front.
+         */
+        void add(std::filesystem::path const& path)
+        {
+            const auto name = path.filename().string();
+            const auto size = std::filesystem::file_size(path);
+            members_.push_back({.path = path, .name = name, .size = size});
+            streamSize_ += Tar::memberSize(name, size);
+        }
+
+        std::vector<std::string> names() const
+        {
+            std::vector<std::string> result;
+            result.reserve(members_.size());
+            for (auto const& member : members_)
+                result.push_back(member.name);
+            return result;
+        }
+
+      private:
+        friend struct TarBundleBody;
+
+        struct Member
+        {
+            std::filesystem::path path;
+            std::string name;
+            std::uint64_t size;
+        };
+
+        std::vector<Member> members_{};
+        std::uint64_t streamSize_ = Tar::trailerSize;
+    };
+
+    static std::uint64_t size(value_type const& body)
+    {
+        return body.streamSize_;
+    }
+
+    class writer
+    {
+      public:
+        using const_buffers_type = boost::asio::const_buffer;
+
+        template <bool isRequest, class Fields>
+        writer(boost::beast::http::header<isRequest, Fields>&, value_type& body)
+            : body_{body}
+            , next_{0}
+            , pending_{}
+            , pendingOffset_{0}
+            , file_{}
+            , remaining_{0}
+            , trailerQueued_{false}
+        {}
+
+        void init(boost::beast::error_code& ec)
+        {
+            ec = {};
+        }
+
+        boost::optional<std::pair<const_buffers_type, bool>> get(boost::beast::error_code& ec)
+        {
+            ec = {};
+            std::size_t filled = 0;
+            while (filled != sizeof(buffer_))
+            {
+                if (pendingOffset_ != pending_.size())
+                {
+                    const auto amount = std::min(pending_.size() - pendingOffset_, sizeof(buffer_) - filled);
+                    std::copy_n(pending_.data() + pendingOffset_, amount, buffer_ + filled);
+                    pendingOffset_ += amount;
+                    filled += amount;
+                }
+                else if (remaining_ != 0)
+                {
+                    const auto amount = std::min<std::uint64_t>(remaining_, sizeof(buffer_) - filled);
+                    const auto read = file_.read(buffer_ + filled, static_cast<std::size_t>(amount), ec);
+                    if (ec)
+                        return boost::none;
+                    if (read == 0)
+                    {
+                        // The file shrunk after the Content-Length was sent.
+                        ec = boost::beast::http::error::short_read;
+                        return boost::none;
+                    }
+                    remaining_ -= read;
+                    filled += read;
+                    if (remaining_ == 0)
+                    {
+                        file_.close(ec);
+                        queue(std::string(Tar::padding(body_.members_[next_ - 1].size), '\0'));
+                    }
+                }
+                else if (!nextMember(ec))
+                {
+                    if (ec)
+                        return boost::none;
+                    break;
+                }
+            }
+            if (filled == 0)
+                return boost::none;
+            return {{const_buffers_type{buffer_, filled}, true}};
+        }
+
+      private:
+        void queue(std::string data)
+        {
+            pending_ = std::move(data);
+            pendingOffset_ = 0;
+        }
+
+        /**
+         * @brief Queues the header of the next file and opens it, or the trailer after the last one.
+         */
+        bool nextMember(boost::beast::error_code& ec)
+        {
+            if (next_ == body_.members_.size())
+            {
+                if (trailerQueued_)
+                    return false;
+                trailerQueued_ = true;
+                queue(std::string(Tar::trailerSize, '\0'));
+                return true;
+            }
+
+            auto const& member = body_.members_[next_++];
+            queue(Tar::fileHeader(member.name, member.size));
+            remaining_ = member.size;
+            if (remaining_ == 0)
+                return true;
+            file_.open(member.path.string().c_str(), boost::beast::file_mode::scan, ec);
+            return !ec;
+        }
+
+      private:
+        value_type& body_;
+        std::size_t next_;
+        std::string pending_;
+        std::size_t pendingOffset_;
+        boost::beast::file file_;
+        std::uint64_t remaining_;
+        bool trailerQueued_;
+        char buffer_[64 * 1024];
+    };
+};
@@ -0,0 +1,321 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Just enough of the ustar format to stream a flat list of files between update server and client without
+ * pulling libarchive into either. Long names are carried in pax headers, which every tar reads.
+ */
+namespace Tar
+{
+    constexpr std::size_t blockSize = 512;
+
+    namespace Detail
+    {
+        inline void writeOctal(char* field, std::size_t width, std::uint64_t value)
+        {
+            // width - 1 digits and a terminating NUL.
+            std::memset(field, '0', width - 1);
+            field[width - 1] = '\0';
+            for (auto i = width - 1; i != 0 && value != 0; --i, value >>= 3)
+                field[i - 1] = static_cast<char>('0' + (value & 7));
+        }
+
+        inline std::uint64_t readOctal(char const* field, std::size_t width)
+        {
+            std::uint64_t value = 0;
+            for (std::size_t i = 0; i != width && field[i] >= '0' && field[i] <= '7'; ++i)
+                value = (value << 3) | static_cast<std::uint64_t>(field[i] - '0');
+            return value;
+        }
+
+        inline unsigned int checksum(char const* block)
+        {
+            unsigned int sum = 0;
+            for (std::size_t i = 0; i != blockSize; ++i)
+            {
+                // The checksum field itself counts as spaces.
+                sum += (i >= 148 && i < 156) ? ' ' : static_cast<unsigned char>(block[i]);
+            }
+            return sum;
+        }
+
+        inline std::string headerBlock(std::string_view name, std::uint64_t size, char type, std::uint64_t modified)
+        {
+            std::string block(blockSize, '\0');
+            std::memcpy(block.data(), name.data(), std::min<std::size_t>(name.size(), 100));
+            writeOctal(&block[100], 8, 0644);
+            writeOctal(&block[108], 8, 0);
+            writeOctal(&block[116], 8, 0);
+            writeOctal(&block[124], 12, size);
+            writeOctal(&block[136], 12, modified);
+            block[156] = type;
+            std::memcpy(&block[257], "ustar", 6);
+            std::memcpy(&block[263], "00", 2);
+
+            const auto sum = checksum(block.data());
+            writeOctal(&block[148], 7, sum);
+            block[155] = ' ';
+            return block;
+        }
+
+        inline std::string paxRecord(std::string_view key, std::string_view value)
+        {
+            // The length prefix counts its own digits.
+            const auto payload = 3 + key.size() + value.size();
+            auto length = payload + std::to_string(payload).size();
+            while (payload + std::to_string(length).size() != length)
+                length = payload + std::to_string(length).size();
+            return std::to_string(length) + " " + std::string{key} + "=" + std::string{value} + "\n";
+        }
+    }
+
+    inline std::uint64_t padding(std::uint64_t size)
+    {
+        return (blockSize - size % blockSize) % blockSize;
+    }
+
+    /**
+     * @brief The header blocks that precede a regular file of this name and size.
+     *
+     * @param modified Seconds since the epoch. The mods bundle leaves it at 0, its extractor ignores it.
+     */
+    inline std::string fileHeader(std::string const& name, std::uint64_t size, std::uint64_t modified = 0)
+    {
+        if (name.size() <= 100)
+            return Detail::headerBlock(name, size, '0', modified);
+
+        const auto record = Detail::paxRecord("path", name);
+        return Detail::headerBlock("PaxHeader", record.size(), 'x', modified) + record +
+            std::string(padding(record.size()), '\0') + Detail::headerBlock(name.substr(0, 100), size, '0', modified);
+    }
+
+    /**
+     * @brief Bytes a file occupies in the stream, headers and padding included.
+     */
+    inline std::uint64_t memberSize(std::string const& name, std::uint64_t size)
+    {
+        return fileHeader(name, 0).size() + size + padding(size);
+    }
+
+    constexpr std::size_t trailerSize = 2 * blockSize;
+
+    /**
+     * @brief Extracts a tar stream of regular files into one directory while it arrives, in constant memory. Entries
+     * with directories in their name are rejected, the stream is meant for a flat mods folder. A leading "./", as
+     * written by "tar -C mods -cf - .", is dropped.
+     */
+    class StreamExtractor
+    {
+      public:
+        /**
+         * @param onFile Called with the name of every file once it is complete.
+         * @param onData Called with the content of the current file as it is written.
+         */
+        StreamExtractor(
+            std::filesystem::path directory,
+            std::function<void(std::string const&)> onFile = {},
+            std::function<void(char const*, std::size_t)> onData = {})
+            : directory_{std::move(directory)}
+            , onFile_{std::move(onFile)}
+            , onData_{std::move(onData)}
+            , block_{}
+            , blockFill_{0}
+            , remaining_{0}
+            , skip_{0}
+            , state_{State::Header}
+            , name_{}
+            , longName_{}
+            , paxData_{}
+            , gnuLongName_{false}
+            , writer_{}
+        {}
+
+        /**
+         * @brief Consumes the next piece of the stream. Throws std::runtime_error if the stream is malformed or a
+         * file cannot be written.
+         */
+        void feed(char const* data, std::size_t size)
+        {
+            while (size != 0 && state_ != State::Finished)
+            {
+                if (state_ == State::FileData)
+                {
+                    const auto amount = static_cast<std::size_t>(std::min<std::uint64_t>(remaining_, size));
+                    writer_.write(data, static_cast<std::streamsize>(amount));
+                    if (!writer_.good())
+                        throw std::runtime_error("Could not write " + name_);
+                    if (onData_)
+                        onData_(data, amount);
+                    advance(data, size, amount);
+                    remaining_ -= amount;
+                    if (remaining_ == 0)
+                        finishFile();
+                    continue;
+                }
+                if (state_ == State::Skip)
+                {
+                    const auto amount = static_cast<std::size_t>(std::min<std::uint64_t>(skip_, size));
+                    advance(data, size, amount);
+                    skip_ -= amount;
+                    if (skip_ == 0)
+                        state_ = State::Header;
+                    continue;
+                }
+
+                // Header and pax records are collected block wise.
+                const auto amount = std::min(blockSize - blockFill_, size);
+                std::memcpy(block_.data() + blockFill_, data, amount);
+                blockFill_ += amount;
+                advance(data, size, amount);
+                if (blockFill_ == blockSize)
+                {
+                    blockFill_ = 0;
+                    if (state_ == State::Header)
+                        onHeader();
+                    else
+                        onPaxBlock();
+                }
+            }
+        }
+
+        /**
+         * @brief True once the closing zero block was read.
+         */
+        bool finished() const
+        {
+            return state_ == State::Finished;
+        }
+
+      private:
+        enum class State
+        {
+            Header,
+            Pax,
+            FileData,
+            Skip,
+            Finished
+        };
+
+        static void advance(char const*& data, std::size_t& size, std::size_t amount)
+        {
+            data += amount;
+            size -= amount;
+        }
+
+        void onHeader()
+        {
+            if (std::all_of(block_.begin(), block_.end(), [](char c) {
+                    return c == '\0';
+                }))
+            {
+                state_ = State::Finished;
+                return;
+            }
+            if (Detail::readOctal(&block_[148], 8) != Detail::checksum(block_.data()))
+                throw std::runtime_error("Tar header checksum mismatch");
+
+            const auto size = Detail::readOctal(&block_[124], 12);
+            const auto type = block_[156];
+            if (type == 'x' || type == 'L')
+            {
+                // The records are read block wise, which consumes their padding too. GNU tar puts long names in
+                // an 'L' entry of its own instead of a pax record.
+                state_ = size == 0 ? State::Header : State::Pax;
+                remaining_ = size;
+                paxData_.clear();
+                gnuLongName_ = type == 'L';
+                return;
+            }
+
+            std::string name = longName_;
+            if (name.empty())
+                name.assign(block_.data(), std::find(block_.data(), block_.data() + 100, '\0'));
+            longName_.clear();
+            if (name.starts_with("./"))
+                name.erase(0, 2);
+            if (type != '0' && type != '\0')
+            {
+                skip_ = size + padding(size);
+                state_ = skip_ == 0 ? State::Header : State::Skip;
+                return;
+            }
+            if (name.empty() || name.find_first_of("/\\") != std::string::npos || name == "." || name == "..")
+                throw std::runtime_error("Unexpected tar entry: " + name);
+
+            name_ = std::move(name);
+            writer_ = std::ofstream{directory_ / name_, std::ios_base::binary};
+            if (!writer_.good())
+                throw std::runtime_error("Could not create " + name_);
+            remaining_ = size;
+            skip_ = padding(size);
+            state_ = State::FileData;
+            if (remaining_ == 0)
+                finishFile();
+        }
+
+        void onPaxBlock()
+        {
+            const auto amount = static_cast<std::size_t>(std::min<std::uint64_t>(remaining_, blockSize));
+            paxData_.append(block_.data(), amount);
+            remaining_ -= amount;
+            if (remaining_ != 0)
+                return;
+
+            if (gnuLongName_)
+            {
+                longName_ = paxData_.substr(0, paxData_.find('\0'));
+                state_ = State::Header;
+                return;
+            }
+
+            // Records are "<length> <key>=<value>\n", only the path is of interest.
+            for (std::size_t offset = 0; offset < paxData_.size();)
+            {
+                const auto space = paxData_.find(' ', offset);
+                if (space == std::string::npos)
+                    throw std::runtime_error("Malformed pax header");
+                const auto length = std::stoull(paxData_.substr(offset, space - offset));
+                if (length <= space - offset + 1 || offset + length > paxData_.size())
+                    throw std::runtime_error("Malformed pax header");
+                const auto record = std::string_view{paxData_}.substr(space + 1, offset + length - space - 2);
+                if (record.starts_with("path="))
+                    longName_ = std::string{record.substr(5)};
+                offset += length;
+            }
+            state_ = State::Header;
+        }
+
+        void finishFile()
+        {
+            writer_.close();
+            if (onFile_)
+                onFile_(name_);
+            state_ = skip_ == 0 ? State::Header : State::Skip;
+        }
+
+      private:
+        std::filesystem::path directory_;
+        std::function<void(std::string const&)> onFile_;
+        std::function<void(char const*, std::size_t)> onData_;
+        std::array<char, blockSize> block_;
+        std::size_t blockFill_;
+        std::uint64_t remaining_;
+        std::uint64_t skip_;
+        State state_;
+        std::string name_;
+        std::string longName_;
+        std::string paxData_;
+        bool gnuLongName_;
+        std::ofstream writer_;
+    };
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <update_server/hashing.hpp>
+#include <update_server/mod_index.hpp>
+#include <update_server/tar_stream.hpp>
+
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/optional.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A beast body that extracts an uploaded tar into a directory while it is received. Every file is hashed on
+ * the way in, so the upload is neither buffered nor read a second time.
+ */
+struct TarUploadBody
+{
+    class value_type
+    {
+      public:
+        value_type() = default;
+        explicit value_type(std::filesystem::path directory)
+            : directory_{std::move(directory)}
+        {}
+
+        /**
+         * @brief The extracted files with their sha256, in the order of the stream.
+         */
+        std::vector<ModAndHash> const& files() const
+        {
+            return files_;
+        }
+
+        /**
+         * @brief Why the extraction stopped. The rest of the body was read and discarded.
+         */
+        std::optional<std::string> const& error() const
+        {
+            return error_;
+        }
+
+      private:
+        friend struct TarUploadBody;
+
+        std::filesystem::path directory_{};
+        std::vector<ModAndHash> files_{};
+        std::optional<std::string> error_{};
+    };
+
+    class reader
+    {
+      public:
+        template <bool isRequest, class Fields>
+        reader(boost::beast::http::header<isRequest, Fields>&, value_type& body)
+            : body_{body}
+            , extractor_{}
+            , digest_{}
+        {}
+
+        void init(boost::optional<std::uint64_t> const&, boost::beast::error_code& ec)
+        {
+            ec = {};
+            if (body_.directory_.empty())
+            {
+                body_.error_ = "No directory to extract to";
+                return;
+            }
+            extractor_.emplace(
+                body_.directory_,
+                [this](std::string const& name) {
+                    if (!digest_)
+                        digest_.emplace(Hashing::Sha256);
+                    body_.files_.push_back({.path = body_.directory_ / name, .sha256 = digest_->finish().sha256});
+                    digest_.reset();
+                },
+                [this](char const* data, std::size_t size) {
+                    if (!digest_)
+                        digest_.emplace(Hashing::Sha256);
+                    digest_->update(data, size);
+                });
+        }
+
+        template <class ConstBufferSequence>
+        std::size_t put(ConstBufferSequence const& buffers, boost::beast::error_code& ec)
+        {
+            ec = {};
+            const auto size = boost::asio::buffer_size(buffers);
+            if (body_.error_ || !extractor_)
+                return size;
+            try
+            {
+                for (auto it = boost::asio::buffer_sequence_begin(buffers);
+                     it != boost::asio::buffer_sequence_end(buffers);
+                     ++it)
+                {
+                    const boost::asio::const_buffer buffer = *it;
+                    extractor_->feed(static_cast<char const*>(buffer.data()), buffer.size());
+                }
+            }
+            catch (std::exception const& exc)
+            {
+                body_.error_ = exc.what();
+            }
+            return size;
+        }
+
+        void finish(boost::beast::error_code& ec)
+        {
+            ec = {};
+            if (!body_.error_ && extractor_ && !extractor_->finished())
+                body_.error_ = "The upload ended before the end of the archive";
+        }
+
+      private:
+        value_type& body_;
+        std::optional<Tar::StreamExtractor> extractor_;
+        std::optional<Hashing::MultiDigest> digest_;
+    };
+};
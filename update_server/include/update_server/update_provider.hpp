@@ -1,47 +1,199 @@
 #pragma once
 
 #include <roar/routing/request_listener.hpp>
+#include <update_server/class_data_sharing.hpp>
+#include <update_server/diff_cache.hpp>
+#include <update_server/hash_cache.hpp>
 #include <update_server/minecraft.hpp>
+#include <update_server/mod_generations.hpp>
+#include <update_server/mod_history.hpp>
+#include <update_server/mod_index.hpp>
+#include <update_server/mod_snapshot.hpp>
+#include <update_server/mods_watcher.hpp>
+#include <update_server/server_telemetry.hpp>
+#include <update_server/world_archive.hpp>
+#include <update_server/world_backup.hpp>
+#include <update_server/world_jobs.hpp>
 
 #include <boost/describe/class.hpp>
 
+#include <atomic>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <vector>
 
-struct UpdateInstructions
-{
-    std::vector<std::string> download;
-    std::vector<std::string> remove;
-};
-
-struct ModAndHash
-{
-    std::filesystem::path path;
-    std::string sha256;
-};
-
 class UpdateProvider
 {
   public:
-    UpdateProvider(std::filesystem::path const& serverDirectory);
+    /**
+     * @param adminToken Enables /upload_mods, the world backups and the console for requests that carry it as bearer
+     * token. It is sent in plain text, so outside a trusted network the server belongs behind a TLS proxy.
+     * @param backupBytesPerSecond Disk I/O cap for backups, 0 for none. Backups slow down on lag either way.
+     * @param launchProfile Runs server.jar with it if set, which lets backups pause saving for a consistent snapshot.
+     */
+    UpdateProvider(
+        std::filesystem::path const& serverDirectory,
+        std::optional<std::string> adminToken,
+        std::uint64_t backupBytesPerSecond,
+        std::optional<LaunchProfile> const& launchProfile);
 
   public:
-    UpdateInstructions buildDifference(std::vector<ModAndHash> const& remoteFiles);
-    std::filesystem::path getModPath(std::string const& name);
+    UpdateInstructions buildDifference(ModIndex const& localMods, std::vector<ModAndHash> const& remoteFiles);
     std::filesystem::path getFilePath(std::string const& name);
-    bool installMods(std::string const& tarFile);
-    void backupWorld();
+
+    /**
+     * @brief Swaps the uploaded mods in for the mods folder and publishes them. The previous mods are kept in
+     * mods_backup until the next upload.
+     *
+     * @param staged The uploaded files with the hashes taken while they were received.
+     */
+    bool installMods(std::vector<ModAndHash> const& staged);
+
+    /**
+     * @brief Forwards the console to the game server until "/stop" is entered.
+     */
+    void forwardConsole();
+
+    /**
+     * @brief Snapshots the world, unchanged files are hard linked to the previous snapshot.
+     */
+    WorldSnapshot backupWorld();
+
+    /**
+     * @brief Replaces the world of a server that is not running with one of its backups.
+     */
+    static void restoreWorld(std::filesystem::path const& serverDirectory, std::string const& snapshot);
+
+    /**
+     * @brief Archives the world into a compressed tar for keeping elsewhere, or finishes an interrupted archive.
+     *
+     * @param pause Pauses saving for the second pass, see savePause(). Empty when no game server of this process runs.
+     * @param telemetry Of a game server this process runs, backups slow down on its lag. The log is followed without.
+     */
+    static WorldArchiveResult archiveWorld(
+        std::filesystem::path const& serverDirectory,
+        std::uint64_t backupBytesPerSecond,
+        WorldBackup::Pause const& pause = {},
+        ServerTelemetry* telemetry = nullptr);
 
   private:
+    /**
+     * @brief Rescans the mods folder. Only files that changed since they were last hashed are hashed again.
+     */
     void loadLocalMods();
 
+    /**
+     * @brief The mods as of the last scan. Handlers keep using the snapshot they loaded, even if a rescan publishes
+     * a new one meanwhile.
+     */
+    std::shared_ptr<ModSnapshot const> snapshot() const;
+
+    /**
+     * @brief Publishes the scanned mods as a new generation if they differ from the current snapshot. The mods are
+     * copied into a generation directory first, the snapshot only switches once that is complete.
+     */
+    void publish(std::vector<ModAndHash> const& mods);
+
+    /**
+     * @brief Rescans before answering from the snapshot when a watcher is not running, it would miss changes.
+     * Answers 500 and returns false if the rescan failed.
+     */
+    bool rescanIfUnwatched(Roar::Session& session, Roar::EmptyBodyRequest const& request);
+
+    /**
+     * @brief The generation a client pinned with the X-Mod-Generation header, the current one if it sent none.
+     * Answers 410 Gone and returns std::nullopt if the pinned generation was removed, the client has to sync again.
+     */
+    std::optional<std::uint64_t> requestedGeneration(Roar::Session& session, Roar::EmptyBodyRequest const& request);
+
+    /**
+     * @brief Sends a mod of a generation with its sha256 as ETag. Honors If-None-Match and single byte ranges, so
+     * interrupted downloads can be resumed.
+     *
+     * @param mod The file in the generation directory, std::nullopt answers 404.
+     */
+    void serveMod(
+        Roar::Session& session,
+        Roar::EmptyBodyRequest const& request,
+        std::optional<ModAndHash> const& mod,
+        bool headersOnly,
+        bool immutable);
+
+    enum class SyncState
+    {
+        UpToDate,
+        /// The changes since the generation the client named.
+        Changelog,
+        /// The difference to the mods the client sent.
+        Changes,
+        NeedMods
+    };
+
+    /**
+     * @brief Everything a client needs to update in one answer: versions, modrinth index, and the mods to download
+     * with size, hash and blob url. Throws if a mod to download cannot be found in the generation directory.
+     */
+    std::string syncResponse(
+        ModSnapshot const& current,
+        SyncState state,
+        UpdateInstructions const& instructions,
+        std::vector<ModPatch> const& patches);
+
+    /**
+     * @brief Turns saving off and flushes the world for the paused pass of a snapshot. Empty if the game server was
+     * not started by this process.
+     */
+    WorldBackup::Pause savePause();
+
+    /**
+     * @brief The telemetry while the game server of this process runs, null otherwise.
+     */
+    ServerTelemetry* runningTelemetry();
+
+    /**
+     * @brief Checks the bearer token of requests that change the server or read its console, and answers those
+     * without a valid one.
+     */
+    bool authorize(Roar::Session& session, Roar::EmptyBodyRequest const& request);
+
+    /**
+     * @brief Starts a backup or archive job and answers 202 with the id and status route of the job, or 409 while
+     * another job runs.
+     */
+    void startWorldJob(
+        Roar::Session& session,
+        Roar::EmptyBodyRequest const& request,
+        std::string kind,
+        std::function<nlohmann::json()> job);
+
   private:
-    std::recursive_mutex guard_;
+    // Only serializes writers, readers never take a lock.
+    std::mutex scanGuard_;
+    std::mutex backupGuard_;
     std::filesystem::path serverDirectory_;
-    std::vector<ModAndHash> localMods_;
+    std::atomic<std::shared_ptr<ModSnapshot const>> snapshot_;
+    HashCache hashCache_;
+    ModHistory modHistory_;
+    ModGenerations modGenerations_;
+    DiffCache diffCache_;
+    std::unique_ptr<ModsWatcher> modsWatcher_;
+    /// modrinth.index.json and versions.json in the server directory, they are part of every generation.
+    std::unique_ptr<ModsWatcher> publishedFilesWatcher_;
+    std::optional<std::string> adminToken_;
+    std::atomic_bool uploading_;
+    std::uint64_t backupBytesPerSecond_;
+    WorldBackup worldBackup_;
+    ServerTelemetry serverTelemetry_;
     Minecraft minecraft_;
+    /// Only for a game server started by this process.
+    std::unique_ptr<ClassDataSharing> classDataSharing_;
+    /// Last, so a running job is waited for before the members it uses are destroyed.
+    WorldJobs worldJobs_;
 
   private:
     ROAR_MAKE_LISTENER(UpdateProvider);
@@ -53,8 +205,36 @@ class UpdateProvider
         .path = "\\/download_mod\\/(.+)",
         .pathType = Roar::RoutePathType::Regex,
     });
+    ROAR_HEAD(downloadModHead)
+    ({
+        .path = "\\/download_mod\\/(.+)",
+        .pathType = Roar::RoutePathType::Regex,
+    });
+    ROAR_POST(downloadBundle)("/download_bundle");
+    ROAR_GET(downloadPatch)
+    ({
+        .path = "\\/patch\\/([0-9a-f]{64})\\/([0-9a-f]{64})",
+        .pathType = Roar::RoutePathType::Regex,
+    });
     ROAR_POST(uploadMods)("/upload_mods");
+    ROAR_POST(createWorldBackup)("/backup_world");
+    ROAR_POST(createWorldArchive)("/archive_world");
+    ROAR_GET(worldJob)
+    ({
+        .path = "\\/world_job\\/([0-9]+)",
+        .pathType = Roar::RoutePathType::Regex,
+    });
     ROAR_GET(versions)("/versions");
+    ROAR_GET(modrinthIndex)("/modrinth_index");
+    ROAR_GET(manifest)("/manifest");
+    ROAR_POST(sync)("/sync");
+    ROAR_GET(blob)
+    ({
+        .path = "\\/blob\\/([0-9a-f]{64})",
+        .pathType = Roar::RoutePathType::Regex,
+    });
+    ROAR_GET(metrics)("/metrics");
+    ROAR_GET(consoleOutput)("/console_output");
 
   private:
     BOOST_DESCRIBE_CLASS(
@@ -62,5 +242,21 @@ class UpdateProvider
         (),
         (),
         (),
-        (roar_index, roar_makeFileDifference, roar_downloadMod, roar_uploadMods, roar_versions));
+        (roar_index,
+         roar_makeFileDifference,
+         roar_downloadMod,
+         roar_downloadModHead,
+         roar_downloadBundle,
+         roar_downloadPatch,
+         roar_uploadMods,
+         roar_createWorldBackup,
+         roar_createWorldArchive,
+         roar_worldJob,
+         roar_versions,
+         roar_modrinthIndex,
+         roar_manifest,
+         roar_sync,
+         roar_blob,
+         roar_metrics,
+         roar_consoleOutput));
 };
\ No newline at end of file
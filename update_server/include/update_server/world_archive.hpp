@@ -0,0 +1,110 @@
+#pragma once
+
+#include <update_server/rate_limiter.hpp>
+#include <update_server/world_backup.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief The outcome of one archive run, the throughput covers only what this run did itself.
+ */
+struct WorldArchiveResult
+{
+    std::filesystem::path archive;
+    std::size_t files = 0;
+    /// Files that an interrupted run had already archived.
+    std::size_t resumedFiles = 0;
+    std::uint64_t inputBytes = 0;
+    std::uint64_t outputBytes = 0;
+    double seconds = 0;
+};
+
+/**
+ * @brief Archives a world folder into a single .tar.zst for keeping off the machine. The tar is generated and
+ * compressed while the files are read, so memory use does not depend on the size of the world. Next to the archive,
+ * a .sha256 file lists the hash of every file in the format of sha256sum.
+ *
+ * The zstd stream is closed at checkpoints and the files archived since are appended to a journal. zstd reads
+ * concatenated frames as one stream, so an interrupted run is resumed by cutting the archive back to the last
+ * checkpoint and continuing with the next file.
+ *
+ * Like a backup, the archive of a running game server takes two passes. Files it wrote during the first pass are
+ * appended again while it is paused, tar extracts the later copy over the earlier one.
+ */
+class WorldArchive
+{
+  public:
+    /// Input between two checkpoints, at most this much work is repeated after an interruption.
+    constexpr static std::uint64_t checkpointBytes = 256ull * 1024 * 1024;
+
+    static unsigned int defaultThreadCount()
+    {
+        return std::clamp(std::thread::hardware_concurrency(), 1u, 8u);
+    }
+
+    WorldArchive(
+        std::filesystem::path world,
+        std::filesystem::path archives,
+        int compressionLevel,
+        unsigned int compressionThreads);
+
+    /**
+     * @brief Archives the world, or finishes the archive an interrupted run left behind. Throws on I/O errors, the
+     * next call resumes from the last checkpoint then.
+     *
+     * @param limiter Paces reading the world and writing the archive while the game server runs.
+     * @param pause Empty if the game server cannot be paused, the archive may then catch a file while it is written.
+     * Files it removes during the first pass stay in the archive.
+     */
+    WorldArchiveResult create(RateLimiter& limiter, WorldBackup::Pause const& pause);
+
+  private:
+    struct ArchivedFile
+    {
+        std::string name;
+        std::uint64_t size;
+        /// Ticks of the file clock when it was read, only compared for equality.
+        std::int64_t modified;
+        std::string sha256;
+    };
+
+    struct Journal
+    {
+        std::string archiveName;
+        std::uint64_t outputSize = 0;
+        std::vector<ArchivedFile> files;
+    };
+
+    std::filesystem::path journalFile() const;
+    Journal loadJournal() const;
+
+    /**
+     * @brief Writes the whole journal, only done when a run starts.
+     */
+    void saveJournal(Journal const& journal) const;
+
+    /**
+     * @brief Adds the files archived since the last checkpoint and the archive size of this one.
+     */
+    void appendToJournal(std::vector<ArchivedFile> const& files, std::uint64_t outputSize) const;
+
+    /**
+     * @brief One line per archived file, and one for the checkpoint with the archive size it reached.
+     */
+    static void writeJournalLines(
+        std::ostream& writer,
+        std::vector<ArchivedFile> const& files,
+        std::uint64_t outputSize);
+
+  private:
+    std::filesystem::path world_;
+    std::filesystem::path archives_;
+    int compressionLevel_;
+    unsigned int compressionThreads_;
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <update_server/rate_limiter.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief What a snapshot took over from its predecessor and what it had to copy.
+ */
+struct WorldSnapshot
+{
+    std::string name;
+    std::size_t files = 0;
+    std::size_t copiedFiles = 0;
+    std::uint64_t copiedBytes = 0;
+    std::uint64_t linkedBytes = 0;
+    /// How long the game server was kept from saving, 0 if it was not paused.
+    std::int64_t pausedMilliseconds = 0;
+};
+
+/**
+ * @brief Snapshot backups of a world folder. Every snapshot is a complete copy of the world, but files that did not
+ * change since the previous snapshot are hard links to it, so a snapshot only costs the space and time of the region
+ * files that were written in between. A manifest in every snapshot records what the world looked like, which makes
+ * any snapshot restorable on its own.
+ */
+class WorldBackup
+{
+  public:
+    /// Copies are bound by the disk, a few in flight keep it busy without starving the game server.
+    static unsigned int defaultThreadCount()
+    {
+        return std::clamp(std::thread::hardware_concurrency(), 1u, 4u);
+    }
+
+    /**
+     * @brief Keeps the game server from writing the world, end is called whenever begin returned.
+     */
+    struct Pause
+    {
+        std::function<void()> begin;
+        std::function<void()> end;
+    };
+
+    WorldBackup(std::filesystem::path world, std::filesystem::path backups, unsigned int threadCount);
+
+    /**
+     * @brief Creates the next snapshot. Throws if the world cannot be read or the snapshot cannot be written, an
+     * unfinished snapshot never shows up in snapshots().
+     *
+     * With a pause, the world is first copied while the game server keeps running. Only what it wrote meanwhile is
+     * copied again while it is paused, which makes the snapshot consistent at the cost of a short pause.
+     *
+     * @param limiter Paces the copies while the game server runs, hard links cost no I/O.
+     * @param pause Empty if the game server cannot be paused, the snapshot may then catch a file while it is written.
+     */
+    WorldSnapshot create(RateLimiter& limiter, Pause const& pause);
+
+    /**
+     * @brief The names of all complete snapshots, oldest first.
+     */
+    std::vector<std::string> snapshots() const;
+
+    /**
+     * @brief Replaces the world with a snapshot. The current world is moved aside to "<world>.before_restore".
+     * Must not run while the game server uses the world.
+     */
+    void restore(std::string const& snapshot) const;
+
+  private:
+    struct Entry
+    {
+        std::uintmax_t size;
+        std::int64_t modified;
+    };
+    using Manifest = std::unordered_map<std::string, Entry>;
+
+    /**
+     * @brief Brings the target up to date with the world. Files in present are already in the target and kept if
+     * they did not change since, files unchanged since the previous snapshot are linked, the rest is copied.
+     *
+     * @param limiter Paces the copies, nullptr for full speed.
+     * @return The manifest of the target.
+     */
+    Manifest copyWorld(
+        std::filesystem::path const& target,
+        Manifest const& present,
+        std::filesystem::path const& previousDirectory,
+        Manifest const& previous,
+        RateLimiter* limiter,
+        WorldSnapshot& snapshot) const;
+
+    Manifest loadManifest(std::filesystem::path const& snapshot) const;
+    void saveManifest(std::filesystem::path const& snapshot, Manifest const& manifest, std::string const& previous)
+        const;
+
+  private:
+    std::filesystem::path world_;
+    std::filesystem::path backups_;
+    unsigned int threadCount_;
+};
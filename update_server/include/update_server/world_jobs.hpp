@@ -0,0 +1,64 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+/**
+ * @brief Runs world backups and archives on a thread of their own, one at a time. Both take minutes on a large world,
+ * so the request that starts one is answered right away and the outcome is polled by the id of the job.
+ */
+class WorldJobs
+{
+  public:
+    /// The outcomes of older jobs are forgotten.
+    constexpr static std::size_t jobsKept = 16;
+
+    WorldJobs();
+
+    /**
+     * @brief Waits for the running job.
+     */
+    ~WorldJobs();
+    WorldJobs(WorldJobs const&) = delete;
+    WorldJobs& operator=(WorldJobs const&) = delete;
+
+    /**
+     * @brief Runs job on the job thread. What it returns is reported as result, an exception it throws fails it.
+     *
+     * @return The id of the job, std::nullopt while another job is still running.
+     */
+    std::optional<std::uint64_t> start(std::string kind, std::function<nlohmann::json()> job);
+
+    /**
+     * @brief The id, kind and state ("running", "finished" or "failed") of a job with its result or error.
+     * std::nullopt for jobs that never existed or were forgotten.
+     */
+    std::optional<nlohmann::json> status(std::uint64_t id) const;
+
+  private:
+    struct Job
+    {
+        std::uint64_t id;
+        std::string kind;
+        std::optional<nlohmann::json> result;
+        std::optional<std::string> error;
+    };
+
+    void finish(std::uint64_t id, std::optional<nlohmann::json> result, std::optional<std::string> error);
+
+  private:
+    mutable std::mutex guard_;
+    std::uint64_t nextId_;
+    bool running_;
+    /// Oldest first.
+    std::deque<Job> jobs_;
+    std::thread thread_;
+};
@@ -0,0 +1,305 @@
+#include <update_server/benchmark.hpp>
+#include <update_server/diff_cache.hpp>
+#include <update_server/hashing.hpp>
+#include <update_server/mod_index.hpp>
+
+#include <fmt/format.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#include <openssl/sha.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    /**
+     * @brief The sha256FromFile this engine replaced, kept as the baseline.
+     */
+    std::string legacySha256FromFile(std::filesystem::path const& source)
+    {
+        unsigned char hash[SHA256_DIGEST_LENGTH];
+        SHA256_CTX sha256;
+        if (!SHA256_Init(&sha256))
+            throw std::runtime_error("Could not initialize hash context.");
+
+        std::ifstream reader{source, std::ios_base::binary};
+        if (!reader.good())
+            throw std::runtime_error("Could not open file to generate hash: " + source.string());
+
+        std::string buffer(4096, '\0');
+        do
+        {
+            reader.read(buffer.data(), buffer.size());
+            if (!SHA256_Update(&sha256, buffer.c_str(), reader.gcount()))
+                throw std::runtime_error("Could not feed hash data");
+        } while (static_cast<std::size_t>(reader.gcount()) == buffer.size());
+
+        if (!SHA256_Final(hash, &sha256))
+            throw std::runtime_error("Could not finalize hash");
+
+        std::stringstream shastr;
+        shastr << std::hex << std::setfill('0');
+        for (const auto& byte : hash)
+        {
+            shastr << std::setw(2) << (int)byte;
+        }
+        return shastr.str();
+    }
+#pragma GCC diagnostic pop
+
+    /**
+     * @brief The buildDifference ModIndex replaced, kept as the baseline.
+     */
+    UpdateInstructions legacyBuildDifference(
+        std::vector<ModAndHash> const& localMods,
+        std::vector<ModAndHash> const& remoteFiles)
+    {
+        std::set<std::string> remoteSet, localSet;
+        std::transform(
+            std::begin(remoteFiles),
+            std::end(remoteFiles),
+            std::inserter(remoteSet, std::end(remoteSet)),
+            [](auto const& element) {
+                return element.path.string();
+            });
+        std::transform(
+            std::begin(localMods),
+            std::end(localMods),
+            std::inserter(localSet, std::end(localSet)),
+            [](auto const& element) {
+                return element.path.filename().string();
+            });
+
+        std::set<std::string> equal;
+        std::vector<std::string> fresh, old;
+        std::set_difference(
+            std::begin(remoteSet),
+            std::end(remoteSet),
+            std::begin(localSet),
+            std::end(localSet),
+            std::inserter(old, std::end(old)));
+        std::set_difference(
+            std::begin(localSet),
+            std::end(localSet),
+            std::begin(remoteSet),
+            std::end(remoteSet),
+            std::inserter(fresh, std::end(fresh)));
+        std::set_intersection(
+            std::begin(localSet),
+            std::end(localSet),
+            std::begin(remoteSet),
+            std::end(remoteSet),
+            std::inserter(equal, std::end(equal)));
+
+        auto hashOf = [&](std::string const& name) {
+            auto it = std::find_if(std::begin(localMods), std::end(localMods), [&name](auto const& element) {
+                return element.path.filename().string() == name;
+            });
+            if (it != std::end(localMods))
+                return it->sha256;
+            return std::string{};
+        };
+
+        for (auto const& remote : remoteFiles)
+        {
+            if (equal.find(remote.path.string()) != std::end(equal) && !remote.sha256.empty() &&
+                hashOf(remote.path.string()) != remote.sha256)
+            {
+                fresh.push_back(remote.path.string());
+                old.push_back(remote.path.string());
+            }
+        }
+        return UpdateInstructions{.download = fresh, .remove = old};
+    }
+
+    bool sameInstructions(UpdateInstructions lhs, UpdateInstructions rhs)
+    {
+        for (auto* list : {&lhs.download, &lhs.remove, &rhs.download, &rhs.remove})
+            std::sort(list->begin(), list->end());
+        return lhs.download == rhs.download && lhs.remove == rhs.remove;
+    }
+
+    struct Measurement
+    {
+        std::string name;
+        double seconds;
+    };
+
+    /**
+     * @brief Best of all repetitions, the first runs tend to be disturbed by the page cache and frequency scaling.
+     */
+    double measure(unsigned int repetitions, std::function<void()> const& action)
+    {
+        double best = std::numeric_limits<double>::max();
+        for (unsigned int i = 0; i != repetitions; ++i)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            action();
+            const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            best = std::min(best, elapsed);
+        }
+        return best;
+    }
+}
+
+namespace Benchmark
+{
+    void hashing(std::filesystem::path const& directory, unsigned int repetitions)
+    {
+        std::vector<std::filesystem::path> files;
+        std::uintmax_t bytes = 0;
+        for (auto const& entry : std::filesystem::directory_iterator{directory})
+        {
+            if (!entry.is_regular_file())
+                continue;
+            files.push_back(entry.path());
+            bytes += entry.file_size();
+        }
+        std::sort(files.begin(), files.end());
+        repetitions = std::max(1u, repetitions);
+
+        fmt::print(
+            "Hashing {} files, {:.1f} MB, best of {} runs\n",
+            files.size(),
+            static_cast<double>(bytes) / 1e6,
+            repetitions);
+
+        // Warm the page cache, so all variants read from memory.
+        for (auto const& file : files)
+            Hashing::hashFile(file, Hashing::Sha1);
+
+        using HashFunction = std::function<void(std::filesystem::path const&)>;
+        const std::vector<std::pair<std::string, HashFunction>> variants{
+            {"legacy sha256FromFile",
+             [](auto const& file) {
+                 legacySha256FromFile(file);
+             }},
+            {"engine sha256",
+             [](auto const& file) {
+                 Hashing::hashFile(file, Hashing::Sha256);
+             }},
+            {"engine sha1 + sha512, one pass",
+             [](auto const& file) {
+                 Hashing::hashFile(file, Hashing::Sha1 | Hashing::Sha512);
+             }},
+            {"engine sha1 + sha256 + sha512, one pass",
+             [](auto const& file) {
+                 Hashing::hashFile(file, Hashing::Sha1 | Hashing::Sha256 | Hashing::Sha512);
+             }},
+            {"engine sha1 + sha256 + sha512, three passes",
+             [](auto const& file) {
+                 Hashing::hashFile(file, Hashing::Sha1);
+                 Hashing::hashFile(file, Hashing::Sha256);
+                 Hashing::hashFile(file, Hashing::Sha512);
+             }},
+        };
+
+        std::vector<Measurement> measurements;
+        for (auto const& [name, hash] : variants)
+        {
+            measurements.push_back({name, measure(repetitions, [&files, &hash]() {
+                                        for (auto const& file : files)
+                                            hash(file);
+                                    })});
+        }
+
+        const auto baseline = measurements.front().seconds;
+        for (auto const& [name, seconds] : measurements)
+        {
+            fmt::print(
+                "{:<45} {:>8.3f} s {:>8.3f} GB/s {:>6.2f}x\n",
+                name,
+                seconds,
+                static_cast<double>(bytes) / 1e9 / seconds,
+                baseline / seconds);
+        }
+    }
+
+    void difference(std::size_t entries, unsigned int repetitions)
+    {
+        repetitions = std::max(1u, repetitions);
+        std::mt19937_64 random{42};
+        auto randomHash = [&random]() {
+            unsigned char bytes[32];
+            for (auto& byte : bytes)
+                byte = static_cast<unsigned char>(random());
+            return Hashing::toHex(bytes, sizeof(bytes));
+        };
+
+        // Server mods live in the mods folder, clients send bare file names. Most clients are mostly up to date.
+        std::vector<ModAndHash> localMods;
+        std::vector<ModAndHash> remoteFiles;
+        for (std::size_t i = 0; i != entries; ++i)
+        {
+            const auto name = fmt::format("mod-{:06}-1.2.{}.jar", i, i % 7);
+            const auto hash = randomHash();
+            localMods.push_back({.path = std::filesystem::path{"mods"} / name, .sha256 = hash});
+            switch (i % 20)
+            {
+                case (0):
+                    remoteFiles.push_back({.path = name, .sha256 = randomHash()});
+                    break;
+                case (1):
+                    remoteFiles.push_back({.path = fmt::format("old-{}", name), .sha256 = randomHash()});
+                    break;
+                case (2):
+                    break;
+                default:
+                    remoteFiles.push_back({.path = name, .sha256 = hash});
+            }
+        }
+        std::shuffle(remoteFiles.begin(), remoteFiles.end(), random);
+
+        fmt::print(
+            "Diffing {} client mods against {} server mods, best of {} runs\n",
+            remoteFiles.size(),
+            entries,
+            repetitions);
+
+        UpdateInstructions legacyResult;
+        const auto legacy = measure(repetitions, [&]() {
+            legacyResult = legacyBuildDifference(localMods, remoteFiles);
+        });
+
+        ModIndex index;
+        const auto indexing = measure(repetitions, [&]() {
+            index = ModIndex{localMods};
+        });
+
+        UpdateInstructions indexedResult;
+        const auto indexed = measure(repetitions, [&]() {
+            indexedResult = index.difference(remoteFiles);
+        });
+
+        // What a reconnecting client with an already seen mod set costs.
+        DiffCache cache{1};
+        cache.insert(0, "benchmark", clientFingerprint(remoteFiles), std::string(64 * 1024, ' '));
+        const auto cached = measure(repetitions, [&]() {
+            if (!cache.find("benchmark", clientFingerprint(remoteFiles)))
+                throw std::logic_error("Benchmark cache entry vanished");
+        });
+
+        fmt::print("{:<45} {:>10.3f} ms\n", "legacy buildDifference", legacy * 1e3);
+        fmt::print("{:<45} {:>10.3f} ms (once per mods folder change)\n", "ModIndex build", indexing * 1e3);
+        fmt::print("{:<45} {:>10.3f} ms {:>8.1f}x\n", "ModIndex difference", indexed * 1e3, legacy / indexed);
+        fmt::print("{:<45} {:>10.3f} ms {:>8.1f}x\n", "DiffCache hit", cached * 1e3, legacy / cached);
+        fmt::print(
+            "Results {} ({} to download, {} to remove)\n",
+            sameInstructions(legacyResult, indexedResult) ? "match" : "DIFFER",
+            indexedResult.download.size(),
+            indexedResult.remove.size());
+    }
+}
@@ -0,0 +1,300 @@
+#include <update_server/class_data_sharing.hpp>
+#include <update_server/hashing.hpp>
+#include <update_server/minecraft.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+    constexpr char const* serverJarName = "server.jar";
+    constexpr char const* scratchDirName = "training";
+    constexpr char const* archiveExtension = ".jsa";
+    constexpr char const* partialSuffix = ".partial";
+    constexpr char const* librariesDirName = "libraries";
+    /// Only read by the server, shared with the scratch directory.
+    constexpr char const* linkedEntries[] = {librariesDirName, "versions", "fabric-server-launcher.properties"};
+    constexpr char const* copiedEntries[] = {"eula.txt"};
+    /// Minecraft and the loader without mods, training does not have to be fast.
+    constexpr std::uint64_t trainingHeapMebibytes = 1024;
+
+    /**
+     * @brief A port nothing listens on right now, so the training server does not collide with the real one.
+     */
+    unsigned short freePort()
+    {
+        boost::asio::io_context context;
+        boost::asio::ip::tcp::acceptor acceptor{context, {boost::asio::ip::tcp::v4(), 0}};
+        return acceptor.local_endpoint().port();
+    }
+}
+
+// #####################################################################################################################
+ClassDataSharing::ClassDataSharing(
+    std::filesystem::path serverDirectory,
+    std::filesystem::path directory,
+    LaunchProfile profile)
+    : serverDirectory_{std::move(serverDirectory)}
+    , directory_{std::move(directory)}
+    , profile_{std::move(profile)}
+    , guard_{}
+    , wake_{}
+    , requested_{false}
+    , stop_{false}
+    , thread_{}
+{
+    thread_ = std::thread{[this]() {
+        run();
+    }};
+}
+//---------------------------------------------------------------------------------------------------------------------
+ClassDataSharing::~ClassDataSharing()
+{
+    {
+        std::scoped_lock lock{guard_};
+        stop_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::vector<std::string> ClassDataSharing::jvmArguments() const
+{
+    try
+    {
+        const auto archive = archiveFile(fingerprint());
+        if (!std::filesystem::exists(archive))
+            return {};
+        // A JVM that cannot use the archive, after a Java update for example, warns and starts without it.
+        return {"-XX:SharedArchiveFile=" + archive.string()};
+    }
+    catch (std::exception const& e)
+    {
+        std::cout << "Starting without class data sharing: " << e.what() << "\n";
+        return {};
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+void ClassDataSharing::train()
+{
+    {
+        std::scoped_lock lock{guard_};
+        requested_ = true;
+    }
+    wake_.notify_all();
+}
+//---------------------------------------------------------------------------------------------------------------------
+void ClassDataSharing::run()
+{
+    std::unique_lock lock{guard_};
+    while (true)
+    {
+        wake_.wait(lock, [this]() {
+            return stop_ || requested_;
+        });
+        if (stop_ || wake_.wait_for(lock, trainingDelay, [this]() {
+                return stop_;
+            }))
+        {
+            return;
+        }
+        requested_ = false;
+
+        lock.unlock();
+        try
+        {
+            trainNow();
+        }
+        catch (std::exception const& e)
+        {
+            std::cout << "Class data sharing training failed: " << e.what() << "\n";
+        }
+        lock.lock();
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+void ClassDataSharing::trainNow()
+{
+    const auto archive = archiveFile(fingerprint());
+    if (std::filesystem::exists(archive))
+        return;
+
+    const auto scratch = directory_ / scratchDirName;
+    prepareScratchDirectory(scratch);
+    const auto partial = std::filesystem::path{archive.string() + partialSuffix};
+    std::filesystem::remove(partial);
+
+    std::atomic_bool started{false};
+    Minecraft training{
+        [this, &started](std::string_view line) {
+            if (line.find("Done (") != std::string_view::npos && line.find(")! For help") != std::string_view::npos)
+            {
+                started = true;
+                wake_.notify_all();
+            }
+        },
+        false};
+    auto profile = profile_;
+    profile.minimumHeapMebibytes = trainingHeapMebibytes;
+    profile.maximumHeapMebibytes = trainingHeapMebibytes;
+
+    std::cout << "Training class data sharing for the current server.jar\n";
+    const auto start = std::chrono::steady_clock::now();
+    // The same jar path as the real server: the JVM only accepts the archive for the class path it was made with.
+    training.start(
+        (serverDirectory_ / serverJarName).string(),
+        profile,
+        {
+            // Later flags win, touching every page of the heap up front is only worth it for the real server.
+            .jvmArguments = {"-XX:-AlwaysPreTouch", "-XX:ArchiveClassesAtExit=" + partial.string()},
+            .lowPriority = true,
+            .workingDirectory = scratch,
+        });
+
+    // Shutting down the update server does not wait for a training that is half done.
+    const auto stopped = [&](auto done, std::chrono::steady_clock::duration timeout) {
+        std::unique_lock lock{guard_};
+        while (!done() && !stop_ && std::chrono::steady_clock::now() - start < timeout)
+            wake_.wait_for(lock, std::chrono::seconds{1});
+        if (stop_)
+            training.terminate();
+        return stop_;
+    };
+    if (stopped(
+            [&]() {
+                return started || !training.running();
+            },
+            trainingTimeout))
+    {
+        return;
+    }
+    if (!started)
+    {
+        training.terminate();
+        throw std::runtime_error("The training server did not start, Java 13 or newer is required");
+    }
+
+    // The archive is written while the JVM exits.
+    training.sendCommand("stop");
+    if (stopped(
+            [&]() {
+                return !training.running();
+            },
+            trainingTimeout + stopTimeout))
+    {
+        return;
+    }
+    if (training.running())
+    {
+        training.terminate();
+        throw std::runtime_error("The training server did not stop in time");
+    }
+    // Its console closes when the process exits, after the archive was written.
+    if (!std::filesystem::exists(partial) || std::filesystem::file_size(partial) == 0)
+        throw std::runtime_error("The training server did not write an archive");
+
+    std::filesystem::rename(partial, archive);
+    for (auto const& entry : std::filesystem::directory_iterator{directory_})
+    {
+        if (entry.path().extension() == archiveExtension && entry.path().filename() != archive.filename())
+            std::filesystem::remove(entry.path());
+    }
+    std::cout << "Trained class data sharing archive " << archive.filename().string() << " in "
+              << std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - start).count()
+              << " s, it is used from the next start of the game server on\n";
+}
+//---------------------------------------------------------------------------------------------------------------------
+void ClassDataSharing::prepareScratchDirectory(std::filesystem::path const& scratch) const
+{
+    // Keeps .fabric, Fabric remaps Minecraft only once then.
+    std::filesystem::create_directories(scratch);
+    std::filesystem::remove_all(scratch / "world");
+    std::filesystem::remove_all(scratch / "logs");
+    std::filesystem::remove_all(scratch / "config");
+    // The mods are not part of the archive and would only make the training slower.
+    std::filesystem::remove_all(scratch / "mods");
+    std::filesystem::create_directory(scratch / "mods");
+
+    const auto server = std::filesystem::absolute(serverDirectory_);
+    for (auto const* name : linkedEntries)
+    {
+        std::filesystem::remove_all(scratch / name);
+        if (std::filesystem::is_directory(server / name))
+            std::filesystem::create_directory_symlink(server / name, scratch / name);
+        else if (std::filesystem::exists(server / name))
+            std::filesystem::create_symlink(server / name, scratch / name);
+    }
+    for (auto const* name : copiedEntries)
+    {
+        std::filesystem::remove_all(scratch / name);
+        if (std::filesystem::exists(server / name))
+            std::filesystem::copy(server / name, scratch / name, std::filesystem::copy_options::recursive);
+    }
+
+    // A small world without structures, it only has to load.
+    std::ofstream properties{scratch / "server.properties", std::ios_base::binary | std::ios_base::trunc};
+    properties << "server-port=" << freePort() << "\n"
+               << "level-name=world\n"
+               << "level-type=minecraft\\:flat\n"
+               << "generate-structures=false\n"
+               << "online-mode=false\n"
+               << "enable-query=false\n"
+               << "enable-rcon=false\n"
+               << "view-distance=2\n"
+               << "simulation-distance=2\n";
+    if (!properties.good())
+        throw std::runtime_error("Could not write " + (scratch / "server.properties").string());
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::string ClassDataSharing::fingerprint() const
+{
+    Hashing::MultiDigest digest{Hashing::Sha256};
+    const auto add = [&digest](std::string const& part) {
+        digest.update(part.data(), part.size());
+        digest.update("\n", 1);
+    };
+    add(Hashing::hashFile(serverDirectory_ / serverJarName, Hashing::Sha256).sha256);
+    add(profile_.name);
+
+    // Library paths carry their versions, an update of the loader changes them.
+    std::vector<std::string> libraries;
+    if (std::filesystem::is_directory(serverDirectory_ / librariesDirName))
+    {
+        for (auto const& entry : std::filesystem::recursive_directory_iterator{serverDirectory_ / librariesDirName})
+        {
+            if (entry.is_regular_file())
+            {
+                libraries.push_back(
+                    entry.path().lexically_relative(serverDirectory_).generic_string() + " " +
+                    std::to_string(entry.file_size()));
+            }
+        }
+    }
+    std::sort(libraries.begin(), libraries.end());
+    for (auto const& library : libraries)
+        add(library);
+
+    // The installation of the java on the path the game server is started with, updates replace its files.
+    const auto java = boost::process::search_path("java");
+    if (!java.empty())
+    {
+        const auto launcher = std::filesystem::canonical(java.string());
+        add(launcher.string());
+        add(std::to_string(std::filesystem::last_write_time(launcher).time_since_epoch().count()));
+    }
+    return digest.finish().sha256;
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::filesystem::path ClassDataSharing::archiveFile(std::string const& fingerprint) const
+{
+    // Passed to JVMs that run in other directories.
+    return std::filesystem::absolute(directory_ / (fingerprint.substr(0, 32) + archiveExtension));
+}
+// #####################################################################################################################
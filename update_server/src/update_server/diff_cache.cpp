@@ -0,0 +1,101 @@
+#include <update_server/diff_cache.hpp>
+#include <update_server/hashing.hpp>
+
+#include <algorithm>
+#include <tuple>
+
+// #####################################################################################################################
+std::string clientFingerprint(std::vector<ModAndHash> const& files)
+{
+    std::vector<ModAndHash const*> sorted;
+    sorted.reserve(files.size());
+    for (auto const& file : files)
+        sorted.push_back(&file);
+    std::sort(sorted.begin(), sorted.end(), [](auto const* lhs, auto const* rhs) {
+        return std::tie(lhs->path.native(), lhs->sha256) < std::tie(rhs->path.native(), rhs->sha256);
+    });
+
+    // One update call, the digest setup per call costs more than hashing a name.
+    std::string encoded;
+    for (auto const* file : sorted)
+    {
+        encoded.append(file->path.string());
+        encoded.push_back('\0');
+        encoded.append(file->sha256);
+        encoded.push_back('\0');
+    }
+    Hashing::MultiDigest digest{Hashing::Sha256};
+    digest.update(encoded.data(), encoded.size());
+    return digest.finish().sha256;
+}
+// #####################################################################################################################
+DiffCache::DiffCache(std::size_t capacity)
+    : guard_{}
+    , capacity_{capacity}
+    , generation_{0}
+    , snapshotEtag_{}
+    , entries_{}
+    , index_{}
+    , hits_{0}
+    , misses_{0}
+{}
+//---------------------------------------------------------------------------------------------------------------------
+std::optional<std::string> DiffCache::find(std::string const& snapshotEtag, std::string const& fingerprint)
+{
+    std::scoped_lock lock{guard_};
+    auto it = index_.find(fingerprint);
+    if (snapshotEtag != snapshotEtag_ || it == index_.end())
+    {
+        ++misses_;
+        return std::nullopt;
+    }
+    ++hits_;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->second;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void DiffCache::insert(
+    std::uint64_t generation,
+    std::string const& snapshotEtag,
+    std::string const& fingerprint,
+    std::string response)
+{
+    std::scoped_lock lock{guard_};
+    // Checked under the lock, a publish between building the answer and this insert must not win against it.
+    if (generation < generation_)
+        return;
+    if (snapshotEtag != snapshotEtag_)
+    {
+        entries_.clear();
+        index_.clear();
+        generation_ = generation;
+        snapshotEtag_ = snapshotEtag;
+    }
+    if (auto it = index_.find(fingerprint); it != index_.end())
+    {
+        it->second->second = std::move(response);
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return;
+    }
+
+    entries_.emplace_front(fingerprint, std::move(response));
+    index_[fingerprint] = entries_.begin();
+    if (entries_.size() > capacity_)
+    {
+        index_.erase(entries_.back().first);
+        entries_.pop_back();
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::size_t DiffCache::hits() const
+{
+    std::scoped_lock lock{guard_};
+    return hits_;
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::size_t DiffCache::misses() const
+{
+    std::scoped_lock lock{guard_};
+    return misses_;
+}
+// #####################################################################################################################
@@ -0,0 +1,151 @@
+#include <update_server/hash_cache.hpp>
+#include <update_server/sha256.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <sys/stat.h>
+
+#include <fstream>
+#include <iostream>
+#include <set>
+
+namespace
+{
+    constexpr int cacheFormatVersion = 1;
+}
+
+// #####################################################################################################################
+HashCache::HashCache(std::filesystem::path cacheFile)
+    : guard_{}
+    , cacheFile_{std::move(cacheFile)}
+    , entries_{}
+    , dirty_{false}
+    , hashesComputed_{0}
+{}
+//---------------------------------------------------------------------------------------------------------------------
+void HashCache::load()
+{
+    std::scoped_lock lock{guard_};
+    entries_.clear();
+    dirty_ = false;
+
+    std::ifstream reader{cacheFile_, std::ios_base::binary};
+    if (!reader.good())
+        return;
+
+    const auto cache = nlohmann::json::parse(reader, nullptr, false);
+    if (cache.is_discarded() || !cache.is_object() || cache.value("version", 0) != cacheFormatVersion)
+    {
+        std::cout << "Ignoring unreadable hash cache: " << cacheFile_.string() << "\n";
+        return;
+    }
+    for (auto const& [path, entry] : cache.at("entries").items())
+    {
+        entries_[path] = Entry{
+            .inode = entry.at("inode").get<std::uint64_t>(),
+            .size = entry.at("size").get<std::uintmax_t>(),
+            .modified = entry.at("modified").get<std::int64_t>(),
+            .sha256 = entry.at("sha256").get<std::string>(),
+        };
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+void HashCache::save()
+{
+    std::scoped_lock lock{guard_};
+    if (!dirty_)
+        return;
+
+    auto entries = nlohmann::json::object();
+    for (auto const& [path, entry] : entries_)
+    {
+        entries[path] = {
+            {"inode", entry.inode},
+            {"size", entry.size},
+            {"modified", entry.modified},
+            {"sha256", entry.sha256},
+        };
+    }
+
+    // Write aside and rename, a crash while writing must not leave a truncated cache behind.
+    const auto temporary = std::filesystem::path{cacheFile_.string() + ".tmp"};
+    {
+        std::ofstream writer{temporary, std::ios_base::binary};
+        if (!writer.good())
+        {
+            std::cout << "Could not write hash cache: " << temporary.string() << "\n";
+            return;
+        }
+        writer << nlohmann::json{{"version", cacheFormatVersion}, {"entries", entries}}.dump();
+    }
+    std::filesystem::rename(temporary, cacheFile_);
+    dirty_ = false;
+}
+//---------------------------------------------------------------------------------------------------------------------
+HashCache::Entry HashCache::identify(std::filesystem::path const& file)
+{
+    struct stat status;
+    if (::stat(file.string().c_str(), &status) != 0)
+        throw std::runtime_error("Could not stat file: " + file.string());
+
+    return Entry{
+        .inode = static_cast<std::uint64_t>(status.st_ino),
+        .size = static_cast<std::uintmax_t>(status.st_size),
+#ifdef _WIN32
+        .modified = static_cast<std::int64_t>(status.st_mtime) * 1'000'000'000,
+#else
+        .modified = static_cast<std::int64_t>(status.st_mtim.tv_sec) * 1'000'000'000 + status.st_mtim.tv_nsec,
+#endif
+        .sha256 = {},
+    };
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::string HashCache::sha256(std::filesystem::path const& file)
+{
+    auto identity = identify(file);
+    const auto key = file.string();
+    {
+        std::scoped_lock lock{guard_};
+        if (auto it = entries_.find(key); it != entries_.end() && it->second.inode == identity.inode &&
+            it->second.size == identity.size && it->second.modified == identity.modified)
+            return it->second.sha256;
+    }
+
+    // Hash outside the lock, so lookups of other files are not held up.
+    identity.sha256 = sha256FromFile(file);
+
+    std::scoped_lock lock{guard_};
+    entries_[key] = identity;
+    dirty_ = true;
+    ++hashesComputed_;
+    return identity.sha256;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void HashCache::remember(std::filesystem::path const& file, std::string const& sha256)
+{
+    auto identity = identify(file);
+    identity.sha256 = sha256;
+
+    std::scoped_lock lock{guard_};
+    entries_[file.string()] = std::move(identity);
+    dirty_ = true;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void HashCache::retainOnly(std::vector<std::filesystem::path> const& files)
+{
+    std::set<std::string> keep;
+    for (auto const& file : files)
+        keep.insert(file.string());
+
+    std::scoped_lock lock{guard_};
+    dirty_ |= std::erase_if(entries_, [&keep](auto const& entry) {
+                  return !keep.contains(entry.first);
+              }) != 0;
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::size_t HashCache::hashesComputed() const
+{
+    std::scoped_lock lock{guard_};
+    return hashesComputed_;
+}
+// #####################################################################################################################
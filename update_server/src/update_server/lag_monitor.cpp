@@ -0,0 +1,74 @@
+#include <update_server/lag_monitor.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+namespace
+{
+    constexpr std::chrono::milliseconds pollInterval{250};
+    constexpr char const* lagMessage = "Can't keep up!";
+    /// Read per poll, a log that grew a lot meanwhile is caught up with over several polls.
+    constexpr std::uintmax_t maximumRead = 1024 * 1024;
+}
+
+// #####################################################################################################################
+LagMonitor::LagMonitor(std::filesystem::path logFile, std::function<void()> onLag)
+    : logFile_{std::move(logFile)}
+    , onLag_{std::move(onLag)}
+    , stop_{false}
+    , thread_{}
+{
+    thread_ = std::thread{[this]() {
+        run();
+    }};
+}
+//---------------------------------------------------------------------------------------------------------------------
+LagMonitor::~LagMonitor()
+{
+    stop_ = true;
+    if (thread_.joinable())
+        thread_.join();
+}
+//---------------------------------------------------------------------------------------------------------------------
+void LagMonitor::run()
+{
+    std::error_code ec;
+    auto offset = std::filesystem::file_size(logFile_, ec);
+    if (ec)
+        offset = 0;
+    std::string partialLine;
+
+    for (; !stop_; std::this_thread::sleep_for(pollInterval))
+    {
+        const auto size = std::filesystem::file_size(logFile_, ec);
+        if (ec || size == offset)
+            continue;
+        if (size < offset)
+        {
+            offset = 0;
+            partialLine.clear();
+        }
+
+        std::ifstream reader{logFile_, std::ios_base::binary};
+        reader.seekg(static_cast<std::streamoff>(offset));
+        std::string chunk(static_cast<std::size_t>(std::min<std::uintmax_t>(size - offset, maximumRead)), '\0');
+        reader.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        chunk.resize(static_cast<std::size_t>(reader.gcount()));
+        offset += chunk.size();
+
+        // The game server may be in the middle of a line, the rest comes with the next poll.
+        partialLine += chunk;
+        std::size_t begin = 0;
+        for (auto end = partialLine.find('\n'); end != std::string::npos; end = partialLine.find('\n', begin))
+        {
+            if (std::string_view{partialLine}.substr(begin, end - begin).find(lagMessage) != std::string_view::npos)
+                onLag_();
+            begin = end + 1;
+        }
+        partialLine.erase(0, begin);
+    }
+}
+// #####################################################################################################################
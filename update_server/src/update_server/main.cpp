@@ -1,3 +1,5 @@
+#include <backend/launch_profile.hpp>
+#include <update_server/benchmark.hpp>
 #include <update_server/update_provider.hpp>
 
 #include <roar/server.hpp>
@@ -9,13 +11,27 @@
 
 #include <cxxopts.hpp>
 
+#include <cctype>
+#include <cstdint>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <optional>
 
 constexpr int port = 25002;
 
 struct ProgramOptions
 {
     std::filesystem::path serverDirectory;
+    std::optional<std::filesystem::path> benchmarkHashing;
+    std::optional<std::size_t> benchmarkDiff;
+    unsigned int benchmarkRepetitions;
+    std::optional<std::string> adminToken;
+    std::optional<std::string> restoreBackup;
+    bool archiveWorld;
+    std::uint64_t backupBytesPerSecond;
+    bool startMinecraft;
+    LaunchProfile launchProfile;
 };
 
 ProgramOptions parseOptions(int argc, char** argv);
@@ -24,6 +40,27 @@ int main(int argc, char** argv)
 {
     ProgramOptions options = parseOptions(argc, argv);
 
+    if (options.benchmarkHashing)
+    {
+        Benchmark::hashing(*options.benchmarkHashing, options.benchmarkRepetitions);
+        return 0;
+    }
+    if (options.benchmarkDiff)
+    {
+        Benchmark::difference(*options.benchmarkDiff, options.benchmarkRepetitions);
+        return 0;
+    }
+    if (options.restoreBackup)
+    {
+        UpdateProvider::restoreWorld(options.serverDirectory, *options.restoreBackup);
+        return 0;
+    }
+    if (options.archiveWorld)
+    {
+        UpdateProvider::archiveWorld(options.serverDirectory, options.backupBytesPerSecond);
+        return 0;
+    }
+
     boost::asio::thread_pool pool{4};
 
     // Create server.
@@ -34,7 +71,11 @@ int main(int argc, char** argv)
         pool.join();
     }};
 
-    server.installRequestListener<UpdateProvider>(options.serverDirectory);
+    const auto provider = server.installRequestListener<UpdateProvider>(
+        options.serverDirectory,
+        options.adminToken,
+        options.backupBytesPerSecond,
+        options.startMinecraft ? std::optional{options.launchProfile} : std::nullopt);
 
     // Start server and bind on port "port".
     server.start(port);
@@ -42,7 +83,10 @@ int main(int argc, char** argv)
     std::cout << "Running on: " << port << "\n";
 
     // Prevent exit somehow:
-    std::cin.get();
+    if (options.startMinecraft)
+        provider->forwardConsole();
+    else
+        std::cin.get();
     // Roar::ShutdownBarrier barrier;
     // barrier.wait();
 }
@@ -50,9 +94,62 @@ int main(int argc, char** argv)
 ProgramOptions parseOptions(int argc, char** argv)
 {
     cxxopts::Options options("update_server", "Update server for minecraft servers");
-    options.add_options()("s,server-directory", "Server directory", cxxopts::value<std::string>());
+    // clang-format off
+    options.add_options()
+        ("s,server-directory", "Server directory", cxxopts::value<std::string>())
+        ("benchmark-hashing", "Measure hashing throughput on a directory and exit", cxxopts::value<std::string>())
+        ("benchmark-diff", "Time the update diff on this many synthetic mods and exit", cxxopts::value<std::size_t>())
+        ("benchmark-repetitions", "Runs per benchmark, best is reported", cxxopts::value<unsigned int>()->default_value("3"))
+        ("admin-token-file", "Bearer token for uploads, backups and the console, sent in plain text, all disabled without", cxxopts::value<std::string>())
+        ("restore-backup", "Replace the world with this backup and exit, the server must not be running", cxxopts::value<std::string>())
+        ("archive-world", "Archive the world into a .tar.zst and exit, resumes an interrupted archive", cxxopts::value<bool>()->default_value("false"))
+        ("start-minecraft", "Run server.jar in the server directory, its console is forwarded and backups pause saving", cxxopts::value<bool>()->default_value("false"))
+        ("launch-profile", "JVM settings for --start-minecraft: g1 or zgc", cxxopts::value<std::string>()->default_value(LaunchProfile::defaultName))
+        ("server-cpus", "Pin the game server to these cores, like 0-3", cxxopts::value<std::string>())
+        ("backup-io-limit", "Disk I/O cap for backups and archives in MiB/s, 0 for none, lag slows them down either way", cxxopts::value<std::uint64_t>()->default_value("0"));
+    // clang-format on
     auto result = options.parse(argc, argv);
-    return ProgramOptions{
-        .serverDirectory = result["server-directory"].as<std::string>(),
+
+    ProgramOptions programOptions{
+        .serverDirectory = {},
+        .benchmarkHashing = std::nullopt,
+        .benchmarkDiff = std::nullopt,
+        .benchmarkRepetitions = result["benchmark-repetitions"].as<unsigned int>(),
+        .adminToken = std::nullopt,
+        .restoreBackup = std::nullopt,
+        .archiveWorld = result["archive-world"].as<bool>(),
+        .backupBytesPerSecond = result["backup-io-limit"].as<std::uint64_t>() * 1024 * 1024,
+        .startMinecraft = result["start-minecraft"].as<bool>(),
+        .launchProfile = {},
     };
+    const auto profileName = result["launch-profile"].as<std::string>();
+    if (auto profile = LaunchProfile::named(profileName))
+        programOptions.launchProfile = std::move(*profile);
+    else
+        throw std::invalid_argument("Unknown launch profile: " + profileName);
+    if (result.count("server-cpus"))
+        programOptions.launchProfile.cpus = LaunchProfile::parseCpuList(result["server-cpus"].as<std::string>());
+    if (result.count("benchmark-hashing"))
+        programOptions.benchmarkHashing = result["benchmark-hashing"].as<std::string>();
+    if (result.count("benchmark-diff"))
+        programOptions.benchmarkDiff = result["benchmark-diff"].as<std::size_t>();
+    if (!programOptions.benchmarkHashing && !programOptions.benchmarkDiff && !result.count("server-directory"))
+        throw std::invalid_argument("--server-directory is required");
+    if (result.count("server-directory"))
+        programOptions.serverDirectory = result["server-directory"].as<std::string>();
+    if (result.count("restore-backup"))
+        programOptions.restoreBackup = result["restore-backup"].as<std::string>();
+    if (result.count("admin-token-file"))
+    {
+        const auto tokenFile = result["admin-token-file"].as<std::string>();
+        std::ifstream reader{tokenFile, std::ios_base::binary};
+        std::string token{std::istreambuf_iterator<char>{reader}, std::istreambuf_iterator<char>{}};
+        // Editors like to end the file with a newline.
+        while (!token.empty() && std::isspace(static_cast<unsigned char>(token.back())))
+            token.pop_back();
+        if (token.empty())
+            throw std::invalid_argument("--admin-token-file is missing or empty: " + tokenFile);
+        programOptions.adminToken = std::move(token);
+    }
+    return programOptions;
 }
\ No newline at end of file
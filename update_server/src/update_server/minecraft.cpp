@@ -1,19 +1,156 @@
 #include <update_server/minecraft.hpp>
 
+#include <algorithm>
 #include <cstdlib>
+#include <filesystem>
 #include <iostream>
+#include <stdexcept>
 
-using namespace std::string_literals;
+#ifdef __linux__
+#    include <boost/process/extend.hpp>
+#    include <sched.h>
+#    include <sys/resource.h>
+#    include <unistd.h>
+#elif defined(_WIN32)
+#    include <windows.h>
+#endif
+
+namespace
+{
+    constexpr int lowPriorityNiceness = 10;
+
+    std::uint64_t hostMebibytes()
+    {
+#ifdef _WIN32
+        MEMORYSTATUSEX status{};
+        status.dwLength = sizeof(status);
+        if (GlobalMemoryStatusEx(&status))
+            return status.ullTotalPhys / (1024 * 1024);
+        return 0;
+#else
+        const auto pages = sysconf(_SC_PHYS_PAGES);
+        const auto pageSize = sysconf(_SC_PAGESIZE);
+        if (pages <= 0 || pageSize <= 0)
+            return 0;
+        return static_cast<std::uint64_t>(pages) * static_cast<std::uint64_t>(pageSize) / (1024 * 1024);
+#endif
+    }
+
+#ifdef __linux__
+    /**
+     * @brief Pins and nices the child between fork and exec, so every thread of the JVM inherits it.
+     */
+    struct ChildSetup : boost::process::extend::handler
+    {
+        cpu_set_t cpus;
+        bool lowPriority;
+
+        ChildSetup(std::vector<unsigned int> const& cpuList, bool lowPriority)
+            : cpus{}
+            , lowPriority{lowPriority}
+        {
+            CPU_ZERO(&cpus);
+            for (auto cpu : cpuList)
+            {
+                if (cpu < CPU_SETSIZE)
+                    CPU_SET(cpu, &cpus);
+            }
+        }
+
+        template <typename ExecutorT>
+        void on_exec_setup(ExecutorT&) const
+        {
+            // Only async-signal-safe calls here. A failure leaves the JVM on all cores.
+            if (CPU_COUNT(&cpus) != 0)
+                sched_setaffinity(0, sizeof(cpus), &cpus);
+            if (lowPriority)
+                setpriority(PRIO_PROCESS, 0, lowPriorityNiceness);
+        }
+    };
+#endif
+}
 
-Minecraft::Minecraft()
+Minecraft::Minecraft(OutputHandler onOutput, bool echoOutput)
+    : onOutput_{std::move(onOutput)}
+    , echoOutput_{echoOutput}
+    , inputGuard_{}
+    , waitersGuard_{}
+    , lineArrived_{}
+    , waiters_{}
+    , outputClosed_{true}
+    , input_{}
+    , output_{}
+    , errors_{}
+    , process_{}
+    , outputReader_{}
+    , errorReader_{}
 {}
 
-void Minecraft::start(std::string const& serverJar)
+Minecraft::~Minecraft()
+{
+    std::error_code ec;
+    if (process_ && process_->running(ec) && !stop())
+        terminate();
+    if (outputReader_.joinable())
+        outputReader_.join();
+    if (errorReader_.joinable())
+        errorReader_.join();
+}
+
+void Minecraft::start(std::string const& serverJar, LaunchProfile const& profile)
+{
+    start(serverJar, profile, LaunchOptions{});
+}
+void Minecraft::start(std::string const& serverJar, LaunchProfile const& profile, LaunchOptions const& options)
 {
     namespace bp = boost::process;
 
+    // The pipes cannot be reopened once the game server closed them.
+    if (process_)
+        throw std::logic_error("The game server was already started");
+
+    {
+        std::scoped_lock lock{waitersGuard_};
+        outputClosed_ = false;
+    }
+    // The server creates its world and logs relative to the working directory.
+    const auto jar = std::filesystem::absolute(serverJar);
+    auto arguments = profile.jvmArguments(hostMebibytes());
+    arguments.insert(arguments.end(), options.jvmArguments.begin(), options.jvmArguments.end());
+    arguments.push_back("-jar");
+    arguments.push_back(jar.string());
+    if (echoOutput_)
+    {
+        std::cout << "Starting the game server with launch profile " << profile.name << ":";
+        for (auto const& argument : arguments)
+            std::cout << " " << argument;
+        std::cout << "\n";
+    }
+
     process_ = std::make_unique<bp::child>(
-        "java -jar "s + serverJar, bp::std_out > stdout, bp::std_err > stderr, bp::std_in < stdin);
+        bp::search_path("java"),
+        bp::args = arguments,
+        bp::start_dir = (options.workingDirectory.empty() ? jar.parent_path() : options.workingDirectory).string(),
+        bp::std_out > output_,
+        bp::std_err > errors_,
+        bp::std_in < input_
+#ifdef __linux__
+        ,
+        ChildSetup{profile.cpus, options.lowPriority}
+#endif
+    );
+#ifdef _WIN32
+    if (const auto mask = profile.affinityMask(); mask != 0)
+        SetProcessAffinityMask(process_->native_handle(), static_cast<DWORD_PTR>(mask));
+    if (options.lowPriority)
+        SetPriorityClass(process_->native_handle(), BELOW_NORMAL_PRIORITY_CLASS);
+#endif
+    outputReader_ = std::thread{[this]() {
+        readOutput();
+    }};
+    errorReader_ = std::thread{[this]() {
+        readErrors();
+    }};
 }
 bool Minecraft::stop(int waitTimeoutSeconds)
 {
@@ -24,7 +161,8 @@ bool Minecraft::stop(int waitTimeoutSeconds)
 #endif
     for (int i = 0; i != waitTimeoutSeconds; ++i)
     {
-        std::cout << "Waiting for " << i << " seconds for minecraft to shutdown...\n";
+        if (echoOutput_)
+            std::cout << "Waiting for " << i << " seconds for minecraft to shutdown...\n";
         if (process_->wait_for(std::chrono::seconds(1)))
         {
             return true;
@@ -32,11 +170,113 @@ bool Minecraft::stop(int waitTimeoutSeconds)
     }
     return false;
 }
+void Minecraft::terminate()
+{
+    std::error_code ec;
+    if (process_ && process_->running(ec))
+        process_->terminate(ec);
+}
+bool Minecraft::waitForExit(std::chrono::seconds timeout)
+{
+    return !process_ || process_->wait_for(timeout);
+}
+bool Minecraft::running() const
+{
+    std::scoped_lock lock{waitersGuard_};
+    return !outputClosed_;
+}
+int Minecraft::processId() const
+{
+    return process_->id();
+}
 void Minecraft::forwardIo()
 {
     std::string line;
-    do
+    while (std::getline(std::cin, line) && line != "/stop")
+    {
+        if (!sendCommand(line))
+            std::cout << "The game server is not running.\n";
+    }
+}
+bool Minecraft::sendCommand(std::string const& command)
+{
+    std::scoped_lock lock{inputGuard_};
+    if (!running())
+        return false;
+    input_ << command << '\n' << std::flush;
+    return input_.good();
+}
+std::optional<std::string>
+Minecraft::sendCommand(std::string const& command, LineMatcher matcher, std::chrono::milliseconds timeout)
+{
+    Waiter waiter{.matcher = std::move(matcher), .line = std::nullopt};
+    {
+        // Registered before sending, the answer can arrive before sendCommand returns.
+        std::scoped_lock lock{waitersGuard_};
+        if (outputClosed_)
+            return std::nullopt;
+        waiters_.push_back(&waiter);
+    }
+
+    const bool sent = sendCommand(command);
+    std::unique_lock lock{waitersGuard_};
+    if (sent)
+    {
+        lineArrived_.wait_for(lock, timeout, [&]() {
+            return waiter.line || outputClosed_;
+        });
+    }
+    waiters_.erase(std::find(waiters_.begin(), waiters_.end(), &waiter));
+    return std::move(waiter.line);
+}
+std::optional<std::string> Minecraft::waitForOutput(LineMatcher matcher, std::chrono::milliseconds timeout)
+{
+    Waiter waiter{.matcher = std::move(matcher), .line = std::nullopt};
+    std::unique_lock lock{waitersGuard_};
+    if (outputClosed_)
+        return std::nullopt;
+    waiters_.push_back(&waiter);
+    lineArrived_.wait_for(lock, timeout, [&]() {
+        return waiter.line || outputClosed_;
+    });
+    waiters_.erase(std::find(waiters_.begin(), waiters_.end(), &waiter));
+    return std::move(waiter.line);
+}
+void Minecraft::readOutput()
+{
+    std::string line;
+    while (std::getline(output_, line))
     {
-        std::getline(std::cin, line);
-    } while (line != "/stop");
-}
\ No newline at end of file
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (echoOutput_)
+            std::cout << line << std::endl;
+        if (onOutput_)
+            onOutput_(line);
+
+        std::scoped_lock lock{waitersGuard_};
+        for (auto* waiter : waiters_)
+        {
+            if (!waiter->line && waiter->matcher(line))
+                waiter->line = line;
+        }
+        lineArrived_.notify_all();
+    }
+
+    std::scoped_lock lock{waitersGuard_};
+    outputClosed_ = true;
+    lineArrived_.notify_all();
+}
+void Minecraft::readErrors()
+{
+    std::string line;
+    while (std::getline(errors_, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (echoOutput_)
+            std::cerr << line << std::endl;
+        if (onOutput_)
+            onOutput_(line);
+    }
+}
@@ -0,0 +1,267 @@
+#include <update_server/mod_generations.hpp>
+#include <update_server/sha256.hpp>
+
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+    constexpr int manifestFormatVersion = 1;
+    constexpr char const* partialSuffix = ".partial";
+
+    std::optional<std::uint64_t> parseGeneration(std::string const& name)
+    {
+        if (name.empty() || !std::all_of(name.begin(), name.end(), [](char c) {
+                return c >= '0' && c <= '9';
+            }))
+        {
+            return std::nullopt;
+        }
+        return std::stoull(name);
+    }
+}
+
+// #####################################################################################################################
+ModGenerations::ModGenerations(std::filesystem::path directory)
+    : guard_{}
+    , directory_{std::move(directory)}
+    , generations_{}
+    , current_{}
+{}
+//---------------------------------------------------------------------------------------------------------------------
+void ModGenerations::load()
+{
+    std::scoped_lock lock{guard_};
+    generations_.clear();
+    current_.reset();
+    std::filesystem::create_directories(directory_);
+
+    const auto leasedUntil = std::chrono::steady_clock::now() + leaseDuration;
+    std::vector<std::filesystem::path> unfinished;
+    for (auto const& entry : std::filesystem::directory_iterator{directory_})
+    {
+        const auto generation = parseGeneration(entry.path().stem().string());
+        if (entry.is_directory() && generation && !entry.path().has_extension())
+        {
+            std::ifstream reader{manifestFile(*generation), std::ios_base::binary};
+            const auto manifest = nlohmann::json::parse(reader, nullptr, false);
+            if (!manifest.is_discarded() && manifest.is_object() &&
+                manifest.value("version", 0) == manifestFormatVersion)
+            {
+                std::vector<ModAndHash> mods;
+                for (auto const& [name, sha256] : manifest.at("mods").items())
+                    mods.push_back({.path = entry.path() / name, .sha256 = sha256.get<std::string>()});
+                generations_[*generation] =
+                    Generation{.directory = entry.path(), .mods = ModIndex{mods}, .leasedUntil = leasedUntil};
+                continue;
+            }
+            unfinished.push_back(manifestFile(*generation));
+        }
+        // Manifests are only looked at through their directory.
+        if (!entry.is_directory() && generation && std::filesystem::is_directory(generationDirectory(*generation)))
+            continue;
+        unfinished.push_back(entry.path());
+    }
+
+    for (auto const& path : unfinished)
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::filesystem::path ModGenerations::publish(std::uint64_t generation, std::vector<ModAndHash> const& mods)
+{
+    const auto target = generationDirectory(generation);
+    ModIndex index{mods};
+    // Jars the earlier generations already have by content, hard linking them costs neither space nor I/O.
+    std::unordered_map<std::string, std::filesystem::path> known;
+    {
+        std::scoped_lock lock{guard_};
+        if (const auto existing = generations_.find(generation); existing != generations_.end())
+        {
+            if (existing->second.mods.fingerprint() == index.fingerprint())
+            {
+                current_ = generation;
+                return existing->second.directory;
+            }
+            // Clients may have pinned it, other jars under the same number would fail their hash checks.
+            throw std::runtime_error(
+                "Mods generation " + std::to_string(generation) + " already exists with other mods");
+        }
+        for (auto const& [number, earlier] : generations_)
+        {
+            for (auto const& mod : earlier.mods.entries())
+                known.emplace(mod.sha256, earlier.directory / mod.path);
+        }
+    }
+
+    const auto partial = std::filesystem::path{target.string() + partialSuffix};
+    std::filesystem::remove_all(partial);
+    std::filesystem::create_directories(partial);
+    const auto started = std::chrono::steady_clock::now();
+    std::size_t copied = 0;
+    std::uintmax_t copiedBytes = 0;
+    for (auto const& mod : mods)
+    {
+        const auto file = partial / mod.path.filename();
+        if (const auto it = known.find(mod.sha256); it != known.end())
+        {
+            std::error_code ec;
+            std::filesystem::create_hard_link(it->second, file, ec);
+            if (!ec)
+                continue;
+        }
+        std::filesystem::copy_file(mod.path, file, std::filesystem::copy_options::overwrite_existing);
+        // Overwritten in place since it was hashed, the rescan that follows publishes the new version.
+        if (sha256FromFile(file) != mod.sha256)
+            throw std::runtime_error(mod.path.filename().string() + " changed while it was published");
+        ++copied;
+        copiedBytes += std::filesystem::file_size(file);
+    }
+
+    std::filesystem::remove_all(target);
+    std::filesystem::rename(partial, target);
+    {
+        auto manifestMods = nlohmann::json::object();
+        for (auto const& mod : index.entries())
+            manifestMods[mod.path.string()] = mod.sha256;
+        const auto temporary = std::filesystem::path{manifestFile(generation).string() + ".tmp"};
+        {
+            std::ofstream writer{temporary, std::ios_base::binary};
+            writer << nlohmann::json{{"version", manifestFormatVersion}, {"mods", std::move(manifestMods)}}.dump();
+            if (!writer.good())
+                throw std::runtime_error("Could not write " + temporary.string());
+        }
+        std::filesystem::rename(temporary, manifestFile(generation));
+    }
+
+    {
+        std::scoped_lock lock{guard_};
+        const auto leasedUntil = std::chrono::steady_clock::now() + leaseDuration;
+        // Clients that diffed against the previous generation right before the switch have not pinned it yet.
+        if (current_)
+        {
+            if (const auto previous = generations_.find(*current_); previous != generations_.end())
+                previous->second.leasedUntil = std::max(previous->second.leasedUntil, leasedUntil);
+        }
+        generations_[generation] = Generation{.directory = target, .mods = std::move(index), .leasedUntil = {}};
+        current_ = generation;
+    }
+    // Without an earlier generation, after the first start or once all were collected, every jar is copied.
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started);
+    std::cout << fmt::format(
+        "Mods generation {} copied {} of {} mods ({:.1f} MiB in {:.1f} s), the rest is linked.\n",
+        generation,
+        copied,
+        mods.size(),
+        static_cast<double>(copiedBytes) / (1024 * 1024),
+        elapsed.count());
+    collect();
+    return target;
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::uint64_t ModGenerations::nextGeneration(std::uint64_t wanted, std::vector<ModAndHash> const& mods) const
+{
+    std::scoped_lock lock{guard_};
+    if (generations_.empty())
+        return wanted;
+    const auto& [newest, generation] = *generations_.rbegin();
+    if (wanted > newest || (wanted == newest && generation.mods.fingerprint() == ModIndex{mods}.fingerprint()))
+        return wanted;
+    return newest + 1;
+}
+//---------------------------------------------------------------------------------------------------------------------
+bool ModGenerations::pin(std::uint64_t generation)
+{
+    {
+        std::scoped_lock lock{guard_};
+        const auto it = generations_.find(generation);
+        if (it == generations_.end())
+            return false;
+        it->second.leasedUntil = std::max(it->second.leasedUntil, std::chrono::steady_clock::now() + leaseDuration);
+    }
+    collect();
+    return true;
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::optional<ModAndHash> ModGenerations::find(std::uint64_t generation, std::string const& name) const
+{
+    std::scoped_lock lock{guard_};
+    const auto it = generations_.find(generation);
+    if (it == generations_.end())
+        return std::nullopt;
+    auto const* sha256 = it->second.mods.find(name);
+    if (sha256 == nullptr)
+        return std::nullopt;
+    return ModAndHash{.path = it->second.directory / name, .sha256 = *sha256};
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::optional<ModAndHash> ModGenerations::findByHash(std::uint64_t generation, std::string const& sha256) const
+{
+    std::scoped_lock lock{guard_};
+    const auto it = generations_.find(generation);
+    if (it == generations_.end())
+        return std::nullopt;
+    auto const* name = it->second.mods.nameOf(sha256);
+    if (name == nullptr)
+        return std::nullopt;
+    return ModAndHash{.path = it->second.directory / *name, .sha256 = sha256};
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::size_t ModGenerations::retained() const
+{
+    std::scoped_lock lock{guard_};
+    return generations_.size();
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::filesystem::path ModGenerations::generationDirectory(std::uint64_t generation) const
+{
+    return directory_ / std::to_string(generation);
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::filesystem::path ModGenerations::manifestFile(std::uint64_t generation) const
+{
+    return directory_ / (std::to_string(generation) + ".json");
+}
+//---------------------------------------------------------------------------------------------------------------------
+void ModGenerations::collect()
+{
+    std::vector<std::uint64_t> expired;
+    {
+        std::scoped_lock lock{guard_};
+        const auto now = std::chrono::steady_clock::now();
+        for (auto it = generations_.begin(); it != generations_.end();)
+        {
+            if (it->first != current_ && it->second.leasedUntil < now)
+            {
+                expired.push_back(it->first);
+                it = generations_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    // Transfers that are still running keep their open files, only new requests for the generation are refused.
+    for (auto generation : expired)
+    {
+        std::error_code ec;
+        // The manifest first, a directory that could only be removed in part counts as unfinished on the next load.
+        std::filesystem::remove(manifestFile(generation), ec);
+        std::filesystem::remove_all(generationDirectory(generation), ec);
+        if (ec)
+            std::cout << "Could not remove mods generation " << generation << ": " << ec.message() << "\n";
+        else
+            std::cout << "Removed mods generation " << generation << ", no client uses it anymore.\n";
+    }
+}
+// #####################################################################################################################
@@ -0,0 +1,398 @@
+#include <update_server/delta.hpp>
+#include <update_server/mod_history.hpp>
+#include <update_server/hashing.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string_view>
+#include <thread>
+
+namespace
+{
+    constexpr int indexFormatVersion = 1;
+    constexpr char const* indexFileName = "index.json";
+    constexpr char const* patchDirName = "patches";
+
+    std::int64_t millisecondsSinceEpoch()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+
+    bool isSha256(std::string const& hash)
+    {
+        return hash.size() == 64 && std::all_of(hash.begin(), hash.end(), [](char c) {
+                   return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+               });
+    }
+}
+
+// #####################################################################################################################
+std::string modStem(std::string const& fileName)
+{
+    auto stem = std::filesystem::path{fileName}.stem().string();
+    std::transform(stem.begin(), stem.end(), stem.begin(), [](char c) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    });
+
+    // The version starts at the first separator followed by a number, "mc1.20" or "v1.2".
+    for (std::size_t i = 1; i < stem.size(); ++i)
+    {
+        if (stem[i - 1] != '-' && stem[i - 1] != '_' && stem[i - 1] != '+')
+            continue;
+        auto rest = std::string_view{stem}.substr(i);
+        if (rest.starts_with("mc"))
+            rest.remove_prefix(2);
+        else if (rest.starts_with("v"))
+            rest.remove_prefix(1);
+        if (!rest.empty() && std::isdigit(static_cast<unsigned char>(rest.front())))
+            return stem.substr(0, i - 1);
+    }
+    return stem;
+}
+// #####################################################################################################################
+ModHistory::ModHistory(std::filesystem::path directory, std::size_t versionsKept)
+    : guard_{}
+    , directory_{std::move(directory)}
+    , versionsKept_{versionsKept}
+    , versions_{}
+    , rejectedPatches_{}
+    , wantedPatches_{}
+    , readyPatches_{}
+    , queue_{}
+    , wake_{}
+    , stop_{false}
+    , builder_{}
+{
+    builder_ = std::thread{[this]() {
+        buildPatches();
+    }};
+}
+//---------------------------------------------------------------------------------------------------------------------
+ModHistory::~ModHistory()
+{
+    {
+        std::scoped_lock lock{guard_};
+        stop_ = true;
+    }
+    wake_.notify_one();
+    builder_.join();
+}
+//---------------------------------------------------------------------------------------------------------------------
+void ModHistory::load()
+{
+    std::scoped_lock lock{guard_};
+    versions_.clear();
+    std::filesystem::create_directories(directory_ / patchDirName);
+
+    std::ifstream reader{directory_ / indexFileName, std::ios_base::binary};
+    if (!reader.good())
+        return;
+
+    const auto index = nlohmann::json::parse(reader, nullptr, false);
+    if (index.is_discarded() || !index.is_object() || index.value("version", 0) != indexFormatVersion)
+    {
+        std::cout << "Ignoring unreadable mod history index in " << directory_.string() << "\n";
+        return;
+    }
+    for (auto const& [sha256, version] : index.at("versions").items())
+    {
+        if (!std::filesystem::exists(versionFile(sha256)))
+            continue;
+        versions_[sha256] = Version{
+            .name = version.at("name").get<std::string>(),
+            .recorded = version.at("recorded").get<std::int64_t>(),
+        };
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+void ModHistory::record(std::vector<ModAndHash> const& mods)
+{
+    std::scoped_lock lock{guard_};
+    bool changed = false;
+    std::unordered_set<std::string> current;
+    // Strictly increasing, so versions of consecutive scans never tie when the oldest are dropped.
+    auto now = millisecondsSinceEpoch();
+    for (auto const& [sha256, version] : versions_)
+        now = std::max(now, version.recorded + 1);
+
+    for (auto const& mod : mods)
+    {
+        current.insert(mod.sha256);
+        if (versions_.contains(mod.sha256))
+            continue;
+
+        // A hard link costs no space while the jar is in the mods folder. Replacing the jar later unlinks it there,
+        // the history keeps the old version.
+        const auto target = versionFile(mod.sha256);
+        std::error_code ec;
+        std::filesystem::create_hard_link(mod.path, target, ec);
+        if (ec)
+            std::filesystem::copy_file(mod.path, target, std::filesystem::copy_options::overwrite_existing, ec);
+        if (ec)
+        {
+            std::cout << "Could not add " << mod.path.filename().string() << " to the mod history: " << ec.message()
+                      << "\n";
+            continue;
+        }
+        versions_[mod.sha256] = Version{.name = mod.path.filename().string(), .recorded = now};
+        changed = true;
+    }
+
+    std::map<std::string, std::vector<std::pair<std::int64_t, std::string>>> olderVersions;
+    for (auto const& [sha256, version] : versions_)
+    {
+        if (!current.contains(sha256))
+            olderVersions[modStem(version.name)].emplace_back(version.recorded, sha256);
+    }
+    for (auto& [stem, versions] : olderVersions)
+    {
+        if (versions.size() <= versionsKept_)
+            continue;
+        std::sort(versions.begin(), versions.end(), std::greater<>{});
+        for (auto it = versions.begin() + static_cast<std::ptrdiff_t>(versionsKept_); it != versions.end(); ++it)
+            forget(it->second);
+        changed = true;
+    }
+
+    if (changed)
+        save();
+
+    // Only from the older versions of a mod to its current one, a handful per mod however many clients ask.
+    std::unordered_map<std::string, std::vector<std::string>> versionsByStem;
+    for (auto const& [sha256, version] : versions_)
+        versionsByStem[modStem(version.name)].push_back(sha256);
+    std::unordered_set<std::string> wanted;
+    bool queued = false;
+    for (auto const& mod : mods)
+    {
+        if (!versions_.contains(mod.sha256))
+            continue;
+        for (auto const& from : versionsByStem[modStem(mod.path.filename().string())])
+        {
+            const auto key = patchKey(from, mod.sha256);
+            if (from == mod.sha256 || !wanted.insert(key).second || wantedPatches_.contains(key) ||
+                rejectedPatches_.contains(key))
+            {
+                continue;
+            }
+            if (std::filesystem::exists(patchFile(from, mod.sha256)))
+            {
+                readyPatches_.insert(key);
+                continue;
+            }
+            queue_.emplace_back(from, mod.sha256);
+            queued = true;
+        }
+    }
+    wantedPatches_ = std::move(wanted);
+    for (auto it = readyPatches_.begin(); it != readyPatches_.end();)
+    {
+        if (wantedPatches_.contains(*it))
+        {
+            ++it;
+            continue;
+        }
+        std::error_code ec;
+        std::filesystem::remove(directory_ / patchDirName / (*it + ".zst"), ec);
+        it = readyPatches_.erase(it);
+    }
+    if (queued)
+        wake_.notify_one();
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::vector<ModPatch> ModHistory::patchesFor(
+    std::vector<std::string> const& downloads,
+    std::vector<ModAndHash> const& clientMods,
+    ModIndex const& mods) const
+{
+    std::unordered_map<std::string, std::vector<ModAndHash const*>> clientByStem;
+    for (auto const& mod : clientMods)
+        clientByStem[modStem(mod.path.string())].push_back(&mod);
+
+    std::scoped_lock lock{guard_};
+    std::vector<ModPatch> patches;
+    for (auto const& download : downloads)
+    {
+        auto const* sha256 = mods.find(download);
+        const auto candidates = clientByStem.find(modStem(download));
+        if (sha256 == nullptr || candidates == clientByStem.end())
+            continue;
+
+        for (auto const* candidate : candidates->second)
+        {
+            const auto key = patchKey(candidate->sha256, *sha256);
+            if (!wantedPatches_.contains(key) || rejectedPatches_.contains(key))
+                continue;
+            patches.push_back(ModPatch{
+                .name = download,
+                .sha256 = *sha256,
+                .from = candidate->path.string(),
+                .fromSha256 = candidate->sha256,
+            });
+            break;
+        }
+    }
+    return patches;
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::optional<std::filesystem::path> ModHistory::patch(std::string const& fromSha256, std::string const& toSha256) const
+{
+    if (!isSha256(fromSha256) || !isSha256(toSha256))
+        return std::nullopt;
+    std::scoped_lock lock{guard_};
+    if (!readyPatches_.contains(patchKey(fromSha256, toSha256)))
+        return std::nullopt;
+    return patchFile(fromSha256, toSha256);
+}
+//---------------------------------------------------------------------------------------------------------------------
+void ModHistory::buildPatches()
+{
+    while (true)
+    {
+        std::pair<std::string, std::string> next;
+        {
+            std::unique_lock lock{guard_};
+            wake_.wait(lock, [this]() {
+                return stop_ || !queue_.empty();
+            });
+            if (stop_)
+                return;
+            next = std::move(queue_.front());
+            queue_.pop_front();
+            // A later scan may have dropped the pair or queued it a second time.
+            const auto key = patchKey(next.first, next.second);
+            if (!wantedPatches_.contains(key) || readyPatches_.contains(key))
+                continue;
+        }
+
+        auto const& [fromSha256, toSha256] = next;
+        bool built = false;
+        try
+        {
+            built = buildPatch(fromSha256, toSha256);
+        }
+        catch (std::exception const& e)
+        {
+            std::cout << "Could not create patch: " << e.what() << "\n";
+        }
+
+        std::scoped_lock lock{guard_};
+        const auto key = patchKey(fromSha256, toSha256);
+        if (!built)
+            rejectedPatches_.insert(key);
+        else if (wantedPatches_.contains(key) && versions_.contains(fromSha256) && versions_.contains(toSha256))
+            readyPatches_.insert(key);
+        else
+        {
+            std::error_code ec;
+            std::filesystem::remove(patchFile(fromSha256, toSha256), ec);
+        }
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+bool ModHistory::buildPatch(std::string const& fromSha256, std::string const& toSha256)
+{
+    // Read without the lock, so scans and requests go on while a large jar is diffed.
+    std::string reference;
+    std::string target;
+    try
+    {
+        reference = Delta::readFile(versionFile(fromSha256));
+        target = Delta::readFile(versionFile(toSha256));
+    }
+    catch (std::exception const& e)
+    {
+        std::cout << "Cannot patch: " << e.what() << "\n";
+        return false;
+    }
+
+    // A jar that was overwritten in place also changed its hard link in the history.
+    Hashing::MultiDigest digest{Hashing::Sha256};
+    digest.update(reference.data(), reference.size());
+    if (digest.finish().sha256 != fromSha256)
+    {
+        std::scoped_lock lock{guard_};
+        forget(fromSha256);
+        save();
+        return false;
+    }
+
+    const auto file = patchFile(fromSha256, toSha256);
+    const auto patch = Delta::create(reference, target);
+    if (patch.size() > target.size() / 10 * 9)
+        return false;
+
+    const auto temporary = std::filesystem::path{file.string() + ".tmp"};
+    {
+        std::ofstream writer{temporary, std::ios_base::binary};
+        writer.write(patch.data(), static_cast<std::streamsize>(patch.size()));
+        if (!writer.good())
+            return false;
+    }
+    std::filesystem::rename(temporary, file);
+    std::cout << "Created patch " << file.filename().string() << ": " << patch.size() << " instead of "
+              << target.size() << " bytes\n";
+    return true;
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::filesystem::path ModHistory::versionFile(std::string const& sha256) const
+{
+    return directory_ / (sha256 + ".jar");
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::filesystem::path ModHistory::patchFile(std::string const& fromSha256, std::string const& toSha256) const
+{
+    return directory_ / patchDirName / (patchKey(fromSha256, toSha256) + ".zst");
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::string ModHistory::patchKey(std::string const& fromSha256, std::string const& toSha256)
+{
+    return fromSha256 + "-" + toSha256;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void ModHistory::forget(std::string const& sha256)
+{
+    std::error_code ec;
+    versions_.erase(sha256);
+    std::filesystem::remove(versionFile(sha256), ec);
+    std::erase_if(readyPatches_, [&sha256](std::string const& key) {
+        return key.find(sha256) != std::string::npos;
+    });
+    for (std::filesystem::directory_iterator patches{directory_ / patchDirName, ec}, end; !ec && patches != end;
+         patches.increment(ec))
+    {
+        const auto name = patches->path().filename().string();
+        if (name.find(sha256) != std::string::npos)
+            std::filesystem::remove(patches->path(), ec);
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+void ModHistory::save() const
+{
+    auto versions = nlohmann::json::object();
+    for (auto const& [sha256, version] : versions_)
+        versions[sha256] = {{"name", version.name}, {"recorded", version.recorded}};
+
+    const auto indexFile = directory_ / indexFileName;
+    const auto temporary = std::filesystem::path{indexFile.string() + ".tmp"};
+    {
+        std::ofstream writer{temporary, std::ios_base::binary};
+        if (!writer.good())
+        {
+            std::cout << "Could not write mod history index: " << temporary.string() << "\n";
+            return;
+        }
+        writer << nlohmann::json{{"version", indexFormatVersion}, {"versions", versions}}.dump();
+    }
+    std::filesystem::rename(temporary, indexFile);
+}
+// #####################################################################################################################
@@ -0,0 +1,101 @@
+#include <update_server/hashing.hpp>
+#include <update_server/mod_index.hpp>
+
+#include <algorithm>
+#include <unordered_set>
+
+// #####################################################################################################################
+ModIndex::ModIndex(std::vector<ModAndHash> const& mods)
+    : names_{}
+    , hashes_{}
+    , namesByHash_{}
+{
+    names_.reserve(mods.size());
+    hashes_.reserve(mods.size());
+    for (auto const& mod : mods)
+    {
+        auto name = mod.path.filename().string();
+        if (!hashes_.emplace(name, mod.sha256).second)
+            continue;
+        namesByHash_.emplace(mod.sha256, name);
+        names_.push_back(std::move(name));
+    }
+    std::sort(names_.begin(), names_.end());
+}
+//---------------------------------------------------------------------------------------------------------------------
+UpdateInstructions ModIndex::difference(std::vector<ModAndHash> const& remoteFiles) const
+{
+    UpdateInstructions instructions;
+    std::vector<std::string> changed;
+    std::unordered_set<std::string> seen;
+    seen.reserve(remoteFiles.size());
+
+    for (auto const& remote : remoteFiles)
+    {
+        auto name = remote.path.string();
+        const auto it = hashes_.find(name);
+        if (!seen.insert(name).second)
+            continue;
+
+        if (it == hashes_.end())
+            instructions.remove.push_back(std::move(name));
+        else if (!remote.sha256.empty() && it->second != remote.sha256)
+            changed.push_back(std::move(name));
+    }
+
+    for (auto const& name : names_)
+    {
+        if (!seen.contains(name))
+            instructions.download.push_back(name);
+    }
+
+    instructions.download.insert(instructions.download.end(), changed.begin(), changed.end());
+    instructions.remove.insert(instructions.remove.end(), changed.begin(), changed.end());
+    return instructions;
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::string const* ModIndex::find(std::string const& name) const
+{
+    const auto it = hashes_.find(name);
+    if (it == hashes_.end())
+        return nullptr;
+    return &it->second;
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::string const* ModIndex::nameOf(std::string const& sha256) const
+{
+    const auto it = namesByHash_.find(sha256);
+    if (it == namesByHash_.end())
+        return nullptr;
+    return &it->second;
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::vector<std::string> const& ModIndex::names() const
+{
+    return names_;
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::vector<ModAndHash> ModIndex::entries() const
+{
+    std::vector<ModAndHash> entries;
+    entries.reserve(names_.size());
+    for (auto const& name : names_)
+        entries.push_back({.path = name, .sha256 = hashes_.at(name)});
+    return entries;
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::string ModIndex::fingerprint() const
+{
+    Hashing::MultiDigest digest{Hashing::Sha256};
+    for (auto const& name : names_)
+    {
+        auto const& hash = hashes_.at(name);
+        // NUL cannot be part of a file name and hashes have a fixed length, so the encoding is unambiguous.
+        digest.update(name.data(), name.size());
+        digest.update("\0", 1);
+        digest.update(hash.data(), hash.size());
+        digest.update("\n", 1);
+    }
+    return digest.finish().sha256;
+}
+// #####################################################################################################################
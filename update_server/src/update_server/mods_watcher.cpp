@@ -0,0 +1,140 @@
+#include <update_server/mods_watcher.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+#ifdef __linux__
+#    include <poll.h>
+#    include <sys/inotify.h>
+#    include <unistd.h>
+#endif
+
+namespace
+{
+    // Events arriving within this time are folded into one change notification.
+    constexpr int settleMilliseconds = 250;
+    constexpr int stopPollMilliseconds = 500;
+#ifdef __linux__
+    constexpr std::uint32_t watchedEvents = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE |
+        IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF;
+#endif
+}
+
+// #####################################################################################################################
+ModsWatcher::ModsWatcher(
+    std::filesystem::path directory,
+    std::function<void()> onChange,
+    std::vector<std::string> names)
+    : directory_{std::move(directory)}
+    , onChange_{std::move(onChange)}
+    , names_{std::move(names)}
+    , inotifyFd_{-1}
+    , watchDescriptor_{-1}
+    , rewatchRequested_{false}
+    , stop_{false}
+    , thread_{}
+{
+#ifdef __linux__
+    inotifyFd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd_ < 0)
+    {
+        std::cout << "Could not initialize inotify, mods are rescanned on every request.\n";
+        return;
+    }
+    watchDescriptor_ = ::inotify_add_watch(inotifyFd_, directory_.string().c_str(), watchedEvents);
+    if (watchDescriptor_ < 0)
+    {
+        std::cout << "Could not watch " << directory_.string() << ", mods are rescanned on every request.\n";
+        ::close(inotifyFd_);
+        inotifyFd_ = -1;
+        return;
+    }
+    thread_ = std::thread{[this]() {
+        run();
+    }};
+#endif
+}
+//---------------------------------------------------------------------------------------------------------------------
+ModsWatcher::~ModsWatcher()
+{
+    stop_ = true;
+    if (thread_.joinable())
+        thread_.join();
+#ifdef __linux__
+    if (inotifyFd_ >= 0)
+        ::close(inotifyFd_);
+#endif
+}
+//---------------------------------------------------------------------------------------------------------------------
+bool ModsWatcher::watching() const
+{
+    return thread_.joinable() && watchDescriptor_ >= 0;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void ModsWatcher::rewatch()
+{
+    rewatchRequested_ = true;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void ModsWatcher::run()
+{
+#ifdef __linux__
+    alignas(inotify_event) char buffer[4096];
+    bool pending = false;
+    while (!stop_)
+    {
+        if (rewatchRequested_.exchange(false) && watchDescriptor_ >= 0)
+        {
+            ::inotify_rm_watch(inotifyFd_, watchDescriptor_);
+            watchDescriptor_ = -1;
+        }
+        if (watchDescriptor_ < 0)
+        {
+            // Retried every poll until the directory is back.
+            watchDescriptor_ = ::inotify_add_watch(inotifyFd_, directory_.string().c_str(), watchedEvents);
+            if (watchDescriptor_ >= 0)
+                pending = true;
+        }
+
+        pollfd descriptor{.fd = inotifyFd_, .events = POLLIN, .revents = 0};
+        const auto ready = ::poll(&descriptor, 1, pending ? settleMilliseconds : stopPollMilliseconds);
+        if (ready > 0)
+        {
+            // Only events about the directory itself matter, any other just means something changed.
+            bool lost = false;
+            bool changed = false;
+            for (ssize_t length; (length = ::read(inotifyFd_, buffer, sizeof(buffer))) > 0;)
+            {
+                for (char const* at = buffer; at < buffer + length;)
+                {
+                    auto const* event = reinterpret_cast<inotify_event const*>(at);
+                    const bool named =
+                        event->len != 0 && std::find(names_.begin(), names_.end(), event->name) != names_.end();
+                    if (event->wd == watchDescriptor_ && (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)))
+                        lost = true;
+                    else if (names_.empty() || named)
+                        changed = true;
+                    at += sizeof(inotify_event) + event->len;
+                }
+            }
+            if (lost)
+            {
+                // A moved directory keeps its watch, which would now report changes of the wrong folder.
+                ::inotify_rm_watch(inotifyFd_, watchDescriptor_);
+                watchDescriptor_ = -1;
+                std::cout << "Lost the watch on " << directory_.string()
+                          << ", mods are rescanned on every request until it is back.\n";
+            }
+            pending = pending || lost || changed;
+            continue;
+        }
+        if (ready == 0 && pending)
+        {
+            pending = false;
+            onChange_();
+        }
+    }
+#endif
+}
+// #####################################################################################################################
@@ -0,0 +1,102 @@
+#include <update_server/rate_limiter.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+    /// Unused tokens are kept for this long, so short pauses of one thread do not waste the budget of the others.
+    constexpr double burstSeconds = 0.25;
+    constexpr double recoveryFactor = 1.5;
+
+    double mebibytes(double bytes)
+    {
+        return bytes / (1024 * 1024);
+    }
+}
+
+// #####################################################################################################################
+RateLimiter::RateLimiter(std::uint64_t bytesPerSecond)
+    : guard_{}
+    , cap_{static_cast<double>(bytesPerSecond)}
+    , rate_{static_cast<double>(bytesPerSecond)}
+    , tokens_{0}
+    , lastRefill_{Clock::now()}
+    , lastChange_{Clock::time_point{}}
+    , transferred_{0}
+    , firstAcquire_{Clock::time_point{}}
+    , uncappedAt_{0}
+{}
+//---------------------------------------------------------------------------------------------------------------------
+void RateLimiter::acquire(std::uint64_t bytes)
+{
+    std::chrono::duration<double> wait{0};
+    {
+        std::scoped_lock lock{guard_};
+        const auto now = Clock::now();
+        if (transferred_ == 0)
+            firstAcquire_ = now;
+        transferred_ += bytes;
+        refill(now);
+        if (rate_ == 0)
+            return;
+
+        // Taken right away, a deficit is slept off. Threads that come later queue behind the deficit.
+        tokens_ -= static_cast<double>(bytes);
+        if (tokens_ < 0)
+            wait = std::chrono::duration<double>(-tokens_ / rate_);
+    }
+    if (wait.count() > 0)
+        std::this_thread::sleep_for(wait);
+}
+//---------------------------------------------------------------------------------------------------------------------
+void RateLimiter::slowDown()
+{
+    std::scoped_lock lock{guard_};
+    const auto now = Clock::now();
+    if (now - lastChange_ < slowDownInterval)
+        return;
+    refill(now);
+
+    auto current = rate_;
+    if (current == 0)
+    {
+        // Uncapped, so the rate so far is the one that caused the lag.
+        const auto seconds = std::chrono::duration<double>(now - firstAcquire_).count();
+        current = seconds > 0 && transferred_ != 0 ? static_cast<double>(transferred_) / seconds : minimumRate * 2;
+        uncappedAt_ = current;
+    }
+    rate_ = std::max(minimumRate, current / 2);
+    tokens_ = std::min(tokens_, 0.0);
+    lastChange_ = now;
+    std::cout << "The game server is lagging, backup I/O slowed down to " << mebibytes(rate_) << " MiB/s\n";
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::uint64_t RateLimiter::currentRate() const
+{
+    std::scoped_lock lock{guard_};
+    return static_cast<std::uint64_t>(rate_);
+}
+//---------------------------------------------------------------------------------------------------------------------
+void RateLimiter::refill(Clock::time_point now)
+{
+    if (rate_ != 0 && lastChange_ != Clock::time_point{} && now - lastChange_ >= recoveryInterval)
+    {
+        rate_ *= recoveryFactor;
+        lastChange_ = now;
+        // Back at the cap, or back at the rate that was fine before an uncapped backup had to slow down.
+        if (cap_ != 0 && rate_ >= cap_)
+            rate_ = cap_;
+        else if (cap_ == 0 && rate_ >= uncappedAt_)
+            rate_ = 0;
+        if (rate_ == cap_)
+            lastChange_ = Clock::time_point{};
+    }
+
+    const std::chrono::duration<double> elapsed = now - lastRefill_;
+    lastRefill_ = now;
+    if (rate_ != 0)
+        tokens_ = std::min(tokens_ + elapsed.count() * rate_, rate_ * burstSeconds);
+}
+// #####################################################################################################################
@@ -0,0 +1,239 @@
+#include <update_server/console_line.hpp>
+#include <update_server/server_telemetry.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#ifdef __linux__
+#    include <unistd.h>
+#endif
+
+namespace
+{
+    std::int64_t millisecondsSinceEpoch()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+    }
+
+    /**
+     * @brief The number that directly follows prefix in the line, if there is one.
+     */
+    template <typename T>
+    std::optional<T> numberAfter(std::string_view line, std::string_view prefix)
+    {
+        const auto at = line.find(prefix);
+        if (at == std::string_view::npos)
+            return std::nullopt;
+        line.remove_prefix(at + prefix.size());
+        T value{};
+        const auto [end, error] = std::from_chars(line.data(), line.data() + line.size(), value);
+        if (error != std::errc{})
+            return std::nullopt;
+        return value;
+    }
+
+    template <typename T>
+    void pushBounded(std::deque<T>& ring, T value, std::size_t capacity)
+    {
+        ring.push_back(std::move(value));
+        if (ring.size() > capacity)
+            ring.pop_front();
+    }
+}
+
+// #####################################################################################################################
+ServerTelemetry::ServerTelemetry()
+    : guard_{}
+    , output_{}
+    , saveStarted_{}
+    , saving_{false}
+    , metrics_{}
+    , recentLag_{}
+    , samples_{}
+    , generations_{}
+    , generation_{0}
+    , onLag_{}
+    , stopRequested_{}
+    , stop_{false}
+    , sampler_{}
+{}
+//---------------------------------------------------------------------------------------------------------------------
+ServerTelemetry::~ServerTelemetry()
+{
+    {
+        std::scoped_lock lock{guard_};
+        stop_ = true;
+    }
+    stopRequested_.notify_all();
+    if (sampler_.joinable())
+        sampler_.join();
+}
+//---------------------------------------------------------------------------------------------------------------------
+void ServerTelemetry::onOutput(std::string_view line)
+{
+    std::scoped_lock lock{guard_};
+    pushBounded(output_, std::string{line}, outputLinesKept);
+
+    // Chat is logged by the server thread too, but its messages start with the name of the player.
+    const auto warning = serverMessage(line, "WARN");
+    const auto info = serverMessage(line, "INFO");
+    // "Can't keep up! Is the server overloaded? Running 2345ms or 46 ticks behind"
+    if (warning && warning->starts_with("Can't keep up!"))
+    {
+        const LagWarning lag{
+            .time = millisecondsSinceEpoch(),
+            .millisecondsBehind = numberAfter<std::uint64_t>(*warning, "Running ").value_or(0),
+            .ticksBehind = numberAfter<std::uint64_t>(*warning, "ms or ").value_or(0),
+            .generation = generation_,
+        };
+        ++metrics_.lagWarnings;
+        metrics_.ticksBehind += lag.ticksBehind;
+        if (auto it = generations_.find(generation_); it != generations_.end())
+        {
+            ++it->second.lagWarnings;
+            it->second.ticksBehind += lag.ticksBehind;
+        }
+        pushBounded(recentLag_, lag, lagWarningsKept);
+        if (onLag_)
+            onLag_();
+        return;
+    }
+    if (!info)
+        return;
+
+    // "Done (12.345s)! For help, type "help""
+    if (const auto startup = numberAfter<double>(*info, "Done ("); info->starts_with("Done (") && startup &&
+             info->find(")! For help") != std::string_view::npos)
+    {
+        metrics_.startupSeconds = *startup;
+    }
+    // "Saving the game (this may take a moment!)"
+    else if (info->starts_with("Saving the game"))
+    {
+        saving_ = true;
+        saveStarted_ = std::chrono::steady_clock::now();
+    }
+    else if (*info == "Saved the game" && saving_)
+    {
+        saving_ = false;
+        const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - saveStarted_).count();
+        ++metrics_.saves;
+        metrics_.lastSaveSeconds = seconds;
+        metrics_.longestSaveSeconds = std::max(metrics_.longestSaveSeconds, seconds);
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+void ServerTelemetry::serverStarted(bool classDataSharing)
+{
+    std::scoped_lock lock{guard_};
+    metrics_.startupSeconds.reset();
+    metrics_.classDataSharing = classDataSharing;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void ServerTelemetry::setLagListener(std::function<void()> onLag)
+{
+    std::scoped_lock lock{guard_};
+    onLag_ = std::move(onLag);
+}
+//---------------------------------------------------------------------------------------------------------------------
+void ServerTelemetry::watchProcess(int processId)
+{
+#ifdef __linux__
+    std::scoped_lock lock{guard_};
+    if (sampler_.joinable())
+        return;
+    sampler_ = std::thread{[this, processId]() {
+        sampleProcess(processId);
+    }};
+#else
+    (void)processId;
+#endif
+}
+//---------------------------------------------------------------------------------------------------------------------
+void ServerTelemetry::modsPublished(std::uint64_t generation)
+{
+    std::scoped_lock lock{guard_};
+    generation_ = generation;
+    generations_.try_emplace(generation, GenerationLag{.generation = generation, .since = millisecondsSinceEpoch()});
+    while (generations_.size() > generationsKept)
+        generations_.erase(generations_.begin());
+}
+//---------------------------------------------------------------------------------------------------------------------
+ServerMetrics ServerTelemetry::metrics() const
+{
+    std::scoped_lock lock{guard_};
+    auto result = metrics_;
+    result.recentLag.assign(recentLag_.begin(), recentLag_.end());
+    result.samples.assign(samples_.begin(), samples_.end());
+    for (auto const& [generation, lag] : generations_)
+        result.generations.push_back(lag);
+    return result;
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::vector<std::string> ServerTelemetry::recentOutput() const
+{
+    std::scoped_lock lock{guard_};
+    return {output_.begin(), output_.end()};
+}
+//---------------------------------------------------------------------------------------------------------------------
+void ServerTelemetry::sampleProcess(int processId)
+{
+#ifdef __linux__
+    const auto procDirectory = "/proc/" + std::to_string(processId);
+    const auto ticksPerSecond = static_cast<double>(sysconf(_SC_CLK_TCK));
+    const auto pageSize = static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+
+    std::optional<std::pair<std::chrono::steady_clock::time_point, std::uint64_t>> previous;
+    std::unique_lock lock{guard_};
+    while (!stop_)
+    {
+        lock.unlock();
+        std::ifstream statReader{procDirectory + "/stat"};
+        std::ifstream statmReader{procDirectory + "/statm"};
+        std::string stat{std::istreambuf_iterator<char>{statReader}, std::istreambuf_iterator<char>{}};
+        std::uint64_t totalPages = 0;
+        std::uint64_t residentPages = 0;
+        statmReader >> totalPages >> residentPages;
+        const auto now = std::chrono::steady_clock::now();
+        lock.lock();
+        // Gone, or replaced by another process under the same id.
+        if (stat.empty() || !statmReader)
+            break;
+
+        // The name in parentheses may contain spaces, utime and stime are the 12th and 13th field after it.
+        std::istringstream fields{stat.substr(stat.rfind(')') + 2)};
+        std::string skipped;
+        for (int i = 0; i != 11; ++i)
+            fields >> skipped;
+        std::uint64_t userTicks = 0;
+        std::uint64_t systemTicks = 0;
+        fields >> userTicks >> systemTicks;
+
+        const auto cpuTicks = userTicks + systemTicks;
+        if (previous)
+        {
+            const auto seconds = std::chrono::duration<double>(now - previous->first).count();
+            pushBounded(
+                samples_,
+                ProcessSample{
+                    .time = millisecondsSinceEpoch(),
+                    .cpuPercent = static_cast<double>(cpuTicks - previous->second) / ticksPerSecond / seconds * 100,
+                    .residentBytes = residentPages * pageSize,
+                },
+                samplesKept);
+        }
+        previous.emplace(now, cpuTicks);
+        stopRequested_.wait_for(lock, sampleInterval, [this]() {
+            return stop_;
+        });
+    }
+#else
+    (void)processId;
+#endif
+}
+// #####################################################################################################################
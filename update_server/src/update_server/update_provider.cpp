@@ -1,59 +1,419 @@
+#include <update_server/console_line.hpp>
+#include <update_server/file_range_body.hpp>
+#include <update_server/hashing.hpp>
+#include <update_server/lag_monitor.hpp>
+#include <update_server/mod_history.hpp>
+#include <update_server/parallel_hasher.hpp>
+#include <update_server/tar_bundle_body.hpp>
+#include <update_server/tar_upload_body.hpp>
 #include <update_server/sha256.hpp>
 #include <update_server/update_provider.hpp>
 
 #include <boost/beast/http/file_body.hpp>
-#include <fmt/ranges.h>
+#include <fmt/format.h>
 #include <nlohmann/json.hpp>
+#include <openssl/crypto.h>
 #include <roar/url/encode.hpp>
+#include <roar/utility/scope_exit.hpp>
 
 #include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <iterator>
-#include <set>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <system_error>
+#include <thread>
+
+#ifdef __linux__
+#    include <fcntl.h>
+#endif
 
 using json = nlohmann::json;
 using namespace boost::beast::http;
 using namespace std::string_literals;
-using namespace std::chrono_literals;
+using namespace std::string_view_literals;
 
 namespace
 {
     constexpr char const* modsDirName = "mods";
+    constexpr char const* historyDirName = ".mod_history";
+    /// Sent by clients with every download, so all files of an update come from the generation they diffed against.
+    constexpr char const* generationHeader = "X-Mod-Generation";
+    constexpr char const* uploadDirName = "mods_upload";
+    constexpr char const* modsBackupDirName = "mods_backup";
+    constexpr char const* worldDirName = "world";
+    constexpr char const* logDirName = "logs";
+    constexpr char const* latestLogName = "latest.log";
+    constexpr char const* serverJarName = "server.jar";
+    constexpr char const* modrinthIndexName = "modrinth.index.json";
+    constexpr char const* versionsName = "versions.json";
+    constexpr std::chrono::seconds consoleTimeout{10};
+    /// save-all flush writes every loaded chunk, that takes a while on a large world.
+    constexpr std::chrono::seconds flushTimeout{120};
+    /// Archives run at night, a higher level than zstd's default is worth the time.
+    constexpr int archiveCompressionLevel = 9;
+    constexpr std::size_t maximumUploadSize = 8ull * 1024 * 1024 * 1024;
+    constexpr std::size_t historyVersionsKept = 3;
+    constexpr std::size_t cachedDifferences = 256;
+    /// A jar that is still being copied into the mods folder fails the first publish, it is done a moment later.
+    constexpr int startupPublishAttempts = 3;
+    constexpr std::chrono::seconds startupPublishDelay{2};
+    constexpr int unpublishedRetrySeconds = 30;
+
+    /**
+     * @brief Files that belong to the server directory but live beside it, so replacing the server directory keeps
+     * them.
+     */
+    std::filesystem::path besideServerDirectory(std::filesystem::path serverDirectory, std::string const& suffix)
+    {
+        serverDirectory = std::filesystem::absolute(serverDirectory).lexically_normal();
+        if (!serverDirectory.has_filename())
+            serverDirectory = serverDirectory.parent_path();
+        return serverDirectory.parent_path() / (serverDirectory.filename().string() + suffix);
+    }
+
+    std::filesystem::path hashCacheFile(std::filesystem::path const& serverDirectory)
+    {
+        return besideServerDirectory(serverDirectory, ".hashcache.json");
+    }
+
+    /**
+     * @brief Last published generation and its fingerprint, so generations keep increasing across restarts.
+     */
+    std::filesystem::path generationFile(std::filesystem::path const& serverDirectory)
+    {
+        return besideServerDirectory(serverDirectory, ".generation.json");
+    }
+
+    /**
+     * @brief Runs a backup job with a limiter of its own, which slows down whenever the game server cannot keep up.
+     *
+     * @param telemetry Reports the lag of a game server this process runs, as soon as it is printed. Without, the log
+     * of the game server is followed, which only sees lag once the logger flushed it.
+     */
+    template <typename FunctionT>
+    auto throttledByLag(
+        std::filesystem::path const& serverDirectory,
+        std::uint64_t bytesPerSecond,
+        ServerTelemetry* telemetry,
+        FunctionT&& job)
+    {
+        RateLimiter limiter{bytesPerSecond};
+        const auto slowDown = [&limiter]() {
+            limiter.slowDown();
+        };
+        std::optional<LagMonitor> lagMonitor;
+        if (telemetry != nullptr)
+            telemetry->setLagListener(slowDown);
+        else
+            lagMonitor.emplace(serverDirectory / logDirName / latestLogName, slowDown);
+        const auto stopListening = Roar::ScopeExit{[telemetry]() {
+            if (telemetry != nullptr)
+                telemetry->setLagListener({});
+        }};
+        return job(limiter);
+    }
+
+    json toJson(std::vector<ModPatch> const& patches)
+    {
+        auto result = json::array();
+        for (auto const& patch : patches)
+        {
+            result.push_back({
+                {"name", patch.name},
+                {"hash", patch.sha256},
+                {"from", patch.from},
+                {"fromHash", patch.fromSha256},
+            });
+        }
+        return result;
+    }
+
+    std::string_view headerValue(Roar::EmptyBodyRequest const& request, field name)
+    {
+        const auto value = request[name];
+        return {value.data(), value.size()};
+    }
+
+    std::string_view headerValue(Roar::EmptyBodyRequest const& request, char const* name)
+    {
+        const auto value = request[name];
+        return {value.data(), value.size()};
+    }
+
+    /**
+     * @brief Refuses to answer from the empty snapshot a start leaves when its publish failed, a difference
+     * against it would tell clients to remove every mod.
+     *
+     * @return True if the request was answered.
+     */
+    template <typename RequestT>
+    bool refuseUnpublished(Roar::Session& session, RequestT const& request, ModSnapshot const& current)
+    {
+        if (!current.etag.empty())
+            return false;
+        session.template send<string_body>(request)
+            ->status(status::service_unavailable)
+            .contentType("text/plain")
+            .setHeader(field::retry_after, std::to_string(unpublishedRetrySeconds))
+            .body("The mods are not published yet")
+            .commit();
+        return true;
+    }
+
+    /**
+     * @brief Swaps two directories in one step where the kernel can, so the mods folder is never missing or half
+     * replaced. Elsewhere it falls back to three renames.
+     */
+    void exchangeDirectories(std::filesystem::path const& first, std::filesystem::path const& second)
+    {
+#ifdef __linux__
+        if (::renameat2(AT_FDCWD, first.c_str(), AT_FDCWD, second.c_str(), RENAME_EXCHANGE) == 0)
+            return;
+        // Older kernels and some file systems cannot exchange.
+        if (errno != ENOSYS && errno != EINVAL)
+            throw std::system_error(errno, std::generic_category(), "Could not swap " + second.string());
+#endif
+        const auto aside = std::filesystem::path{first.string() + ".swap"};
+        std::filesystem::rename(first, aside);
+        std::filesystem::rename(second, first);
+        std::filesystem::rename(aside, second);
+    }
 }
 
 // #####################################################################################################################
-UpdateProvider::UpdateProvider(std::filesystem::path const& serverDirectory)
-    : serverDirectory_{serverDirectory}
-    , localMods_{}
+UpdateProvider::UpdateProvider(
+    std::filesystem::path const& serverDirectory,
+    std::optional<std::string> adminToken,
+    std::uint64_t backupBytesPerSecond,
+    std::optional<LaunchProfile> const& launchProfile)
+    : scanGuard_{}
+    , backupGuard_{}
+    , serverDirectory_{serverDirectory}
+    , snapshot_{std::make_shared<ModSnapshot const>()}
+    , hashCache_{hashCacheFile(serverDirectory)}
+    , modHistory_{serverDirectory / historyDirName, historyVersionsKept}
+    , modGenerations_{besideServerDirectory(serverDirectory, ".mod_generations")}
+    , diffCache_{cachedDifferences}
+    , modsWatcher_{}
+    , publishedFilesWatcher_{}
+    , adminToken_{std::move(adminToken)}
+    , uploading_{false}
+    , backupBytesPerSecond_{backupBytesPerSecond}
+    , worldBackup_{
+          serverDirectory / worldDirName,
+          besideServerDirectory(serverDirectory, ".backups"),
+          WorldBackup::defaultThreadCount()}
+    , serverTelemetry_{}
+    , minecraft_{[this](std::string_view line) {
+        serverTelemetry_.onOutput(line);
+    }}
+    , classDataSharing_{
+          launchProfile ? std::make_unique<ClassDataSharing>(
+                              serverDirectory, besideServerDirectory(serverDirectory, ".cds"), *launchProfile)
+                        : nullptr}
 {
-    loadLocalMods();
-    // minecraft_.start((serverDirectory / "server.jar").string());
+    hashCache_.load();
+    modHistory_.load();
+    modGenerations_.load();
+    for (int attempt = 1; attempt <= startupPublishAttempts; ++attempt)
+    {
+        try
+        {
+            loadLocalMods();
+            break;
+        }
+        catch (const std::exception& e)
+        {
+            // The game server still runs without, the watcher publishes with the next change in the mods folder.
+            if (attempt == startupPublishAttempts)
+                std::cout << "Could not publish the mods, serving none until they change: " << e.what() << '\n';
+            else
+                std::this_thread::sleep_for(startupPublishDelay);
+        }
+    }
+    const auto rescan = [this]() {
+        try
+        {
+            loadLocalMods();
+        }
+        catch (const std::exception& e)
+        {
+            // Likely caught in the middle of a copy, the next event triggers another scan.
+            std::cout << "Could not rescan mods: " << e.what() << '\n';
+        }
+    };
+    modsWatcher_ = std::make_unique<ModsWatcher>(serverDirectory_ / modsDirName, rescan);
+    publishedFilesWatcher_ = std::make_unique<ModsWatcher>(
+        serverDirectory_, rescan, std::vector<std::string>{modrinthIndexName, versionsName});
+    if (launchProfile)
+    {
+        const auto classDataSharing = classDataSharing_->jvmArguments();
+        minecraft_.start(
+            (serverDirectory / serverJarName).string(), *launchProfile, {.jvmArguments = classDataSharing});
+        serverTelemetry_.serverStarted(!classDataSharing.empty());
+        serverTelemetry_.watchProcess(minecraft_.processId());
+        // The archive only depends on what the game server was started with, the next start uses it.
+        classDataSharing_->train();
+    }
 }
 //---------------------------------------------------------------------------------------------------------------------
 void UpdateProvider::loadLocalMods()
 {
-    std::scoped_lock lock{guard_};
-    try
+    std::scoped_lock lock{scanGuard_};
+    const auto basePath = serverDirectory_;
+    std::filesystem::directory_iterator mods{basePath / modsDirName}, end;
+
+    std::vector<std::filesystem::path> paths;
+    for (; mods != end; ++mods)
+        paths.push_back(mods->path());
+    std::sort(paths.begin(), paths.end());
+
+    const auto computedBefore = hashCache_.hashesComputed();
+    const auto hashes = ParallelHasher{}.hash(paths, [this](std::filesystem::path const& path) {
+        return hashCache_.sha256(path);
+    });
+
+    std::vector<ModAndHash> localMods;
+    localMods.reserve(paths.size());
+    for (std::size_t i = 0; i != paths.size(); ++i)
+        localMods.push_back({.path = paths[i], .sha256 = hashes[i]});
+    hashCache_.retainOnly(paths);
+    hashCache_.save();
+    modHistory_.record(localMods);
+
+    if (const auto computed = hashCache_.hashesComputed() - computedBefore; computed != 0)
+        std::cout << "Hashed " << computed << " of " << localMods.size() << " mods, the rest was cached.\n";
+
+    publish(localMods);
+}
+//---------------------------------------------------------------------------------------------------------------------
+void UpdateProvider::publish(std::vector<ModAndHash> const& mods)
+{
+    ModIndex index{mods};
+    auto next = std::make_shared<ModSnapshot>();
+    // Client only mods come from the modrinth index and /sync hands out the versions, new ones of either are a new
+    // generation too. Read once, so /sync answers with exactly what the generation was published with.
+    Hashing::MultiDigest digest{Hashing::Sha256};
+    const auto modsFingerprint = index.fingerprint();
+    digest.update(modsFingerprint.data(), modsFingerprint.size());
+    for (auto const* published : {modrinthIndexName, versionsName})
     {
-        const auto basePath = serverDirectory_;
-        std::filesystem::directory_iterator mods{basePath / modsDirName}, end;
+        std::ifstream reader{getFilePath(published), std::ios_base::binary};
+        if (!reader.good())
+            continue;
+        const std::string content{std::istreambuf_iterator<char>{reader}, std::istreambuf_iterator<char>{}};
+        Hashing::MultiDigest fileDigest{Hashing::Sha256};
+        fileDigest.update(content.data(), content.size());
+        const auto hash = fileDigest.finish().sha256;
+        digest.update(hash.data(), hash.size());
 
-        localMods_.clear();
-        for (; mods != end; ++mods)
-            localMods_.push_back({.path = mods->path(), .sha256 = sha256FromFile(mods->path())});
+        auto parsed = json::parse(content, nullptr, false);
+        if (parsed.is_discarded())
+            parsed = nullptr;
+        if (std::string_view{published} == modrinthIndexName)
+        {
+            next->modrinthIndexHash = hash;
+            next->modrinthIndex = std::move(parsed);
+        }
+        else
+        {
+            next->versions = std::move(parsed);
+        }
     }
-    catch (const std::exception& e)
+
+    next->fingerprint = digest.finish().sha256;
+    const auto previous = snapshot_.load();
+    if (previous->fingerprint == next->fingerprint)
+        return;
+
+    if (previous->fingerprint.empty())
+    {
+        // First scan after a start, continue the persisted generation.
+        std::ifstream reader{generationFile(serverDirectory_), std::ios_base::binary};
+        const auto state = json::parse(reader, nullptr, false);
+        if (!state.is_discarded() && state.is_object())
+        {
+            next->generation = state.value("generation", std::uint64_t{0});
+            if (state.value("fingerprint", "") != next->fingerprint)
+                ++next->generation;
+        }
+        // Without the file, or behind the generations that are still on disk, clients may have pinned those.
+        next->generation = modGenerations_.nextGeneration(next->generation, mods);
+    }
+    else if (previous->modrinthIndexHash != next->modrinthIndexHash)
+    {
+        // Client only mods come from the index and the changelog only knows the mods folder. A client one
+        // generation behind would keep a client only mod the index dropped, it has to do the full diff instead.
+        next->generation = previous->generation + 1;
+    }
+    else
+    {
+        next->generation = previous->generation + 1;
+
+        ModChangelog changelog{.fromEtag = previous->etag, .instructions = {}, .patches = {}};
+        const auto previousMods = previous->mods.entries();
+        changelog.instructions = index.difference(previousMods);
+        changelog.patches = modHistory_.patchesFor(changelog.instructions.download, previousMods, index);
+        next->changelog = std::move(changelog);
+    }
+    next->etag = fmt::format("\"{}-{}\"", next->generation, next->fingerprint.substr(0, 16));
+    next->mods = std::move(index);
+    // Before the generation counter moves on, a failed copy leaves everything as it was.
+    next->directory = modGenerations_.publish(next->generation, mods);
+
     {
-        std::cout << e.what() << '\n';
-        exit(1);
+        const auto file = generationFile(serverDirectory_);
+        const auto temporary = std::filesystem::path{file.string() + ".tmp"};
+        std::error_code ec;
+        {
+            std::ofstream writer{temporary, std::ios_base::binary};
+            writer << json{{"generation", next->generation}, {"fingerprint", next->fingerprint}}.dump();
+            if (!writer.good())
+                ec = std::make_error_code(std::errc::io_error);
+        }
+        if (!ec)
+            std::filesystem::rename(temporary, file, ec);
+        // The generations on disk still keep the counter ahead on the next start.
+        if (ec)
+            std::cout << "Could not save the mods generation to " << file << ": " << ec.message() << "\n";
+    }
+
+    std::cout << "Publishing mods generation " << next->generation << "\n";
+    serverTelemetry_.modsPublished(next->generation);
+    snapshot_.store(std::move(next));
+}
+//---------------------------------------------------------------------------------------------------------------------
+bool UpdateProvider::rescanIfUnwatched(Roar::Session& session, Roar::EmptyBodyRequest const& request)
+{
+    try
+    {
+        // With the watchers the mods are rescanned as soon as they change, not when a client asks.
+        if (!modsWatcher_->watching() || !publishedFilesWatcher_->watching())
+            loadLocalMods();
+        return true;
+    }
+    catch (std::exception const& e)
+    {
+        session.template send<string_body>(request)
+            ->status(status::internal_server_error)
+            .contentType("text/plain")
+            .body(e.what())
+            .commit();
+        return false;
     }
 }
 //---------------------------------------------------------------------------------------------------------------------
-std::filesystem::path UpdateProvider::getModPath(std::string const& name)
+std::shared_ptr<ModSnapshot const> UpdateProvider::snapshot() const
 {
-    return serverDirectory_ / modsDirName / name;
+    return snapshot_.load();
 }
 //---------------------------------------------------------------------------------------------------------------------
 std::filesystem::path UpdateProvider::getFilePath(std::string const& name)
@@ -61,176 +421,159 @@ std::filesystem::path UpdateProvider::getFilePath(std::string const& name)
     return serverDirectory_ / name;
 }
 //---------------------------------------------------------------------------------------------------------------------
-void UpdateProvider::backupWorld()
+void UpdateProvider::forwardConsole()
 {
-    std::scoped_lock lock{guard_};
-    for (int i = 1; i != 1000; ++i)
-    {
-        std::filesystem::path worldBackup{serverDirectory_ / ("world_"s + std::to_string(i))};
-        if (!std::filesystem::exists(worldBackup))
-        {
-            std::cout << "Creating World Backup " << worldBackup.filename().string() << "\n";
-            std::filesystem::copy(serverDirectory_ / "world", worldBackup, std::filesystem::copy_options::recursive);
-            break;
-        }
-    }
+    minecraft_.forwardIo();
 }
 //---------------------------------------------------------------------------------------------------------------------
-bool UpdateProvider::installMods(std::string const& tarFile)
-{
-    // TODO: This is convenient, but with this project becoming more official, this cannot exist without password
-    // checks and ssl.
-
-    // using namespace StarTape;
-    // auto inputBundle = openInputFile(tarFile);
-    // auto arch = archive(inputBundle);
-    // auto index = arch.makeIndex();
-
-    // std::error_code ec;
-    // std::filesystem::create_directory(serverDirectory_ / "mods_upload_temp", ec);
-    // if (ec)
-    // {
-    //     std::cout << ec.message() << "\n";
-    //     return false;
-    // }
-    // for (auto const& i : index)
-    // {
-    //     if (!i.fileName.empty() &&
-    //         (i.type == Constants::TypeFlags::RegularFile || i.type == Constants::TypeFlags::RegularFileAlternate))
-    //     {
-    //         std::cout << "Extracting: " << serverDirectory_ / "mods_upload_temp" / i.fileName << "\n";
-    //         std::ofstream writer(serverDirectory_ / "mods_upload_temp" / i.fileName,
-    //         std::ios_base::binary); if (!writer.good())
-    //         {
-    //             std::cout << "Extraction failed, aborting!\n";
-    //             return false;
-    //         }
-    //         index.writeFileToStream(i, writer);
-    //     }
-    // }
-    // if (std::filesystem::exists(serverDirectory_ / "mods_backup"))
-    // {
-    //     std::filesystem::remove_all(serverDirectory_ / "mods_backup", ec);
-    //     if (ec)
-    //     {
-    //         std::cout << ec.message() << "\n";
-    //         return false;
-    //     }
-    // }
-    // if (std::filesystem::exists(serverDirectory_ / "mods"))
-    // {
-    //     std::filesystem::rename(serverDirectory_ / "mods", serverDirectory_ / "mods_backup",
-    //     ec); if (ec)
-    //     {
-    //         std::cout << ec.message() << "\n";
-    //         return false;
-    //     }
-    // }
-    // std::filesystem::rename(serverDirectory_ / "mods_upload_temp", serverDirectory_ / "mods",
-    // ec); if (ec)
-    // {
-    //     std::cout << ec.message() << "\n";
-    //     return false;
-    // }
-    // return true;
-    return true;
+WorldSnapshot UpdateProvider::backupWorld()
+{
+    std::scoped_lock lock{backupGuard_};
+    return throttledByLag(serverDirectory_, backupBytesPerSecond_, runningTelemetry(), [this](RateLimiter& limiter) {
+        return worldBackup_.create(limiter, savePause());
+    });
 }
 //---------------------------------------------------------------------------------------------------------------------
-UpdateInstructions UpdateProvider::buildDifference(std::vector<ModAndHash> const& remoteFiles)
+ServerTelemetry* UpdateProvider::runningTelemetry()
 {
-    std::scoped_lock lock{guard_};
-
-    std::set<std::string> remoteSet, localSet;
-    std::transform(
-        std::begin(remoteFiles),
-        std::end(remoteFiles),
-        std::inserter(remoteSet, std::end(remoteSet)),
-        [](auto const& element) {
-            return element.path.string();
-        });
-    std::transform(
-        std::begin(localMods_),
-        std::end(localMods_),
-        std::inserter(localSet, std::end(localSet)),
-        [](auto const& element) {
-            return element.path.filename().string();
-        });
+    return minecraft_.running() ? &serverTelemetry_ : nullptr;
+}
+//---------------------------------------------------------------------------------------------------------------------
+WorldBackup::Pause UpdateProvider::savePause()
+{
+    if (!minecraft_.running())
+        return {};
 
-    std::set<std::string> equal;
-    std::vector<std::string> fresh, old;
-    std::set_difference(
-        std::begin(remoteSet),
-        std::end(remoteSet),
-        std::begin(localSet),
-        std::end(localSet),
-        std::inserter(old, std::end(old)));
-    std::set_difference(
-        std::begin(localSet),
-        std::end(localSet),
-        std::begin(remoteSet),
-        std::end(remoteSet),
-        std::inserter(fresh, std::end(fresh)));
-    std::set_intersection(
-        std::begin(localSet),
-        std::end(localSet),
-        std::begin(remoteSet),
-        std::end(remoteSet),
-        std::inserter(equal, std::end(equal)));
-
-    auto hashOf = [&, this](std::string const& name) {
-        auto it = std::find_if(std::begin(localMods_), std::end(localMods_), [&name](auto const& element) {
-            return element.path.filename().string() == name;
-        });
-        if (it != std::end(localMods_))
-            return it->sha256;
-        return std::string{};
+    // Only the answers of the server itself, a player could say the same in chat.
+    const auto says = [](std::string_view message) {
+        return [message](std::string_view line) {
+            return serverMessage(line, "INFO") == message;
+        };
     };
-
-    const auto basePath = serverDirectory_;
-    for (auto const& remote : remoteFiles)
+    constexpr std::string_view alreadyOff = "Saving is already turned off";
+    // Saving that an operator turned off stays off afterwards.
+    auto wasOff = std::make_shared<bool>(false);
+    return {
+        .begin =
+            [this, says, alreadyOff, wasOff]() {
+                const auto savingOff = minecraft_.sendCommand(
+                    "save-off",
+                    [says, alreadyOff](std::string_view line) {
+                        return says("Automatic saving is now disabled")(line) || says(alreadyOff)(line);
+                    },
+                    consoleTimeout);
+                if (!savingOff)
+                    throw std::runtime_error("The game server did not turn saving off");
+                *wasOff = says(alreadyOff)(*savingOff);
+                if (!minecraft_.sendCommand("save-all flush", says("Saved the game"), flushTimeout))
+                {
+                    if (!*wasOff)
+                        minecraft_.sendCommand("save-on");
+                    throw std::runtime_error("The game server did not save the world in time");
+                }
+            },
+        .end =
+            [this, says, wasOff]() {
+                if (*wasOff)
+                    return;
+                if (!minecraft_.sendCommand("save-on", says("Automatic saving is now enabled"), consoleTimeout))
+                    std::cout << "The game server did not confirm save-on, check that saving is enabled\n";
+            },
+    };
+}
+//---------------------------------------------------------------------------------------------------------------------
+void UpdateProvider::restoreWorld(std::filesystem::path const& serverDirectory, std::string const& snapshot)
+{
+    WorldBackup{
+        serverDirectory / worldDirName,
+        besideServerDirectory(serverDirectory, ".backups"),
+        WorldBackup::defaultThreadCount()}
+        .restore(snapshot);
+}
+//---------------------------------------------------------------------------------------------------------------------
+WorldArchiveResult UpdateProvider::archiveWorld(
+    std::filesystem::path const& serverDirectory,
+    std::uint64_t backupBytesPerSecond,
+    WorldBackup::Pause const& pause,
+    ServerTelemetry* telemetry)
+{
+    WorldArchive archive{
+        serverDirectory / worldDirName,
+        besideServerDirectory(serverDirectory, ".archives"),
+        archiveCompressionLevel,
+        WorldArchive::defaultThreadCount()};
+    return throttledByLag(serverDirectory, backupBytesPerSecond, telemetry, [&archive, &pause](RateLimiter& limiter) {
+        return archive.create(limiter, pause);
+    });
+}
+//---------------------------------------------------------------------------------------------------------------------
+bool UpdateProvider::installMods(std::vector<ModAndHash> const& staged)
+{
+    const auto mods = serverDirectory_ / modsDirName;
+    const auto upload = serverDirectory_ / uploadDirName;
+    const auto backup = serverDirectory_ / modsBackupDirName;
     {
-        if (equal.find(remote.path.string()) != std::end(equal) && !remote.sha256.empty() &&
-            hashOf(remote.path.string()) != remote.sha256)
+        std::scoped_lock lock{scanGuard_};
+        try
         {
-            fresh.push_back(remote.path.string());
-            old.push_back(remote.path.string());
+            std::filesystem::remove_all(backup);
+            if (std::filesystem::exists(mods))
+                exchangeDirectories(upload, mods);
+            else
+                std::filesystem::rename(upload, mods);
+        }
+        catch (std::exception const& e)
+        {
+            std::cout << "Could not install the uploaded mods: " << e.what() << "\n";
+            return false;
         }
-    }
 
-    fmt::print("FRESH:\n{}\n---------------\n", fresh);
-    fmt::print("OUTDATED:\n{}\n---------------\n", old);
+        // The upload folder holds the previous mods now, they are kept until the next upload.
+        std::error_code ec;
+        if (std::filesystem::exists(upload, ec))
+            std::filesystem::rename(upload, backup, ec);
+        if (ec)
+            std::cout << "Could not keep the previous mods as " << backup.string() << ": " << ec.message() << "\n";
 
-    return UpdateInstructions{.download = fresh, .remove = old};
+        // Hashed while they were received, the scan below only looks them up.
+        for (auto const& file : staged)
+            hashCache_.remember(mods / file.path.filename(), file.sha256);
+        modsWatcher_->rewatch();
+    }
+    try
+    {
+        loadLocalMods();
+    }
+    catch (std::exception const& e)
+    {
+        // The jars are in place, the watcher publishes them once they can be read.
+        std::cout << "Could not publish the uploaded mods: " << e.what() << "\n";
+        return false;
+    }
+    return true;
+}
+//---------------------------------------------------------------------------------------------------------------------
+UpdateInstructions UpdateProvider::buildDifference(
+    ModIndex const& localMods,
+    std::vector<ModAndHash> const& remoteFiles)
+{
+    return localMods.difference(remoteFiles);
 }
 //---------------------------------------------------------------------------------------------------------------------
 void UpdateProvider::index(Roar::Session& session, Roar::EmptyBodyRequest&& request)
 {
-    std::scoped_lock lock{guard_};
     session.template send<string_body>(request)->status(status::ok).contentType("text/plain").body("Hi").commit();
 }
 //---------------------------------------------------------------------------------------------------------------------
 void UpdateProvider::makeFileDifference(Roar::Session& session, Roar::EmptyBodyRequest&& request)
 {
-    try
-    {
-        loadLocalMods();
-    }
-    catch (std::exception const& e)
-    {
-        session.template send<string_body>(request)
-            ->status(status::internal_server_error)
-            .contentType("text/plain")
-            .body(e.what())
-            .commit();
+    if (!rescanIfUnwatched(session, request))
         return;
-    }
 
-    std::scoped_lock lock{guard_};
     session.template read<string_body>(std::move(request))
         ->noBodyLimit()
         .commit()
         .then([this](Roar::Session& session, Roar::Request<string_body> const& req) {
-            std::scoped_lock lock{guard_};
             if (req.body().empty())
             {
                 session.template send<string_body>(req)
@@ -261,14 +604,30 @@ void UpdateProvider::makeFileDifference(Roar::Session& session, Roar::EmptyBodyR
                 files.push_back(
                     ModAndHash{.path = mod["name"].get<std::string>(), .sha256 = mod["hash"].get<std::string>()});
             }
-            auto diff = buildDifference(files);
-            auto response = "{}"_json;
-            response["download"] = diff.download;
-            response["remove"] = diff.remove;
+            const auto current = snapshot();
+            if (refuseUnpublished(session, req, *current))
+                return;
+            const auto fingerprint = clientFingerprint(files);
+            auto body = diffCache_.find(current->etag, fingerprint);
+            if (!body)
+            {
+                auto diff = buildDifference(current->mods, files);
+                auto response = "{}"_json;
+                response["download"] = diff.download;
+                response["remove"] = diff.remove;
+                response["patches"] = toJson(modHistory_.patchesFor(diff.download, files, current->mods));
+                response["generation"] = current->generation;
+                response["etag"] = current->etag;
+                body = response.dump();
+
+                // A rescan may have published a newer snapshot meanwhile, the cache ignores answers for older ones.
+                diffCache_.insert(current->generation, current->etag, fingerprint, *body);
+            }
             session.template send<string_body>(req)
                 ->status(status::ok)
                 .contentType("application/json")
-                .body(response.dump())
+                .setHeader(field::etag, current->etag)
+                .body(std::move(*body))
                 .commit();
         })
         .fail([](auto&& err) {
@@ -278,11 +637,7 @@ void UpdateProvider::makeFileDifference(Roar::Session& session, Roar::EmptyBodyR
 //---------------------------------------------------------------------------------------------------------------------
 void UpdateProvider::downloadMod(Roar::Session& session, Roar::EmptyBodyRequest&& request)
 {
-    std::scoped_lock lock{guard_};
-    boost::beast::error_code ec;
-    file_body::value_type body;
     auto const& matches = request.pathMatches();
-    // print matches
     if (!matches || matches->size() != 1)
     {
         session.template send<string_body>(request)
@@ -292,10 +647,73 @@ void UpdateProvider::downloadMod(Roar::Session& session, Roar::EmptyBodyRequest&
             .commit();
         return;
     }
-    const auto decoded = Roar::urlDecode((*matches)[0]);
-    const auto modPath = getModPath(decoded);
-    body.open(modPath.string().c_str(), boost::beast::file_mode::read, ec);
-    if (!body.is_open())
+    if (const auto generation = requestedGeneration(session, request))
+        serveMod(session, request, modGenerations_.find(*generation, Roar::urlDecode((*matches)[0])), false, false);
+}
+//---------------------------------------------------------------------------------------------------------------------
+void UpdateProvider::downloadModHead(Roar::Session& session, Roar::EmptyBodyRequest&& request)
+{
+    auto const& matches = request.pathMatches();
+    if (!matches || matches->size() != 1)
+    {
+        session.template send<string_body>(request)
+            ->status(status::bad_request)
+            .contentType("text/plain")
+            .body(fmt::format("Invalid path: {}", request.target()))
+            .commit();
+        return;
+    }
+    if (const auto generation = requestedGeneration(session, request))
+        serveMod(session, request, modGenerations_.find(*generation, Roar::urlDecode((*matches)[0])), true, false);
+}
+//---------------------------------------------------------------------------------------------------------------------
+void UpdateProvider::blob(Roar::Session& session, Roar::EmptyBodyRequest&& request)
+{
+    auto const& matches = request.pathMatches();
+    const auto generation = requestedGeneration(session, request);
+    if (!generation)
+        return;
+    serveMod(
+        session,
+        request,
+        matches && matches->size() == 1 ? modGenerations_.findByHash(*generation, (*matches)[0]) : std::nullopt,
+        false,
+        true);
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::optional<std::uint64_t>
+UpdateProvider::requestedGeneration(Roar::Session& session, Roar::EmptyBodyRequest const& request)
+{
+    const auto pinned = headerValue(request, generationHeader);
+    if (pinned.empty())
+        return snapshot()->generation;
+
+    std::uint64_t generation = 0;
+    const auto [end, error] = std::from_chars(pinned.data(), pinned.data() + pinned.size(), generation);
+    if (error == std::errc{} && end == pinned.data() + pinned.size() && modGenerations_.pin(generation))
+        return generation;
+
+    session.template send<string_body>(request)
+        ->status(status::gone)
+        .contentType("text/plain")
+        .body(fmt::format("Mods generation {} is gone, sync again", pinned))
+        .commit();
+    return std::nullopt;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void UpdateProvider::serveMod(
+    Roar::Session& session,
+    Roar::EmptyBodyRequest const& request,
+    std::optional<ModAndHash> const& mod,
+    bool headersOnly,
+    bool immutable)
+{
+    // Only mods of a generation are found, this also keeps paths like ../ out.
+    boost::beast::error_code ec;
+    FileRangeBody::value_type body;
+    if (mod)
+        body.open(mod->path.string().c_str(), ec);
+    if (!mod || !body.is_open())
     {
         session.template send<string_body>(request)
             ->status(status::not_found)
@@ -304,33 +722,392 @@ void UpdateProvider::downloadMod(Roar::Session& session, Roar::EmptyBodyRequest&
             .commit();
         return;
     }
-    session.template send<file_body>(request)
+
+    const auto etag = "\""s + mod->sha256 + "\"";
+    if (const auto ifNoneMatch = headerValue(request, field::if_none_match);
+        ifNoneMatch == "*" || ifNoneMatch.find(etag) != std::string_view::npos)
+    {
+        session.template send<empty_body>(request)->status(status::not_modified).setHeader(field::etag, etag).commit();
+        return;
+    }
+
+    auto range = RangeRequest{.kind = RangeRequest::Kind::Full, .begin = 0, .end = body.fileSize()};
+    // A client resuming a download of another version of the file gets the whole new file instead.
+    if (const auto ifRange = headerValue(request, field::if_range); ifRange.empty() || ifRange == etag)
+        range = parseRange(headerValue(request, field::range), body.fileSize());
+    if (range.kind == RangeRequest::Kind::Unsatisfiable)
+    {
+        session.template send<empty_body>(request)
+            ->status(status::range_not_satisfiable)
+            .setHeader(field::content_range, fmt::format("bytes */{}", body.fileSize()))
+            .commit();
+        return;
+    }
+    body.range(range.begin, range.end);
+
+    const auto decorate = [&](auto& intent) -> auto& {
+        intent.status(range.kind == RangeRequest::Kind::Partial ? status::partial_content : status::ok)
+            .contentType(".jar")
+            .setHeader(field::etag, etag)
+            .setHeader(field::accept_ranges, "bytes");
+        // Blob urls name the content, it can never change under them.
+        if (immutable)
+            intent.setHeader(field::cache_control, "public, max-age=31536000, immutable");
+        if (range.kind == RangeRequest::Kind::Partial)
+        {
+            intent.setHeader(
+                field::content_range, fmt::format("bytes {}-{}/{}", range.begin, range.end - 1, body.fileSize()));
+        }
+        return intent;
+    };
+
+    // The body is written asynchronously by the session, no pool thread waits for the transfer.
+    if (headersOnly)
+    {
+        auto intent = session.template send<empty_body>(request);
+        decorate(*intent).setHeader(field::content_length, std::to_string(range.end - range.begin)).commit();
+        return;
+    }
+    auto intent = session.template send<FileRangeBody>(request);
+    decorate(*intent).body(std::move(body)).preparePayload().commit();
+}
+//---------------------------------------------------------------------------------------------------------------------
+void UpdateProvider::downloadBundle(Roar::Session& session, Roar::EmptyBodyRequest&& request)
+{
+    const auto generation = requestedGeneration(session, request);
+    if (!generation)
+        return;
+
+    session.template read<string_body>(std::move(request))
+        ->bodyLimit(1024 * 1024)
+        .commit()
+        .then([this, generation = *generation](Roar::Session& session, Roar::Request<string_body> const& req) {
+            std::vector<std::string> names;
+            try
+            {
+                json::parse(req.body()).at("mods").get_to(names);
+            }
+            catch (std::exception const& e)
+            {
+                session.template send<string_body>(req)
+                    ->status(status::bad_request)
+                    .contentType("text/plain")
+                    .body("Expected {\"mods\": [names...]}")
+                    .commit();
+                return;
+            }
+
+            // Unknown names are left out, the client fetches whatever is missing one by one.
+            TarBundleBody::value_type bundle;
+            try
+            {
+                for (auto const& name : names)
+                {
+                    if (const auto mod = modGenerations_.find(generation, name))
+                        bundle.add(mod->path);
+                }
+            }
+            catch (std::exception const& e)
+            {
+                session.template send<string_body>(req)
+                    ->status(status::internal_server_error)
+                    .contentType("text/plain")
+                    .body(e.what())
+                    .commit();
+                return;
+            }
+
+            session.template send<TarBundleBody>(req)
+                ->status(status::ok)
+                .contentType(".tar")
+                .body(std::move(bundle))
+                .preparePayload()
+                .commit();
+        })
+        .fail([](auto&& err) {
+            fmt::print("Failed to read body: {}\n", err.toString());
+        });
+}
+//---------------------------------------------------------------------------------------------------------------------
+void UpdateProvider::downloadPatch(Roar::Session& session, Roar::EmptyBodyRequest&& request)
+{
+    auto const& matches = request.pathMatches();
+    if (!matches || matches->size() != 2)
+    {
+        session.template send<string_body>(request)
+            ->status(status::bad_request)
+            .contentType("text/plain")
+            .body(fmt::format("Invalid path: {}", request.target()))
+            .commit();
+        return;
+    }
+
+    // Patches are built in the background after a scan, never for a request.
+    const auto patch = modHistory_.patch((*matches)[0], (*matches)[1]);
+    boost::beast::error_code ec;
+    FileRangeBody::value_type body;
+    if (patch)
+        body.open(patch->string().c_str(), ec);
+    if (!body.is_open())
+    {
+        // Not built yet or not worth it, the client downloads the whole jar instead.
+        session.template send<string_body>(request)
+            ->status(status::not_found)
+            .contentType("text/plain")
+            .body("No patch")
+            .commit();
+        return;
+    }
+    session.template send<FileRangeBody>(request)
         ->status(status::ok)
-        .contentType(".jar")
+        .contentType(".zst")
         .body(std::move(body))
+        .preparePayload()
+        .commit();
+}
+//---------------------------------------------------------------------------------------------------------------------
+void UpdateProvider::uploadMods(Roar::Session& session, Roar::EmptyBodyRequest&& request)
+{
+    if (!authorize(session, request))
+        return;
+    if (uploading_.exchange(true))
+    {
+        session.template send<string_body>(request)
+            ->status(status::conflict)
+            .contentType("text/plain")
+            .body("Another upload is in progress")
+            .commit();
+        return;
+    }
+
+    const auto upload = serverDirectory_ / uploadDirName;
+    std::error_code ec;
+    std::filesystem::remove_all(upload, ec);
+    std::filesystem::create_directories(upload, ec);
+    if (ec)
+    {
+        uploading_ = false;
+        session.template send<string_body>(request)
+            ->status(status::internal_server_error)
+            .contentType("text/plain")
+            .body("Cannot create " + upload.string() + ": " + ec.message())
+            .commit();
+        return;
+    }
+
+    // The tar is extracted into the upload folder while it arrives, nothing of it is kept in memory.
+    session.template read<TarUploadBody>(std::move(request), upload)
+        ->bodyLimit(maximumUploadSize)
         .commit()
-        .then([keepOpen = session.shared_from_this()](bool wasClosed) {
-            if (!wasClosed)
-                std::this_thread::sleep_for(5s);
+        .then([this](Roar::Session& session, Roar::Request<TarUploadBody> const& req) {
+            const auto finished = Roar::ScopeExit{[this]() {
+                uploading_ = false;
+            }};
+            auto const& body = req.body();
+            if (body.error())
+            {
+                session.template send<string_body>(req)
+                    ->status(status::bad_request)
+                    .contentType("text/plain")
+                    .body(*body.error())
+                    .commit();
+                return;
+            }
+            if (body.files().empty())
+            {
+                // Would leave the server without any mods.
+                std::error_code ec;
+                std::filesystem::remove_all(serverDirectory_ / uploadDirName, ec);
+                session.template send<string_body>(req)
+                    ->status(status::bad_request)
+                    .contentType("text/plain")
+                    .body("The upload contains no mods")
+                    .commit();
+                return;
+            }
+            if (!installMods(body.files()))
+            {
+                session.template send<string_body>(req)
+                    ->status(status::internal_server_error)
+                    .contentType("text/plain")
+                    .body("Could not install the uploaded mods")
+                    .commit();
+                return;
+            }
+
+            const auto current = snapshot();
+            std::cout << "Installed " << body.files().size() << " uploaded mods as generation " << current->generation
+                      << "\n";
+            session.template send<string_body>(req)
+                ->status(status::ok)
+                .contentType("application/json")
+                .body(json{
+                    {"mods", body.files().size()},
+                    {"generation", current->generation},
+                    {"etag", current->etag},
+                }
+                          .dump())
+                .commit();
+        })
+        .fail([this](auto&& err) {
+            uploading_ = false;
+            fmt::print("Failed to read upload: {}\n", err.toString());
         });
 }
 //---------------------------------------------------------------------------------------------------------------------
-void UpdateProvider::uploadMods(Roar::Session& session, Roar::EmptyBodyRequest&& request)
+void UpdateProvider::createWorldBackup(Roar::Session& session, Roar::EmptyBodyRequest&& request)
+{
+    if (!authorize(session, request))
+        return;
+
+    // Takes as long as copying the changed region files, the job thread does it.
+    startWorldJob(session, request, "backup", [this]() {
+        const auto snapshot = backupWorld();
+        return json{
+            {"name", snapshot.name},
+            {"files", snapshot.files},
+            {"copiedFiles", snapshot.copiedFiles},
+            {"copiedBytes", snapshot.copiedBytes},
+            {"linkedBytes", snapshot.linkedBytes},
+            {"pausedMilliseconds", snapshot.pausedMilliseconds},
+        };
+    });
+}
+//---------------------------------------------------------------------------------------------------------------------
+void UpdateProvider::createWorldArchive(Roar::Session& session, Roar::EmptyBodyRequest&& request)
+{
+    if (!authorize(session, request))
+        return;
+
+    startWorldJob(session, request, "archive", [this]() {
+        // Shares the guard with snapshots, both read the whole world and would only slow each other down.
+        std::scoped_lock lock{backupGuard_};
+        try
+        {
+            const auto archive = archiveWorld(serverDirectory_, backupBytesPerSecond_, savePause(), runningTelemetry());
+            return json{
+                {"archive", archive.archive.filename().string()},
+                {"files", archive.files},
+                {"resumedFiles", archive.resumedFiles},
+                {"inputBytes", archive.inputBytes},
+                {"outputBytes", archive.outputBytes},
+                {"seconds", archive.seconds},
+            };
+        }
+        catch (std::exception const& e)
+        {
+            throw std::runtime_error(fmt::format("{}, the next run resumes it", e.what()));
+        }
+    });
+}
+//---------------------------------------------------------------------------------------------------------------------
+void UpdateProvider::startWorldJob(
+    Roar::Session& session,
+    Roar::EmptyBodyRequest const& request,
+    std::string kind,
+    std::function<json()> job)
+{
+    const auto id = worldJobs_.start(std::move(kind), std::move(job));
+    if (!id)
+    {
+        session.template send<string_body>(request)
+            ->status(status::conflict)
+            .contentType("text/plain")
+            .body("A backup is in progress")
+            .commit();
+        return;
+    }
+    const auto location = fmt::format("/world_job/{}", *id);
+    session.template send<string_body>(request)
+        ->status(status::accepted)
+        .contentType("application/json")
+        .setHeader(field::location, location)
+        .body(json{{"id", *id}, {"status", location}}.dump())
+        .commit();
+}
+//---------------------------------------------------------------------------------------------------------------------
+void UpdateProvider::worldJob(Roar::Session& session, Roar::EmptyBodyRequest&& request)
 {
-    // TODO:
+    if (!authorize(session, request))
+        return;
+
+    auto const& matches = request.pathMatches();
+    std::uint64_t id = 0;
+    std::optional<json> jobStatus;
+    if (matches && matches->size() == 1)
+    {
+        auto const& text = (*matches)[0];
+        const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), id);
+        if (error == std::errc{} && end == text.data() + text.size())
+            jobStatus = worldJobs_.status(id);
+    }
+    if (!jobStatus)
+    {
+        session.template send<string_body>(request)
+            ->status(status::not_found)
+            .contentType("text/plain")
+            .body("No such job, only the last ones are kept")
+            .commit();
+        return;
+    }
     session.template send<string_body>(request)
-        ->status(status::not_implemented)
-        .contentType("text/plain")
-        .body("Not Implemented")
+        ->status(status::ok)
+        .contentType("application/json")
+        .setHeader(field::cache_control, "no-store")
+        .body(jobStatus->dump())
         .commit();
 }
 //---------------------------------------------------------------------------------------------------------------------
+bool UpdateProvider::authorize(Roar::Session& session, Roar::EmptyBodyRequest const& request)
+{
+    // The server speaks plain http, the token is only safe on a trusted network or behind a TLS proxy.
+    if (!adminToken_)
+    {
+        session.template send<string_body>(request)
+            ->status(status::forbidden)
+            .contentType("text/plain")
+            .body("Disabled, start the update server with --admin-token-file.")
+            .commit();
+        return false;
+    }
+    const auto expected = "Bearer " + *adminToken_;
+    const auto authorization = headerValue(request, field::authorization);
+    if (authorization.size() != expected.size() ||
+        CRYPTO_memcmp(authorization.data(), expected.data(), expected.size()) != 0)
+    {
+        session.template send<string_body>(request)
+            ->status(status::unauthorized)
+            .contentType("text/plain")
+            .setHeader(field::www_authenticate, "Bearer")
+            .body("Unauthorized")
+            .commit();
+        return false;
+    }
+    return true;
+}
+//---------------------------------------------------------------------------------------------------------------------
 void UpdateProvider::versions(Roar::Session& session, Roar::EmptyBodyRequest&& request)
 {
-    std::scoped_lock lock{guard_};
     boost::beast::error_code ec;
     file_body::value_type body;
-    body.open((serverDirectory_ / "versions.json").string().c_str(), boost::beast::file_mode::read, ec);
+    body.open((serverDirectory_ / versionsName).string().c_str(), boost::beast::file_mode::read, ec);
+    if (!body.is_open())
+    {
+        session.template send<string_body>(request)
+            ->status(status::not_found)
+            .contentType("text/plain")
+            .body("Not Found")
+            .commit();
+        return;
+    }
+    session.template send<file_body>(request)->status(status::ok).contentType(".json").body(std::move(body)).commit();
+}
+//---------------------------------------------------------------------------------------------------------------------
+void UpdateProvider::modrinthIndex(Roar::Session& session, Roar::EmptyBodyRequest&& request)
+{
+    boost::beast::error_code ec;
+    file_body::value_type body;
+    body.open((serverDirectory_ / modrinthIndexName).string().c_str(), boost::beast::file_mode::read, ec);
     if (!body.is_open())
     {
         session.template send<string_body>(request)
@@ -342,4 +1119,252 @@ void UpdateProvider::versions(Roar::Session& session, Roar::EmptyBodyRequest&& r
     }
     session.template send<file_body>(request)->status(status::ok).contentType(".json").body(std::move(body)).commit();
 }
-// #####################################################################################################################
\ No newline at end of file
+//---------------------------------------------------------------------------------------------------------------------
+void UpdateProvider::manifest(Roar::Session& session, Roar::EmptyBodyRequest&& request)
+{
+    if (!rescanIfUnwatched(session, request))
+        return;
+    const auto current = snapshot();
+    if (refuseUnpublished(session, request, *current))
+        return;
+    const auto ifNoneMatch = headerValue(request, field::if_none_match);
+    if (!current->etag.empty() && ifNoneMatch == current->etag)
+    {
+        session.template send<empty_body>(request)
+            ->status(status::not_modified)
+            .setHeader(field::etag, current->etag)
+            .commit();
+        return;
+    }
+
+    auto response = json{
+        {"generation", current->generation},
+        {"etag", current->etag},
+        {"changelog", nullptr},
+    };
+    if (current->changelog && !ifNoneMatch.empty() && ifNoneMatch == current->changelog->fromEtag)
+    {
+        response["changelog"] = {
+            {"download", current->changelog->instructions.download},
+            {"remove", current->changelog->instructions.remove},
+            {"patches", toJson(current->changelog->patches)},
+        };
+    }
+    session.template send<string_body>(request)
+        ->status(status::ok)
+        .contentType("application/json")
+        .setHeader(field::etag, current->etag)
+        .body(response.dump())
+        .commit();
+}
+//---------------------------------------------------------------------------------------------------------------------
+void UpdateProvider::sync(Roar::Session& session, Roar::EmptyBodyRequest&& request)
+{
+    if (!rescanIfUnwatched(session, request))
+        return;
+    session.template read<string_body>(std::move(request))
+        ->noBodyLimit()
+        .commit()
+        .then([this](Roar::Session& session, Roar::Request<string_body> const& req) {
+            std::optional<std::vector<ModAndHash>> files;
+            std::string knownEtag;
+            try
+            {
+                const auto body = json::parse(req.body());
+                knownEtag = body.value("etag", "");
+                if (body.contains("mods"))
+                {
+                    files.emplace();
+                    for (auto const& mod : body.at("mods"))
+                    {
+                        files->push_back(ModAndHash{
+                            .path = mod.at("name").get<std::string>(),
+                            .sha256 = mod.at("hash").get<std::string>(),
+                        });
+                    }
+                }
+            }
+            catch (std::exception const&)
+            {
+                session.template send<string_body>(req)
+                    ->status(status::bad_request)
+                    .contentType("text/plain")
+                    .body("Expected {\"mods\": [{name, hash}...], \"etag\": optional}")
+                    .commit();
+                return;
+            }
+
+            const auto current = snapshot();
+            if (refuseUnpublished(session, req, *current))
+                return;
+            const auto answer = [&]() -> std::string {
+                if (!knownEtag.empty() && knownEtag == current->etag)
+                    return syncResponse(*current, SyncState::UpToDate, {}, {});
+                if (!knownEtag.empty() && current->changelog && knownEtag == current->changelog->fromEtag)
+                {
+                    return syncResponse(
+                        *current,
+                        SyncState::Changelog,
+                        current->changelog->instructions,
+                        current->changelog->patches);
+                }
+                if (!files)
+                    return syncResponse(*current, SyncState::NeedMods, {}, {});
+
+                // The answer only depends on the snapshot and the client mods, like the one of make_file_difference.
+                const auto fingerprint = "sync:" + clientFingerprint(*files);
+                if (auto cached = diffCache_.find(current->etag, fingerprint))
+                    return std::move(*cached);
+                const auto instructions = buildDifference(current->mods, *files);
+                auto body = syncResponse(
+                    *current,
+                    SyncState::Changes,
+                    instructions,
+                    modHistory_.patchesFor(instructions.download, *files, current->mods));
+                diffCache_.insert(current->generation, current->etag, fingerprint, body);
+                return body;
+            };
+
+            std::string body;
+            try
+            {
+                body = answer();
+            }
+            catch (std::exception const& e)
+            {
+                // A partial answer would let the client save its state without the mods that are missing in it.
+                session.template send<string_body>(req)
+                    ->status(status::internal_server_error)
+                    .contentType("text/plain")
+                    .body(e.what())
+                    .commit();
+                return;
+            }
+            session.template send<string_body>(req)
+                ->status(status::ok)
+                .contentType("application/json")
+                .setHeader(field::etag, current->etag)
+                .body(std::move(body))
+                .commit();
+        })
+        .fail([](auto&& err) {
+            fmt::print("Failed to read body: {}\n", err.toString());
+        });
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::string UpdateProvider::syncResponse(
+    ModSnapshot const& current,
+    SyncState state,
+    UpdateInstructions const& instructions,
+    std::vector<ModPatch> const& patches)
+{
+    auto downloads = json::array();
+    for (auto const& name : instructions.download)
+    {
+        auto const* sha256 = current.mods.find(name);
+        if (sha256 == nullptr)
+            throw std::runtime_error(name + " is not part of mods generation " + std::to_string(current.generation));
+        const auto size = std::filesystem::file_size(current.directory / name);
+        downloads.push_back({
+            {"name", name},
+            {"sha256", *sha256},
+            {"size", size},
+            {"url", "/blob/" + *sha256},
+        });
+    }
+
+    return json{
+        {"generation", current.generation},
+        {"etag", current.etag},
+        {"upToDate", state == SyncState::UpToDate},
+        {"needMods", state == SyncState::NeedMods},
+        {"changelog", state == SyncState::Changelog},
+        {"versions", current.versions},
+        {"modrinthIndex", state == SyncState::UpToDate ? json(nullptr) : current.modrinthIndex},
+        {"download", std::move(downloads)},
+        {"remove", instructions.remove},
+        {"patches", toJson(patches)},
+    }
+        .dump();
+}
+//---------------------------------------------------------------------------------------------------------------------
+void UpdateProvider::metrics(Roar::Session& session, Roar::EmptyBodyRequest&& request)
+{
+    const auto metrics = serverTelemetry_.metrics();
+    const auto optionalNumber = [](std::optional<double> const& value) {
+        return value ? json(*value) : json(nullptr);
+    };
+
+    auto recentLag = json::array();
+    for (auto const& warning : metrics.recentLag)
+    {
+        recentLag.push_back({
+            {"time", warning.time},
+            {"millisecondsBehind", warning.millisecondsBehind},
+            {"ticksBehind", warning.ticksBehind},
+            {"generation", warning.generation},
+        });
+    }
+    auto samples = json::array();
+    for (auto const& sample : metrics.samples)
+    {
+        samples.push_back({
+            {"time", sample.time},
+            {"cpuPercent", sample.cpuPercent},
+            {"residentBytes", sample.residentBytes},
+        });
+    }
+    auto generations = json::array();
+    for (auto const& generation : metrics.generations)
+    {
+        generations.push_back({
+            {"generation", generation.generation},
+            {"since", generation.since},
+            {"lagWarnings", generation.lagWarnings},
+            {"ticksBehind", generation.ticksBehind},
+        });
+    }
+
+    session.template send<string_body>(request)
+        ->status(status::ok)
+        .contentType("application/json")
+        .setHeader(field::cache_control, "no-store")
+        .body(json{
+            {"running", minecraft_.running()},
+            {"generation", snapshot()->generation},
+            {"retainedModGenerations", modGenerations_.retained()},
+            {"startupSeconds", optionalNumber(metrics.startupSeconds)},
+            {"classDataSharing", metrics.classDataSharing},
+            {"lagWarnings", metrics.lagWarnings},
+            {"ticksBehind", metrics.ticksBehind},
+            {"saves", metrics.saves},
+            {"lastSaveSeconds", optionalNumber(metrics.lastSaveSeconds)},
+            {"longestSaveSeconds", metrics.longestSaveSeconds},
+            {"recentLag", std::move(recentLag)},
+            {"samples", std::move(samples)},
+            {"generations", std::move(generations)},
+        }
+                  .dump())
+        .commit();
+}
+//---------------------------------------------------------------------------------------------------------------------
+void UpdateProvider::consoleOutput(Roar::Session& session, Roar::EmptyBodyRequest&& request)
+{
+    // Chat and player addresses end up in the console.
+    if (!authorize(session, request))
+        return;
+
+    std::string body;
+    for (auto const& line : serverTelemetry_.recentOutput())
+    {
+        body += line;
+        body += '\n';
+    }
+    session.template send<string_body>(request)
+        ->status(status::ok)
+        .contentType("text/plain")
+        .setHeader(field::cache_control, "no-store")
+        .body(std::move(body))
+        .commit();
+}
+// #####################################################################################################################
@@ -0,0 +1,384 @@
+#include <update_server/hashing.hpp>
+#include <update_server/low_io_priority.hpp>
+#include <update_server/tar_stream.hpp>
+#include <update_server/world_archive.hpp>
+
+#include <nlohmann/json.hpp>
+#include <zstd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+    constexpr int journalFormatVersion = 3;
+    constexpr char const* journalFileName = "unfinished.journal.jsonl";
+    constexpr char const* partialSuffix = ".partial";
+    /// Held open by the game server and meaningless in a copy.
+    constexpr char const* sessionLockName = "session.lock";
+
+    struct CompressDeleter
+    {
+        void operator()(ZSTD_CCtx* context) const
+        {
+            ZSTD_freeCCtx(context);
+        }
+    };
+
+    void check(std::size_t result)
+    {
+        if (ZSTD_isError(result))
+            throw std::runtime_error(std::string{"zstd: "} + ZSTD_getErrorName(result));
+    }
+
+    std::string utcTimestamp()
+    {
+        const auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        char buffer[32];
+        std::strftime(buffer, sizeof(buffer), "%Y%m%dT%H%M%SZ", std::gmtime(&now));
+        return buffer;
+    }
+
+    /**
+     * @brief Ticks of the file clock, only ever compared for equality.
+     */
+    std::int64_t modifiedTime(std::filesystem::path const& file)
+    {
+        return static_cast<std::int64_t>(std::filesystem::last_write_time(file).time_since_epoch().count());
+    }
+
+    double mebibytesPerSecond(std::uint64_t bytes, double seconds)
+    {
+        return seconds <= 0 ? 0 : static_cast<double>(bytes) / (1024 * 1024) / seconds;
+    }
+}
+
+// #####################################################################################################################
+WorldArchive::WorldArchive(
+    std::filesystem::path world,
+    std::filesystem::path archives,
+    int compressionLevel,
+    unsigned int compressionThreads)
+    : world_{std::move(world)}
+    , archives_{std::move(archives)}
+    , compressionLevel_{compressionLevel}
+    , compressionThreads_{compressionThreads}
+{}
+//---------------------------------------------------------------------------------------------------------------------
+WorldArchiveResult WorldArchive::create(RateLimiter& limiter, WorldBackup::Pause const& pause)
+{
+    if (!std::filesystem::is_directory(world_))
+        throw std::runtime_error("There is no world to archive in " + world_.string());
+    // Before the first compression, the zstd workers inherit it. Dropped for the paused pass, which this thread reads.
+    std::optional<LowIoPriority> lowPriority{std::in_place};
+    std::filesystem::create_directories(archives_);
+    const auto start = std::chrono::steady_clock::now();
+
+    auto journal = loadJournal();
+    if (journal.archiveName.empty())
+        journal = Journal{.archiveName = world_.filename().string() + "-" + utcTimestamp() + ".tar.zst"};
+    const auto partial = archives_ / (journal.archiveName + partialSuffix);
+
+    // A journal that got further than the archive on disk, after a power loss for example, cannot be trusted.
+    std::error_code ec;
+    if (journal.outputSize != 0 && (std::filesystem::file_size(partial, ec) < journal.outputSize || ec))
+    {
+        std::cout << "Restarting " << journal.archiveName << ", it is shorter than its journal.\n";
+        journal.outputSize = 0;
+        journal.files.clear();
+    }
+    if (journal.outputSize == 0)
+        std::ofstream{partial, std::ios_base::binary | std::ios_base::trunc};
+    else
+        std::filesystem::resize_file(partial, journal.outputSize);
+    saveJournal(journal);
+
+    WorldArchiveResult result{.archive = archives_ / journal.archiveName, .resumedFiles = journal.files.size()};
+    if (result.resumedFiles != 0)
+        std::cout << "Resuming " << journal.archiveName << " after " << result.resumedFiles << " files.\n";
+
+    // The last copy of every file in the archive, later copies replace earlier ones.
+    std::unordered_map<std::string, ArchivedFile> archived;
+    for (auto const& file : journal.files)
+        archived.insert_or_assign(file.name, file);
+    const auto prefix = world_.filename().string() + "/";
+    auto listWorld = [&](bool changedOnly) {
+        std::vector<std::pair<std::string, std::filesystem::path>> files;
+        for (auto const& entry : std::filesystem::recursive_directory_iterator{world_})
+        {
+            const auto relative = entry.path().lexically_relative(world_);
+            if (!entry.is_regular_file() || relative == sessionLockName)
+                continue;
+            auto name = prefix + relative.generic_string();
+            const auto it = archived.find(name);
+            if (it == archived.end() ||
+                (changedOnly &&
+                 (it->second.size != entry.file_size() || it->second.modified != modifiedTime(entry.path()))))
+            {
+                files.emplace_back(std::move(name), entry.path());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    };
+
+    std::unique_ptr<ZSTD_CCtx, CompressDeleter> context{ZSTD_createCCtx()};
+    if (!context)
+        throw std::bad_alloc{};
+    check(ZSTD_CCtx_setParameter(context.get(), ZSTD_c_compressionLevel, compressionLevel_));
+    check(ZSTD_CCtx_setParameter(context.get(), ZSTD_c_checksumFlag, 1));
+    // Fails on a libzstd without thread support, which then compresses on this thread alone.
+    if (ZSTD_isError(ZSTD_CCtx_setParameter(
+            context.get(), ZSTD_c_nbWorkers, static_cast<int>(compressionThreads_))))
+    {
+        std::cout << "libzstd has no worker threads, compressing on one core.\n";
+    }
+
+    // Null during the paused pass, which runs at full speed to keep the pause short.
+    RateLimiter* pace = &limiter;
+    std::ofstream output{partial, std::ios_base::binary | std::ios_base::app};
+    std::string outputBuffer(ZSTD_CStreamOutSize(), '\0');
+    auto compress = [&](char const* data, std::size_t size, ZSTD_EndDirective mode) {
+        ZSTD_inBuffer input{data, size, 0};
+        while (true)
+        {
+            ZSTD_outBuffer out{outputBuffer.data(), outputBuffer.size(), 0};
+            const auto remaining = ZSTD_compressStream2(context.get(), &out, &input, mode);
+            check(remaining);
+            if (pace != nullptr)
+                pace->acquire(out.pos);
+            output.write(outputBuffer.data(), static_cast<std::streamsize>(out.pos));
+            if (!output.good())
+                throw std::runtime_error("Could not write " + partial.string());
+            result.outputBytes += out.pos;
+            if (mode == ZSTD_e_continue ? input.pos == input.size : remaining == 0)
+                break;
+        }
+    };
+
+    std::vector<ArchivedFile> sinceCheckpoint;
+    std::uint64_t bytesSinceCheckpoint = 0;
+    std::size_t filesTotal = archived.size();
+    auto checkpoint = [&]() {
+        compress(nullptr, 0, ZSTD_e_end);
+        output.flush();
+        if (!output.good())
+            throw std::runtime_error("Could not write " + partial.string());
+        journal.outputSize = std::filesystem::file_size(partial);
+        appendToJournal(sinceCheckpoint, journal.outputSize);
+        std::move(sinceCheckpoint.begin(), sinceCheckpoint.end(), std::back_inserter(journal.files));
+        sinceCheckpoint.clear();
+        bytesSinceCheckpoint = 0;
+
+        const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Archived " << archived.size() << " of " << filesTotal << " files, reading "
+                  << mebibytesPerSecond(result.inputBytes, seconds) << " MiB/s\n";
+    };
+
+    std::string buffer(Hashing::readBufferSize, '\0');
+    auto archive = [&](std::vector<std::pair<std::string, std::filesystem::path>> const& files) {
+        for (auto const& [name, path] : files)
+        {
+            std::ifstream reader{path, std::ios_base::binary};
+            if (!reader.good())
+                throw std::runtime_error("Could not open " + path.string());
+            // The header promises this size. A file that grows meanwhile is cut off, one that shrinks is filled with
+            // zeros, the hash describes what went into the archive either way. Taken before reading, a file written
+            // meanwhile is archived again by the paused pass.
+            const auto size = std::filesystem::file_size(path);
+            const auto modified = std::filesystem::last_write_time(path);
+            const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::file_clock::to_sys(modified).time_since_epoch());
+            const auto header =
+                Tar::fileHeader(name, size, static_cast<std::uint64_t>(std::max<std::int64_t>(seconds.count(), 0)));
+            compress(header.data(), header.size(), ZSTD_e_continue);
+
+            Hashing::MultiDigest digest{Hashing::Sha256};
+            for (std::uint64_t left = size; left != 0;)
+            {
+                const auto amount = static_cast<std::size_t>(std::min<std::uint64_t>(left, buffer.size()));
+                reader.read(buffer.data(), static_cast<std::streamsize>(amount));
+                const auto read = static_cast<std::size_t>(reader.gcount());
+                if (pace != nullptr)
+                    pace->acquire(read);
+                std::fill(buffer.begin() + static_cast<std::ptrdiff_t>(read), buffer.begin() + amount, '\0');
+                digest.update(buffer.data(), amount);
+                compress(buffer.data(), amount, ZSTD_e_continue);
+                left -= amount;
+            }
+            const std::string padding(Tar::padding(size), '\0');
+            compress(padding.data(), padding.size(), ZSTD_e_continue);
+
+            const ArchivedFile file{
+                .name = name,
+                .size = size,
+                .modified = static_cast<std::int64_t>(modified.time_since_epoch().count()),
+                .sha256 = digest.finish().sha256,
+            };
+            archived.insert_or_assign(name, file);
+            sinceCheckpoint.push_back(file);
+            result.inputBytes += size;
+            bytesSinceCheckpoint += size;
+            if (bytesSinceCheckpoint >= checkpointBytes)
+                checkpoint();
+        }
+    };
+
+    const auto files = listWorld(false);
+    filesTotal += files.size();
+    archive(files);
+    if (pause.begin)
+    {
+        lowPriority.reset();
+        pause.begin();
+        const auto pausedAt = std::chrono::steady_clock::now();
+        pace = nullptr;
+        try
+        {
+            const auto changed = listWorld(true);
+            filesTotal += static_cast<std::size_t>(std::count_if(changed.begin(), changed.end(), [&](auto const& file) {
+                return !archived.contains(file.first);
+            }));
+            std::cout << "Archiving " << changed.size() << " files again that changed meanwhile.\n";
+            archive(changed);
+        }
+        catch (...)
+        {
+            pause.end();
+            throw;
+        }
+        pause.end();
+        std::cout << "Saving paused for "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - pausedAt)
+                         .count()
+                  << " ms\n";
+    }
+
+    const std::string trailer(Tar::trailerSize, '\0');
+    compress(trailer.data(), trailer.size(), ZSTD_e_continue);
+    checkpoint();
+    output.close();
+
+    {
+        std::ofstream hashes{result.archive.string() + ".sha256", std::ios_base::binary};
+        // Only the copies that end up on disk when the archive is extracted.
+        std::unordered_map<std::string, std::size_t> lastCopy;
+        for (std::size_t i = 0; i != journal.files.size(); ++i)
+            lastCopy.insert_or_assign(journal.files[i].name, i);
+        for (std::size_t i = 0; i != journal.files.size(); ++i)
+        {
+            if (lastCopy.at(journal.files[i].name) == i)
+                hashes << journal.files[i].sha256 << "  " << journal.files[i].name << "\n";
+        }
+        if (!hashes.good())
+            throw std::runtime_error("Could not write the hashes of " + result.archive.string());
+    }
+    std::filesystem::rename(partial, result.archive);
+    std::filesystem::remove(journalFile());
+
+    result.files = archived.size();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "World archive " << result.archive.filename().string() << ": " << result.files << " files, "
+              << result.inputBytes / (1024 * 1024) << " MiB read at "
+              << mebibytesPerSecond(result.inputBytes, result.seconds) << " MiB/s, "
+              << result.outputBytes / (1024 * 1024) << " MiB written\n";
+    return result;
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::filesystem::path WorldArchive::journalFile() const
+{
+    return archives_ / journalFileName;
+}
+//---------------------------------------------------------------------------------------------------------------------
+WorldArchive::Journal WorldArchive::loadJournal() const
+{
+    std::ifstream reader{journalFile(), std::ios_base::binary};
+    if (!reader.good())
+        return {};
+    std::string line;
+    std::getline(reader, line);
+    const auto header = nlohmann::json::parse(line, nullptr, false);
+    if (header.is_discarded() || !header.is_object() || header.value("version", 0) != journalFormatVersion)
+    {
+        std::cout << "Ignoring unreadable archive journal in " << archives_.string() << "\n";
+        return {};
+    }
+
+    Journal result{
+        .archiveName = header.at("archive").get<std::string>(),
+        .outputSize = 0,
+        .files = {},
+    };
+    // Files count once the checkpoint after them is written, an append cut short leaves them without one.
+    std::vector<ArchivedFile> pending;
+    while (std::getline(reader, line))
+    {
+        const auto entry = nlohmann::json::parse(line, nullptr, false);
+        if (entry.is_discarded() || !entry.is_object())
+            break;
+        if (entry.contains("outputSize"))
+        {
+            result.outputSize = entry.at("outputSize").get<std::uint64_t>();
+            std::move(pending.begin(), pending.end(), std::back_inserter(result.files));
+            pending.clear();
+            continue;
+        }
+        pending.push_back({
+            .name = entry.at("name").get<std::string>(),
+            .size = entry.at("size").get<std::uint64_t>(),
+            .modified = entry.at("modified").get<std::int64_t>(),
+            .sha256 = entry.at("sha256").get<std::string>(),
+        });
+    }
+    return result;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void WorldArchive::saveJournal(Journal const& journal) const
+{
+    const auto temporary = std::filesystem::path{journalFile().string() + ".tmp"};
+    {
+        std::ofstream writer{temporary, std::ios_base::binary};
+        writer << nlohmann::json{{"version", journalFormatVersion}, {"archive", journal.archiveName}}.dump() << '\n';
+        writeJournalLines(writer, journal.files, journal.outputSize);
+        if (!writer.good())
+            throw std::runtime_error("Could not write the archive journal " + temporary.string());
+    }
+    std::filesystem::rename(temporary, journalFile());
+}
+//---------------------------------------------------------------------------------------------------------------------
+void WorldArchive::appendToJournal(std::vector<ArchivedFile> const& files, std::uint64_t outputSize) const
+{
+    std::ofstream writer{journalFile(), std::ios_base::binary | std::ios_base::app};
+    writeJournalLines(writer, files, outputSize);
+    writer.flush();
+    if (!writer.good())
+        throw std::runtime_error("Could not write the archive journal " + journalFile().string());
+}
+//---------------------------------------------------------------------------------------------------------------------
+void WorldArchive::writeJournalLines(
+    std::ostream& writer,
+    std::vector<ArchivedFile> const& files,
+    std::uint64_t outputSize)
+{
+    for (auto const& file : files)
+    {
+        writer << nlohmann::json{
+                      {"name", file.name},
+                      {"size", file.size},
+                      {"modified", file.modified},
+                      {"sha256", file.sha256},
+                  }
+                      .dump()
+               << '\n';
+    }
+    writer << nlohmann::json{{"outputSize", outputSize}}.dump() << '\n';
+}
+// #####################################################################################################################
@@ -0,0 +1,327 @@
+#include <backend/parallel_for.hpp>
+#include <update_server/hashing.hpp>
+#include <update_server/low_io_priority.hpp>
+#include <update_server/world_backup.hpp>
+
+#include <nlohmann/json.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+
+namespace
+{
+    constexpr int manifestFormatVersion = 1;
+    constexpr char const* manifestFileName = "manifest.json";
+    constexpr char const* partialSuffix = ".partial";
+    /// Held open by the game server and meaningless in a copy.
+    constexpr char const* sessionLockName = "session.lock";
+
+    /**
+     * @brief Ticks of the file clock, only ever compared for equality.
+     */
+    std::int64_t modifiedTime(std::filesystem::path const& file)
+    {
+        return static_cast<std::int64_t>(std::filesystem::last_write_time(file).time_since_epoch().count());
+    }
+
+    /**
+     * @brief Like copy_file, but in chunks that are each drawn from the limiter if there is one.
+     */
+    void copyThrottled(std::filesystem::path const& source, std::filesystem::path const& target, RateLimiter* limiter)
+    {
+        std::ifstream reader{source, std::ios_base::binary};
+        if (!reader.good())
+            throw std::runtime_error("Could not open " + source.string());
+        std::ofstream writer{target, std::ios_base::binary | std::ios_base::trunc};
+        if (!writer.good())
+            throw std::runtime_error("Could not create " + target.string());
+
+        std::string buffer(Hashing::readBufferSize, '\0');
+        while (reader.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || reader.gcount() != 0)
+        {
+            const auto amount = static_cast<std::size_t>(reader.gcount());
+            // Once for reading and once for writing.
+            if (limiter != nullptr)
+                limiter->acquire(2 * amount);
+            writer.write(buffer.data(), static_cast<std::streamsize>(amount));
+            if (!writer.good())
+                throw std::runtime_error("Could not write " + target.string());
+        }
+    }
+
+    /**
+     * @brief Snapshots are numbered, the number of a folder name or std::nullopt for anything else.
+     */
+    std::optional<unsigned long long> snapshotNumber(std::string const& name)
+    {
+        if (name.empty() || name.size() > 18 || !std::all_of(name.begin(), name.end(), [](char c) {
+                return c >= '0' && c <= '9';
+            }))
+        {
+            return std::nullopt;
+        }
+        return std::stoull(name);
+    }
+}
+
+// #####################################################################################################################
+WorldBackup::WorldBackup(std::filesystem::path world, std::filesystem::path backups, unsigned int threadCount)
+    : world_{std::move(world)}
+    , backups_{std::move(backups)}
+    , threadCount_{std::max(1u, threadCount)}
+{}
+//---------------------------------------------------------------------------------------------------------------------
+WorldSnapshot WorldBackup::create(RateLimiter& limiter, Pause const& pause)
+{
+    if (!std::filesystem::is_directory(world_))
+        throw std::runtime_error("There is no world to back up in " + world_.string());
+    std::filesystem::create_directories(backups_);
+
+    const auto existing = snapshots();
+    const auto previousName = existing.empty() ? std::string{} : existing.back();
+    const auto previousDirectory = backups_ / previousName;
+    const auto previous = previousName.empty() ? Manifest{} : loadManifest(previousDirectory);
+
+    WorldSnapshot snapshot{
+        .name = std::to_string(previousName.empty() ? 1 : *snapshotNumber(previousName) + 1),
+    };
+    // Written under another name and renamed when complete, a crash leaves nothing that looks like a snapshot.
+    const auto target = backups_ / (snapshot.name + partialSuffix);
+    std::filesystem::remove_all(target);
+    std::filesystem::create_directories(target);
+
+    auto manifest = copyWorld(target, {}, previousDirectory, previous, &limiter, snapshot);
+    if (pause.begin)
+    {
+        pause.begin();
+        const auto pausedAt = std::chrono::steady_clock::now();
+        try
+        {
+            // Usually a handful of region files, copied at full speed to keep the pause short.
+            manifest = copyWorld(target, manifest, previousDirectory, previous, nullptr, snapshot);
+        }
+        catch (...)
+        {
+            pause.end();
+            throw;
+        }
+        pause.end();
+        snapshot.pausedMilliseconds =
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - pausedAt)
+                .count();
+    }
+
+    saveManifest(target, manifest, previousName);
+    std::filesystem::rename(target, backups_ / snapshot.name);
+
+    snapshot.files = manifest.size();
+    std::cout << "World backup " << snapshot.name << ": copied " << snapshot.copiedFiles << " of " << snapshot.files
+              << " files (" << snapshot.copiedBytes / (1024 * 1024) << " MiB), linked "
+              << snapshot.linkedBytes / (1024 * 1024) << " MiB, saving paused for " << snapshot.pausedMilliseconds
+              << " ms\n";
+    return snapshot;
+}
+//---------------------------------------------------------------------------------------------------------------------
+WorldBackup::Manifest WorldBackup::copyWorld(
+    std::filesystem::path const& target,
+    Manifest const& present,
+    std::filesystem::path const& previousDirectory,
+    Manifest const& previous,
+    RateLimiter* limiter,
+    WorldSnapshot& snapshot) const
+{
+    std::vector<std::filesystem::path> files;
+    for (auto const& entry : std::filesystem::recursive_directory_iterator{world_})
+    {
+        const auto relative = entry.path().lexically_relative(world_);
+        if (entry.is_directory())
+            std::filesystem::create_directories(target / relative);
+        else if (entry.is_regular_file() && relative != sessionLockName)
+            files.push_back(relative);
+    }
+    // Deleted from the world since the target was filled.
+    for (auto const& [file, entry] : present)
+    {
+        if (!std::filesystem::is_regular_file(world_ / file))
+            std::filesystem::remove(target / file);
+    }
+
+    Manifest manifest;
+    manifest.reserve(files.size());
+    std::mutex manifestGuard;
+    std::atomic_size_t copiedFiles{0};
+    std::atomic_uint64_t copiedBytes{0};
+    std::atomic_uint64_t linkedBytes{0};
+
+    // The threads take files from all dimensions alike, so one large dimension does not leave the others idle.
+    std::atomic_bool failed{false};
+    std::exception_ptr firstError;
+    parallelFor(files.size(), threadCount_, [&](std::size_t index) {
+        if (failed)
+            return;
+        // Only while paced, the idle class could starve a pass that keeps the game server paused. Per file, the
+        // calling thread copies files too and must not keep the class.
+        std::optional<LowIoPriority> lowPriority;
+        if (limiter != nullptr)
+            lowPriority.emplace();
+        try
+        {
+            auto const& file = files[index];
+            const auto source = world_ / file;
+            // Taken before the copy, a file written during the copy is copied again by the next pass.
+            const Entry entry{.size = std::filesystem::file_size(source), .modified = modifiedTime(source)};
+            const auto key = file.generic_string();
+            const auto unchangedIn = [&](Manifest const& recorded) {
+                const auto it = recorded.find(key);
+                return it != recorded.end() && it->second.size == entry.size &&
+                    it->second.modified == entry.modified;
+            };
+
+            if (unchangedIn(present))
+            {
+                std::scoped_lock lock{manifestGuard};
+                manifest.emplace(key, entry);
+                return;
+            }
+            // May be a link into the previous snapshot, which writing through it would change.
+            if (present.contains(key))
+                std::filesystem::remove(target / file);
+
+            bool linked = false;
+            if (unchangedIn(previous))
+            {
+                // Fails once the file system runs out of links for the inode, it is copied then.
+                std::error_code ec;
+                std::filesystem::create_hard_link(previousDirectory / file, target / file, ec);
+                linked = !ec;
+            }
+            if (linked)
+            {
+                linkedBytes += entry.size;
+            }
+            else
+            {
+                copyThrottled(source, target / file, limiter);
+                ++copiedFiles;
+                copiedBytes += entry.size;
+            }
+
+            std::scoped_lock lock{manifestGuard};
+            manifest.emplace(key, entry);
+        }
+        catch (...)
+        {
+            std::scoped_lock lock{manifestGuard};
+            if (!firstError)
+                firstError = std::current_exception();
+            failed = true;
+        }
+    });
+    if (firstError)
+        std::rethrow_exception(firstError);
+
+    snapshot.copiedFiles += copiedFiles;
+    snapshot.copiedBytes += copiedBytes;
+    snapshot.linkedBytes += linkedBytes;
+    return manifest;
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::vector<std::string> WorldBackup::snapshots() const
+{
+    std::vector<std::pair<unsigned long long, std::string>> numbered;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator entries{backups_, ec}, end; !ec && entries != end; entries.increment(ec))
+    {
+        const auto name = entries->path().filename().string();
+        if (const auto number = snapshotNumber(name);
+            number && std::filesystem::exists(entries->path() / manifestFileName))
+        {
+            numbered.emplace_back(*number, name);
+        }
+    }
+    std::sort(numbered.begin(), numbered.end());
+
+    std::vector<std::string> names;
+    names.reserve(numbered.size());
+    for (auto& [number, name] : numbered)
+        names.push_back(std::move(name));
+    return names;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void WorldBackup::restore(std::string const& snapshot) const
+{
+    const auto source = backups_ / snapshot;
+    if (!snapshotNumber(snapshot) || !std::filesystem::exists(source / manifestFileName))
+        throw std::invalid_argument("No complete world backup named " + snapshot);
+
+    // Copied, not linked: the game server writes region files in place, which would change the backup with them.
+    const auto restoring = std::filesystem::path{world_.string() + ".restoring"};
+    std::filesystem::remove_all(restoring);
+    for (auto const& [file, entry] : loadManifest(source))
+    {
+        const auto relative = std::filesystem::path{file};
+        if (std::filesystem::file_size(source / relative) != entry.size)
+            throw std::runtime_error("World backup " + snapshot + " is damaged: " + file + " has the wrong size");
+        std::filesystem::create_directories((restoring / relative).parent_path());
+        std::filesystem::copy_file(source / relative, restoring / relative);
+    }
+
+    const auto aside = std::filesystem::path{world_.string() + ".before_restore"};
+    std::filesystem::remove_all(aside);
+    if (std::filesystem::exists(world_))
+        std::filesystem::rename(world_, aside);
+    std::filesystem::rename(restoring, world_);
+    std::cout << "Restored world backup " << snapshot << ", the replaced world is in " << aside.string() << "\n";
+}
+//---------------------------------------------------------------------------------------------------------------------
+WorldBackup::Manifest WorldBackup::loadManifest(std::filesystem::path const& snapshot) const
+{
+    std::ifstream reader{snapshot / manifestFileName, std::ios_base::binary};
+    const auto manifest = nlohmann::json::parse(reader, nullptr, false);
+    if (manifest.is_discarded() || !manifest.is_object() || manifest.value("version", 0) != manifestFormatVersion)
+        throw std::runtime_error("Unreadable world backup manifest in " + snapshot.string());
+
+    Manifest entries;
+    for (auto const& [file, entry] : manifest.at("files").items())
+    {
+        // Written by us, but names must stay inside the snapshot all the same.
+        const auto relative = std::filesystem::path{file}.lexically_normal();
+        if (relative.is_absolute() || relative.empty() || *relative.begin() == "..")
+            throw std::runtime_error("World backup manifest names a file outside the backup: " + file);
+        entries[file] = Entry{
+            .size = entry.at("size").get<std::uintmax_t>(),
+            .modified = entry.at("modified").get<std::int64_t>(),
+        };
+    }
+    return entries;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void WorldBackup::saveManifest(
+    std::filesystem::path const& snapshot,
+    Manifest const& manifest,
+    std::string const& previous) const
+{
+    auto files = nlohmann::json::object();
+    for (auto const& [file, entry] : manifest)
+        files[file] = {{"size", entry.size}, {"modified", entry.modified}};
+
+    std::ofstream writer{snapshot / manifestFileName, std::ios_base::binary};
+    writer << nlohmann::json{
+        {"version", manifestFormatVersion},
+        {"created",
+         std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
+             .count()},
+        {"previous", previous},
+        {"files", std::move(files)},
+    }
+                  .dump();
+    if (!writer.good())
+        throw std::runtime_error("Could not write the world backup manifest in " + snapshot.string());
+}
+// #####################################################################################################################
@@ -0,0 +1,89 @@
+#include <update_server/world_jobs.hpp>
+
+#include <exception>
+#include <iostream>
+
+// #####################################################################################################################
+WorldJobs::WorldJobs()
+    : guard_{}
+    , nextId_{1}
+    , running_{false}
+    , jobs_{}
+    , thread_{}
+{}
+//---------------------------------------------------------------------------------------------------------------------
+WorldJobs::~WorldJobs()
+{
+    if (thread_.joinable())
+        thread_.join();
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::optional<std::uint64_t> WorldJobs::start(std::string kind, std::function<nlohmann::json()> job)
+{
+    std::scoped_lock lock{guard_};
+    if (running_)
+        return std::nullopt;
+    // Done with its job, it only returns after finish.
+    if (thread_.joinable())
+        thread_.join();
+
+    const auto id = nextId_++;
+    jobs_.push_back(Job{.id = id, .kind = std::move(kind), .result = std::nullopt, .error = std::nullopt});
+    if (jobs_.size() > jobsKept)
+        jobs_.pop_front();
+    running_ = true;
+    thread_ = std::thread{[this, id, job = std::move(job)]() {
+        try
+        {
+            finish(id, job(), std::nullopt);
+        }
+        catch (std::exception const& e)
+        {
+            finish(id, std::nullopt, e.what());
+        }
+    }};
+    return id;
+}
+//---------------------------------------------------------------------------------------------------------------------
+std::optional<nlohmann::json> WorldJobs::status(std::uint64_t id) const
+{
+    std::scoped_lock lock{guard_};
+    for (auto const& job : jobs_)
+    {
+        if (job.id != id)
+            continue;
+        nlohmann::json status{{"id", job.id}, {"kind", job.kind}};
+        if (job.result)
+        {
+            status["state"] = "finished";
+            status["result"] = *job.result;
+        }
+        else if (job.error)
+        {
+            status["state"] = "failed";
+            status["error"] = *job.error;
+        }
+        else
+        {
+            status["state"] = "running";
+        }
+        return status;
+    }
+    return std::nullopt;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void WorldJobs::finish(std::uint64_t id, std::optional<nlohmann::json> result, std::optional<std::string> error)
+{
+    std::scoped_lock lock{guard_};
+    running_ = false;
+    for (auto& job : jobs_)
+    {
+        if (job.id != id)
+            continue;
+        if (error)
+            std::cout << "World " << job.kind << " " << id << " failed: " << *error << "\n";
+        job.result = std::move(result);
+        job.error = std::move(error);
+    }
+}
+// #####################################################################################################################